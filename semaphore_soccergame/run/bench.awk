@@ -0,0 +1,34 @@
+# Summary of the metrics file of the generator (option -m): p50, p99 and max of every measurement, one line per
+# measurement, as comma separated values.
+#
+# usage: awk -F, -f bench.awk bench.csv
+
+NR == 1 { for (c = 3; c <= NF; c++) name[c] = $c; nc = NF; next }
+
+{ n++; for (c = 3; c <= nc; c++) val[c, n] = $c + 0 }
+
+# sifting down of s[i] in the heap s[1 .. n]
+function sift(s, i, n,    c, t) {
+    while ((c = 2 * i) <= n) {
+        if ((c < n) && (s[c + 1] > s[c])) c++
+        if (s[i] >= s[c]) return
+        t = s[i]; s[i] = s[c]; s[c] = t
+        i = c
+    }
+}
+
+# sorting of s[1 .. n] (heapsort: no recursion, whatever the values)
+function hsort(s, n,    i, t) {
+    for (i = int(n / 2); i >= 1; i--) sift(s, i, n)
+    for (i = n; i > 1; i--) { t = s[1]; s[1] = s[i]; s[i] = t; sift(s, 1, i - 1) }
+}
+
+END {
+    print "metric,matches,p50,p99,max"
+    for (c = 3; c <= nc; c++) {
+        split("", s)
+        for (i = 1; i <= n; i++) s[i] = val[c, i]
+        hsort(s, n)
+        printf "%s,%d,%.3f,%.3f,%.3f\n", name[c], n, s[int(0.50 * (n - 1)) + 1], s[int(0.99 * (n - 1)) + 1], s[n]
+    }
+}
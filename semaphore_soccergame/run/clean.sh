@@ -3,19 +3,23 @@
 rm -f error*
 rm -f core
 
-killall player referee goalie
+killall player referee goalie logger worker
 sleep 1
-killall -9 player referee goalie
+killall -9 player referee goalie logger worker
 
-#unsafe
-key=$(ipcs | grep " 120 " | grep -v "0000000" | cut -d\  -f1)
+# the POSIX objects (futex semaphores, posix shared memory) left by killed simulations
+objs=$(ls /dev/shm/soccergame.* 2>/dev/null)
+rm -f /dev/shm/soccergame.*
 
-if [[ -z $key ]]
+# the IPC resources of the simulations have private keys 0x5cxxxxxx
+sems=$(ipcs -s | awk '$1 ~ /^0x5c/ { print $2 }')
+shms=$(ipcs -m | awk '$1 ~ /^0x5c/ { print $2 }')
+
+if [[ -z $sems && -z $shms && -z $objs ]]
 then
    echo Did not find soccergame IPC resources
    exit 1
 fi
 
-ipcrm -S $key
-ipcrm -M $key
-
+for id in $sems; do ipcrm -s $id; done
+for id in $shms; do ipcrm -m $id; done
@@ -1,29 +1,44 @@
 BEGIN {
      FS = " ";
-     f=1
-     #players
-     for(i=0;i<10;i++) {
-        FieldSize[f++] = 4;
-     }
-     #goalies
-     FieldSize[f++]=5;
-     for(i=0;i<2;i++) {
-        FieldSize[f++] = 4;
+     nf = 0
+}
+
+# the column header sets the fields, as wide as the entity names plus a blank; the first goalie and the first
+# referee take the blank of their group too
+nf == 0 && $1 ~ /^P0/ {
+     nf = NF
+     for(i=1; i<=NF; i++) {
+        FieldSize[i] = length($i) + 1
+        if(i > 1 && substr($i,1,1) != substr($(i-1),1,1)) {
+           FieldSize[i]++
+        }
      }
-     #referee
-     FieldSize[f++]=5;
+}
+
+# the seed and the arrival delays of a match are printed unchanged; the next state is printed in full
+/^Seed / {
+     print $0
+     delays = 1
+     split("", prev)
+     next
+}
+
+delays == 1 {
+     print $0
+     delays = 0
+     next
 }
 
 /.*/ {
-    if(NF==14) {
+    if(nf > 0 && NF==nf) {
 #        print  "NOTFILTE " $0
-        for(i=1; i<=14; i++) {
+        for(i=1; i<=nf; i++) {
                if($i==prev[i]) {
                  printf("%*s ",FieldSize[i],".")
                }
-               else printf ("%*s ",FieldSize[i],$i) 
+               else printf ("%*s ",FieldSize[i],$i)
                prev[i] = $i
-        
+
         }
         printf("\n")
     }
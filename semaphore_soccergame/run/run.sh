@@ -11,8 +11,5 @@ if ! [ $n -gt 0 ] 2>/dev/null; then
     exit 1
 fi
 
-for i in $(seq 1 $n)
-do
-     echo -e "\n\e[34;1mRun n.º $i\e[0m"
-     ./probSemSharedMemSoccerGame
-done
+# a single generator runs the whole batch, reusing the shared region and the semaphore set
+./probSemSharedMemSoccerGame --runs $n
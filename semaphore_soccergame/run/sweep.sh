@@ -0,0 +1,79 @@
+#!/bin/bash
+#
+# Parallel sweep: runs many independent simulations, keeping a number of them in flight at the same time.
+# Each run takes place in its own directory, sweep/NNNN, where its log and error files are kept, and a
+# summary of the sweep is printed at the end. Arguments after "--" are passed on to the generator.
+
+usage() { echo "USAGE: $0 «number-of-runs» [«parallelism» [«timeout-in-seconds»]] [-- «generator-options»]"; exit 1; }
+
+args=()
+while [ $# -gt 0 ] && [ "$1" != "--" ]; do
+    args+=("$1"); shift
+done
+[ "$1" == "--" ] && shift
+
+case ${#args[@]} in
+    0) n=1000; k=$(nproc); t=30;;
+    1) n=${args[0]}; k=$(nproc); t=30;;
+    2) n=${args[0]}; k=${args[1]}; t=30;;
+    3) n=${args[0]}; k=${args[1]}; t=${args[2]};;
+    *) usage;;
+esac
+
+for v in "$n" "$k" "$t"; do
+    if ! [ "$v" -gt 0 ] 2>/dev/null; then
+        echo "Wrong argument value (\"$v\"). Aborting."
+        exit 1
+    fi
+done
+
+here=$(pwd)
+out=$here/sweep
+rm -rf "$out" && mkdir -p "$out" || exit 1
+
+# one run: the binaries are linked into its directory, since the generator launches the entities from there
+run() {
+    local i=$1 dir=$out/$(printf "%04d" $1) rc b start end
+    shift
+    mkdir "$dir" && cd "$dir" || return 1
+    for b in probSemSharedMemSoccerGame player goalie referee logger worker; do
+        [ -e "$here/$b" ] && ln -s "$here/$b" $b
+    done
+    start=$(date +%s%N)
+    timeout -k 2 $t ./probSemSharedMemSoccerGame "$@" log.txt > stdout.txt 2> stderr.txt
+    rc=$?
+    end=$(date +%s%N)
+    rm -f probSemSharedMemSoccerGame player goalie referee logger worker
+    find . -name 'error_*' -empty -delete
+    echo "$i $rc $(( (end - start) / 1000 ))" > result
+}
+
+echo "Sweep of $n runs, $k at a time (timeout of $t s per run)"
+begin=$(date +%s%N)
+for i in $(seq 1 $n); do
+    while [ $(jobs -rp | wc -l) -ge $k ]; do
+        wait -n
+    done
+    run $i "$@" &
+done
+wait
+finish=$(date +%s%N)
+
+# summary: exit status 124 (or 137, if the run had to be killed) is a hang
+cat "$out"/*/result | sort -n > "$out/results.txt"
+sort -k3 -n "$out/results.txt" | awk -v wall=$(( (finish - begin) / 1000 )) '
+    { n++; us[n] = $3; if ($2 == 124 || $2 == 137) hangs++; else if ($2 != 0) fails++ }
+    END {
+        printf "%d runs in %.3f s: %.1f runs/s\n", n, wall / 1e6, n * 1e6 / wall
+        printf "failures: %d, hangs: %d\n", fails, hangs
+        printf "wall time per run (ms): min %.3f, p50 %.3f, p90 %.3f, p99 %.3f, max %.3f\n",
+               us[1] / 1e3, us[int (0.50 * (n - 1)) + 1] / 1e3, us[int (0.90 * (n - 1)) + 1] / 1e3,
+               us[int (0.99 * (n - 1)) + 1] / 1e3, us[n] / 1e3
+    }' | tee "$out/summary.txt"
+
+# protocol of the logged matches, when the validator was built (make tools): only the logs that violate it
+if [ -x "$here/logcheck" ]; then
+    "$here/logcheck" -q "$out"/*/log.txt | grep -v ' 0 violating$' | tee -a "$out/summary.txt"
+fi
+
+awk '$2 != 0 { printf "run %d failed with status %d\n", $1, $2; bad = 1 } END { exit bad }' "$out/results.txt"
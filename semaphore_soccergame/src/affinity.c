@@ -0,0 +1,366 @@
+/**
+ *  \file affinity.c (implementation file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief Placement of the intervening entities on the processors.
+ *
+ *  The placement is resolved once, by the generator, into an ordered list of processors; entity <tt>e</tt> runs
+ *  on processor <tt>e mod n</tt> of the list. The processes are pinned at spawn time, by inheritance of the
+ *  processor set of the generator, and the threads through their creation attributes. The shared region is placed
+ *  on the memory node of the first processor with <tt>mbind</tt>, so that no library is needed.
+ *
+ *  Defined operations:
+ *     \li setting up the placement
+ *     \li querying whether the entities are placed
+ *     \li processor set of an entity
+ *     \li pinning of the calling thread
+ *     \li restoring the processor set of the calling thread
+ *     \li placement of a region on the memory node
+ *     \li description of the placement.
+ */
+
+#define _GNU_SOURCE                                                                    /* cpu_set_t, CPU_COUNT */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+
+#include "affinity.h"
+
+/** \brief location of the topology of the processors */
+#define  CPUDIR         "/sys/devices/system/cpu"
+
+/** \brief number of memory nodes that can be named */
+#define  MAXNODES       1024
+
+/** \brief processors of the placement, in order */
+static int order[CPU_SETSIZE];
+
+/** \brief number of processors of the placement - 0 if the entities are not placed */
+static int nCpus = 0;
+
+/** \brief processors the generator may run on when the placement was set up */
+static cpu_set_t initial;
+
+/** \brief memory node of the first processor of the placement - -1 if it is not known */
+static int node = -1;
+
+/** \brief policy of the placement */
+static char policyName[32];
+
+/**
+ *  \brief Parsing of a processor list, as in <tt>0,2,4-7</tt>.
+ *
+ *  \param s processor list (it may end with a newline)
+ *  \param cpus array where the processors are appended, in the order of the list
+ *  \param p_n pointer to the number of processors of the array
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, if the list is wrong
+ */
+static int parseList (const char *s, int cpus[], int *p_n)
+{
+    char *end;
+    long first, last, c;
+
+    while ((*s != '\0') && (*s != '\n')) {
+        first = last = strtol (s, &end, 10);
+        if ((end == s) || (first < 0) || (first >= CPU_SETSIZE)) {
+            return -1;
+        }
+        s = end;
+        if (*s == '-') {
+            last = strtol (++s, &end, 10);
+            if ((end == s) || (last < first) || (last >= CPU_SETSIZE)) {
+                return -1;
+            }
+            s = end;
+        }
+        for (c = first; c <= last; c++) {
+            if (*p_n == CPU_SETSIZE) {
+                return -1;
+            }
+            cpus[(*p_n)++] = (int) c;
+        }
+        if (*s == ',') {
+            s++;
+        }
+        else if ((*s != '\0') && (*s != '\n')) {
+            return -1;
+        }
+    }
+    return (*p_n > 0) ? 0 : -1;
+}
+
+/** \brief processors that share the last level cache of processor <tt>cpu</tt>: false if the topology is not
+           available */
+static bool lastCache (int cpu, cpu_set_t *set)
+{
+    char path[128], line[4096];
+    int index, level, top = 0, cpus[CPU_SETSIZE], n = 0, k;
+    FILE *fp;
+
+    line[0] = '\0';
+    for (index = 0; ; index++) {                                   /* the cache of the highest level is the last */
+        snprintf (path, sizeof (path), CPUDIR "/cpu%d/cache/index%d/level", cpu, index);
+        if ((fp = fopen (path, "r")) == NULL) {
+            break;
+        }
+        if ((fscanf (fp, "%d", &level) == 1) && (level > top)) {
+            fclose (fp);
+            snprintf (path, sizeof (path), CPUDIR "/cpu%d/cache/index%d/shared_cpu_list", cpu, index);
+            if ((fp = fopen (path, "r")) == NULL) {
+                continue;
+            }
+            if (fgets (line, sizeof (line), fp) != NULL) {
+                top = level;
+            }
+        }
+        fclose (fp);
+    }
+    if ((top == 0) || (parseList (line, cpus, &n) == -1)) {
+        return false;
+    }
+    CPU_ZERO (set);
+    for (k = 0; k < n; k++) {
+        CPU_SET (cpus[k], set);
+    }
+    return true;
+}
+
+/** \brief memory node of processor <tt>cpu</tt>: -1 if it is not known */
+static int nodeOf (int cpu)
+{
+    char path[128];
+    DIR *dir;
+    struct dirent *ent;
+    int n = -1;
+
+    snprintf (path, sizeof (path), CPUDIR "/cpu%d", cpu);
+    if ((dir = opendir (path)) == NULL) {
+        return -1;
+    }
+    while ((ent = readdir (dir)) != NULL) {                                  /* the node is a link named nodeN */
+        if ((strncmp (ent->d_name, "node", 4) == 0) && (sscanf (ent->d_name + 4, "%d", &n) == 1)) {
+            break;
+        }
+    }
+    closedir (dir);
+    return n;
+}
+
+/** \brief compact placement: the processors that share the last level cache of the first one */
+static void placeCompact (void)
+{
+    cpu_set_t llc;
+    int c, first = -1;
+
+    for (c = 0; c < CPU_SETSIZE; c++) {
+        if (CPU_ISSET (c, &initial)) {
+            if (first == -1) {
+                first = c;
+                if (!lastCache (first, &llc)) {
+                    llc = initial;
+                }
+            }
+            if (CPU_ISSET (c, &llc)) {
+                order[nCpus++] = c;
+            }
+        }
+    }
+}
+
+/** \brief spread placement: every processor, taking each last level cache in turn */
+static void placeSpread (void)
+{
+    static int group[CPU_SETSIZE];                                     /* last level cache of each processor */
+    static int taken[CPU_SETSIZE];                                    /* processors of each cache already placed */
+    cpu_set_t llc;
+    int c, d, g, nGroups = 0, n = CPU_COUNT (&initial);
+
+    for (c = 0; c < CPU_SETSIZE; c++) {
+        group[c] = -1;
+    }
+    for (c = 0; c < CPU_SETSIZE; c++) {
+        if (CPU_ISSET (c, &initial) && (group[c] == -1)) {
+            if (!lastCache (c, &llc)) {
+                CPU_ZERO (&llc);
+                CPU_SET (c, &llc);
+            }
+            for (d = c; d < CPU_SETSIZE; d++) {
+                if (CPU_ISSET (d, &initial) && CPU_ISSET (d, &llc) && (group[d] == -1)) {
+                    group[d] = nGroups;
+                }
+            }
+            taken[nGroups++] = 0;
+        }
+    }
+    while (nCpus < n) {                          /* the next processor of each cache in turn, in ascending order */
+        for (g = 0; g < nGroups; g++) {
+            int k = 0;
+            for (c = 0; c < CPU_SETSIZE; c++) {
+                if ((group[c] == g) && (k++ == taken[g])) {
+                    order[nCpus++] = c;
+                    taken[g]++;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+/**
+ *  \brief Setting up the placement.
+ *
+ *  Resolves the policy against the processors the calling process may run on, that are kept so that they can be
+ *  restored.
+ *
+ *  \param policy <tt>compact</tt>, <tt>spread</tt> or a processor list
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when the policy is wrong or names a processor the process may not run on (<tt>errno</tt> is set
+ *          to <tt>EINVAL</tt>), or when the processors can not be queried
+ */
+int affinityInit (const char *policy)
+{
+    int k;
+
+    if (sched_getaffinity (0, sizeof (initial), &initial) == -1) {
+        return -1;
+    }
+    nCpus = 0;
+    if (strcmp (policy, "compact") == 0) {
+        placeCompact ();
+    }
+    else if (strcmp (policy, "spread") == 0) {
+        placeSpread ();
+    }
+    else {
+        if (parseList (policy, order, &nCpus) == -1) {
+            nCpus = 0;
+            errno = EINVAL;
+            return -1;
+        }
+        for (k = 0; k < nCpus; k++) {
+            if (!CPU_ISSET (order[k], &initial)) {
+                nCpus = 0;
+                errno = EINVAL;
+                return -1;
+            }
+        }
+    }
+    snprintf (policyName, sizeof (policyName), "%s", ((policy[0] >= '0') && (policy[0] <= '9')) ? "list" : policy);
+    node = nodeOf (order[0]);
+    return 0;
+}
+
+/**
+ *  \brief Querying whether the entities are placed.
+ *
+ *  \return \c true, if a placement was set up
+ */
+bool affinityOn (void)
+{
+    return nCpus > 0;
+}
+
+/**
+ *  \brief Processor set of an entity.
+ *
+ *  \param e entity index
+ *  \param set pointer to the location where the set, of a single processor, is stored
+ */
+void affinityMask (int e, cpu_set_t *set)
+{
+    CPU_ZERO (set);
+    CPU_SET (order[e % nCpus], set);
+}
+
+/**
+ *  \brief Pinning of the calling thread to the processor of an entity.
+ *
+ *  The processes generated afterwards inherit it.
+ *
+ *  \param e entity index
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+int affinityPin (int e)
+{
+    cpu_set_t set;
+
+    affinityMask (e, &set);
+    return sched_setaffinity (0, sizeof (set), &set);
+}
+
+/**
+ *  \brief Restoring the processor set of the calling thread, as it was when the placement was set up.
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+int affinityRestore (void)
+{
+    return sched_setaffinity (0, sizeof (initial), &initial);
+}
+
+/**
+ *  \brief Placement of a region on the memory node of the processors.
+ *
+ *  The pages of the region are preferably allocated on the node of the first processor of the placement, and
+ *  those already allocated are moved there. It does nothing if the node is not known.
+ *
+ *  \param addr start of the region
+ *  \param len size of the region
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+int affinityBind (void *addr, size_t len)
+{
+    unsigned long mask[MAXNODES / (8 * sizeof (unsigned long))] = { 0 };
+    uintptr_t page = (uintptr_t) sysconf (_SC_PAGESIZE),
+              start = (uintptr_t) addr & ~(page - 1);                                /* whole pages are placed */
+
+    if ((node < 0) || (node >= MAXNODES)) {
+        return 0;
+    }
+    mask[node / (8 * sizeof (unsigned long))] |= 1UL << (node % (8 * sizeof (unsigned long)));
+    if ((syscall (SYS_mbind, start, len + ((uintptr_t) addr - start), MPOL_PREFERRED, mask,
+                  (unsigned long) MAXNODES, MPOL_MF_MOVE) == -1) && (errno != ENOSYS)) { /* ENOSYS: not NUMA */
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ *  \brief Description of the placement, as the policy, the processors in order and the memory node.
+ *
+ *  \param desc pointer to the location where the description is stored
+ *  \param size size of that location
+ */
+void affinityDescribe (char desc[], size_t size)
+{
+    size_t len;
+    int k;
+
+    len = (size_t) snprintf (desc, size, "%s placement on processors", policyName);
+    for (k = 0; (k < nCpus) && (len < size); k++) {
+        len += (size_t) snprintf (desc + len, size - len, "%s%d", (k == 0) ? " " : ",", order[k]);
+    }
+    if (len < size) {
+        if (node >= 0) {
+            snprintf (desc + len, size - len, " (memory node %d)", node);
+        }
+        else snprintf (desc + len, size - len, " (memory node unknown)");
+    }
+}
@@ -0,0 +1,108 @@
+/**
+ *  \file affinity.h (interface file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief Placement of the intervening entities on the processors.
+ *
+ *  The generator may pin every intervening entity to a processor of its own choice (option <tt>-a</tt>), so that
+ *  the latency of the handshakes of a match does not depend on where the scheduler puts the entities, and place
+ *  the shared region on the memory node of those processors. The policies are:
+ *     \li <tt>compact</tt>: the processors that share the last level cache of the first processor the generator
+ *         may run on, so that the handshakes do not leave that cache
+ *     \li <tt>spread</tt>: every processor the generator may run on, taking each last level cache in turn
+ *     \li a processor list, as in <tt>0,2,4-7</tt>.
+ *
+ *  Entity <tt>e</tt> (players, then goalies, then referees, then the logger) runs on processor <tt>e mod n</tt>
+ *  of the <tt>n</tt> processors of the placement, in the order of the policy. The topology is read from
+ *  <tt>/sys/devices/system/cpu</tt>; where it is not available, compact and spread take the processors in order.
+ *
+ *  Defined operations:
+ *     \li setting up the placement
+ *     \li querying whether the entities are placed
+ *     \li processor set of an entity
+ *     \li pinning of the calling thread
+ *     \li restoring the processor set of the calling thread
+ *     \li placement of a region on the memory node
+ *     \li description of the placement.
+ */
+
+#ifndef AFFINITY_H_
+#define AFFINITY_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sched.h>                                                     /* cpu_set_t, with _GNU_SOURCE defined */
+
+/**
+ *  \brief Setting up the placement.
+ *
+ *  Resolves the policy against the processors the calling process may run on, that are kept so that they can be
+ *  restored.
+ *
+ *  \param policy <tt>compact</tt>, <tt>spread</tt> or a processor list
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when the policy is wrong or names a processor the process may not run on (<tt>errno</tt> is set
+ *          to <tt>EINVAL</tt>), or when the processors can not be queried
+ */
+extern int affinityInit (const char *policy);
+
+/**
+ *  \brief Querying whether the entities are placed.
+ *
+ *  \return \c true, if a placement was set up
+ */
+extern bool affinityOn (void);
+
+/**
+ *  \brief Processor set of an entity.
+ *
+ *  \param e entity index
+ *  \param set pointer to the location where the set, of a single processor, is stored
+ */
+extern void affinityMask (int e, cpu_set_t *set);
+
+/**
+ *  \brief Pinning of the calling thread to the processor of an entity.
+ *
+ *  The processes generated afterwards inherit it.
+ *
+ *  \param e entity index
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+extern int affinityPin (int e);
+
+/**
+ *  \brief Restoring the processor set of the calling thread, as it was when the placement was set up.
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+extern int affinityRestore (void);
+
+/**
+ *  \brief Placement of a region on the memory node of the processors.
+ *
+ *  The pages of the region are preferably allocated on the node of the first processor of the placement, and
+ *  those already allocated are moved there. It does nothing if the node is not known.
+ *
+ *  \param addr start of the region
+ *  \param len size of the region
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+extern int affinityBind (void *addr, size_t len);
+
+/**
+ *  \brief Description of the placement, as the policy, the processors in order and the memory node.
+ *
+ *  \param desc pointer to the location where the description is stored
+ *  \param size size of that location
+ */
+extern void affinityDescribe (char desc[], size_t size);
+
+#endif /* AFFINITY_H_ */
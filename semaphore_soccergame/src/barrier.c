@@ -0,0 +1,123 @@
+/**
+ *  \file barrier.c (implementation file)
+ *
+ *  \brief Broadcast barrier management.
+ *
+ *  A barrier lets one process (the releaser) wake a group of waiting processes with a single operation and
+ *  then be notified once, by the last of them, when all have arrived at a given point.
+ *
+ *  Operations defined on barriers:
+ *     \li initialization
+ *     \li arming for a group of arrivals
+ *     \li release of a group of waiting processes
+ *     \li waiting for the release
+ *     \li arrival
+ *     \li collection of the arrivals.
+ */
+
+#include <stdio.h>
+#include <stdatomic.h>
+#include <assert.h>
+
+#include "semaphore.h"
+#include "barrier.h"
+
+/**
+ *  \brief Initialization of a barrier.
+ *
+ *  \param b pointer to the barrier
+ *  \param wait identification of the release semaphore (0 if the group is never released on it)
+ *  \param done identification of the last arrival semaphore (0 if arrivals are never collected)
+ */
+void barrierInit (BARRIER *b, unsigned int wait, unsigned int done)
+{
+  atomic_init (&b->gen, 0);
+  atomic_init (&b->arrived, 0);
+  atomic_init (&b->expected, 0);
+  b->wait = wait;
+  b->done = done;
+}
+
+/**
+ *  \brief Arming of a barrier for a group of arrivals.
+ *
+ *  Must be called by the releaser before the processes that will arrive are woken up.
+ *
+ *  \param b pointer to the barrier
+ *  \param n number of arrivals that complete the generation
+ */
+void barrierArm (BARRIER *b, int n)
+{
+  assert(n>0);
+  atomic_store (&b->expected, n);
+}
+
+/**
+ *  \brief Release of a group of waiting processes.
+ *
+ *  Arms the barrier for <tt>n</tt> arrivals and wakes <tt>n</tt> processes waiting on it, in a single call.
+ *
+ *  \param semgid semaphore set identifier
+ *  \param b pointer to the barrier
+ *  \param n number of processes to release
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+int barrierRelease (int semgid, BARRIER *b, int n)
+{
+  barrierArm (b, n);
+  return semUpN (semgid, b->wait, (unsigned int) n);
+}
+
+/**
+ *  \brief Waiting for the release.
+ *
+ *  \param semgid semaphore set identifier
+ *  \param b pointer to the barrier
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+int barrierWait (int semgid, BARRIER *b)
+{
+  return semDown (semgid, b->wait);
+}
+
+/**
+ *  \brief Arrival.
+ *
+ *  The last arrival of the generation starts a new generation and notifies the releaser.
+ *
+ *  \param semgid semaphore set identifier
+ *  \param b pointer to the barrier
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+int barrierArrive (int semgid, BARRIER *b)
+{
+  assert(b->done>0);
+  if (atomic_fetch_add (&b->arrived, 1) + 1 < atomic_load (&b->expected))
+     return 0;                                                                              /* not the last one */
+  atomic_store (&b->arrived, 0);
+  atomic_fetch_add (&b->gen, 1);
+  return semUp (semgid, b->done);
+}
+
+/**
+ *  \brief Collection of the arrivals.
+ *
+ *  The releaser blocks until the last arrival of the generation.
+ *
+ *  \param semgid semaphore set identifier
+ *  \param b pointer to the barrier
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+int barrierCollect (int semgid, BARRIER *b)
+{
+  assert(b->done>0);
+  return semDown (semgid, b->done);
+}
@@ -0,0 +1,124 @@
+/**
+ *  \file barrier.h (interface file)
+ *
+ *  \brief Broadcast barrier management.
+ *
+ *  A barrier lets one process (the releaser) wake a group of waiting processes with a single operation and
+ *  then be notified once, by the last of them, when all have arrived at a given point. It lives in shared
+ *  memory and is built on top of two semaphores of a set:
+ *     \li <tt>wait</tt>, where the processes of the group block until they are released
+ *     \li <tt>done</tt>, where the releaser blocks until the last arrival.
+ *
+ *  Arrivals are counted with atomic operations, so only the last one enters the kernel. The generation
+ *  counter is incremented each time a group completes, which allows the barrier to be reused.
+ *
+ *  Operations defined on barriers:
+ *     \li initialization
+ *     \li arming for a group of arrivals
+ *     \li release of a group of waiting processes
+ *     \li waiting for the release
+ *     \li arrival
+ *     \li collection of the arrivals.
+ */
+
+#ifndef BARRIER_H_
+#define BARRIER_H_
+
+#include <stdatomic.h>
+
+#include "cacheLine.h"
+
+/**
+ *  \brief Definition of <em>barrier</em> data type.
+ */
+typedef struct
+        { /** \brief number of completed generations (the barrier takes cache lines of its own in the padded
+                      layout) */
+          LINEALIGNED atomic_uint gen;
+          /** \brief number of arrivals in the current generation */
+          atomic_int arrived;
+          /** \brief number of arrivals that complete the current generation */
+          atomic_int expected;
+          /** \brief identification of semaphore where the group waits to be released – val = 0 */
+          unsigned int wait;
+          /** \brief identification of semaphore where the releaser waits for the last arrival – val = 0 */
+          unsigned int done;
+        } BARRIER;
+
+/**
+ *  \brief Initialization of a barrier.
+ *
+ *  \param b pointer to the barrier
+ *  \param wait identification of the release semaphore (0 if the group is never released on it)
+ *  \param done identification of the last arrival semaphore (0 if arrivals are never collected)
+ */
+
+extern void barrierInit (BARRIER *b, unsigned int wait, unsigned int done);
+
+/**
+ *  \brief Arming of a barrier for a group of arrivals.
+ *
+ *  Must be called by the releaser before the processes that will arrive are woken up.
+ *
+ *  \param b pointer to the barrier
+ *  \param n number of arrivals that complete the generation
+ */
+
+extern void barrierArm (BARRIER *b, int n);
+
+/**
+ *  \brief Release of a group of waiting processes.
+ *
+ *  Arms the barrier for <tt>n</tt> arrivals and wakes <tt>n</tt> processes waiting on it, in a single call.
+ *
+ *  \param semgid semaphore set identifier
+ *  \param b pointer to the barrier
+ *  \param n number of processes to release
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int barrierRelease (int semgid, BARRIER *b, int n);
+
+/**
+ *  \brief Waiting for the release.
+ *
+ *  \param semgid semaphore set identifier
+ *  \param b pointer to the barrier
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int barrierWait (int semgid, BARRIER *b);
+
+/**
+ *  \brief Arrival.
+ *
+ *  The last arrival of the generation starts a new generation and notifies the releaser.
+ *
+ *  \param semgid semaphore set identifier
+ *  \param b pointer to the barrier
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int barrierArrive (int semgid, BARRIER *b);
+
+/**
+ *  \brief Collection of the arrivals.
+ *
+ *  The releaser blocks until the last arrival of the generation.
+ *
+ *  \param semgid semaphore set identifier
+ *  \param b pointer to the barrier
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int barrierCollect (int semgid, BARRIER *b);
+
+#endif /* BARRIER_H_ */
@@ -0,0 +1,25 @@
+/**
+ *  \file cacheLine.h (interface file)
+ *
+ *  \brief Layout of the data shared among processes.
+ *
+ *  By default the shared data is packed. In the padded layout (<tt>make LAYOUT=padded</tt>, which defines
+ *  <tt>SOCCER_PADDED</tt>), the fields that different processes write concurrently start cache lines of their
+ *  own, as do the synchronization devices, so that a write on one of them does not invalidate the line of the
+ *  others on the other cores (false sharing), and the state of each entity takes a single byte.
+ */
+
+#ifndef CACHELINE_H_
+#define CACHELINE_H_
+
+/** \brief size of a cache line (bytes) */
+#define  CACHELINE        64
+
+/** \brief the field it precedes starts a cache line, in the padded layout */
+#ifdef SOCCER_PADDED
+#define  LINEALIGNED      _Alignas (CACHELINE)
+#else
+#define  LINEALIGNED
+#endif
+
+#endif /* CACHELINE_H_ */
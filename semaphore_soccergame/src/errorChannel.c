@@ -0,0 +1,211 @@
+/**
+ *  \file errorChannel.c (implementation file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief Channel of the diagnostics of the intervening entities.
+ *
+ *  The collector is a child process of the generator, generated before anything else, that reads the pipe until
+ *  every end of it is closed, so that the diagnostics of the entities are still written if the generator
+ *  terminates early. The stream of an entity is a custom one (<tt>fopencookie</tt>), so that it tags every line
+ *  and writes it into the pipe with a single system call.
+ *
+ *  Defined operations:
+ *     \li starting the collection of the diagnostics
+ *     \li ending the collection of the diagnostics
+ *     \li redirection of the diagnostics of an entity.
+ */
+
+#define _GNU_SOURCE                                                                     /* pipe2, fopencookie */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "errorChannel.h"
+
+/** \brief size of the chunks the collector reads from the pipe */
+#define  CHUNKSIZE      65536
+
+/** \brief end of the pipe held by the generator - -1 if the diagnostics are not collected */
+static int errFd = -1;
+
+/** \brief collector process */
+static pid_t collector = -1;
+
+/** \brief stream of the diagnostics of an entity, when they are collected */
+static struct
+       { /** \brief end of the pipe */
+         int fd;
+         /** \brief name of the entity, that tags every line */
+         char tag[16];
+         /** \brief the next byte written starts a line */
+         bool lineStart;
+       } chan;
+
+/** \brief life cycle of the collector: the pipe is drained into the file, that is created on the first
+           diagnostic */
+static void collect (int fd, const char *fileName)
+{
+    static char buf[CHUNKSIZE];
+    ssize_t n, w, k;
+    int out = -1;
+
+    signal (SIGINT, SIG_IGN);                               /* the terminal signals the whole process group */
+    signal (SIGQUIT, SIG_IGN);
+    while ((n = read (fd, buf, sizeof (buf))) != 0) {
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror ("error on reading the diagnostics");
+            _exit (EXIT_FAILURE);
+        }
+        if ((out == -1) && ((out = open (fileName, O_WRONLY | O_CREAT | O_TRUNC, 0666)) == -1)) {
+            perror ("error on creating the file of the diagnostics");
+            _exit (EXIT_FAILURE);
+        }
+        for (k = 0; k < n; k += w) {
+            if ((w = write (out, buf + k, (size_t) (n - k))) == -1) {
+                perror ("error on writing the diagnostics");
+                _exit (EXIT_FAILURE);
+            }
+        }
+    }
+    _exit (EXIT_SUCCESS);
+}
+
+/**
+ *  \brief Starting the collection of the diagnostics.
+ *
+ *  The pipe is created, the collector process is generated and the end of the pipe is exported in
+ *  <tt>ERRENV</tt> for the entities generated afterwards. It must be called before any other process or pipe is
+ *  created, so that the collector does not hold them.
+ *
+ *  \param fileName name of the file of the diagnostics
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+int errorCollect (const char *fileName)
+{
+    int fds[2];
+    char fdStr[16];
+
+    if (pipe2 (fds, O_CLOEXEC) == -1) {
+        return -1;
+    }
+    if ((unlink (fileName) == -1) && (errno != ENOENT)) {              /* the file is left by a previous run */
+        close (fds[0]);
+        close (fds[1]);
+        return -1;
+    }
+    fflush (NULL);                                              /* nothing buffered is written twice */
+    if ((collector = fork ()) == -1) {
+        close (fds[0]);
+        close (fds[1]);
+        return -1;
+    }
+    if (collector == 0) {
+        close (fds[1]);
+        collect (fds[0], fileName);
+    }
+    close (fds[0]);
+    if (fcntl (fds[1], F_SETFD, 0) == -1) {                          /* the entities inherit the end of the pipe */
+        close (fds[1]);
+        return -1;
+    }
+    sprintf (fdStr, "%d", fds[1]);
+    if (setenv (ERRENV, fdStr, 1) == -1) {
+        close (fds[1]);
+        return -1;
+    }
+    errFd = fds[1];
+    return 0;
+}
+
+/**
+ *  \brief Ending the collection of the diagnostics.
+ *
+ *  The generator closes its end of the pipe and waits for the collector to write what is left. It must be
+ *  called once every entity has terminated; it does nothing if the diagnostics are not collected.
+ */
+void errorCollectEnd (void)
+{
+    if (errFd == -1) {
+        return;
+    }
+    close (errFd);
+    errFd = -1;
+    while ((waitpid (collector, NULL, 0) == -1) && (errno == EINTR)) {
+        ;
+    }
+}
+
+/** \brief writing into the pipe of the diagnostics: every line is tagged and written with a single system call,
+           so that it is not mixed up with those of other entities */
+static ssize_t chanWrite (void *cookie, const char *buf, size_t size)
+{
+    static char out[PIPE_BUF];
+    const char *nl;
+    size_t k, n, len;
+    ssize_t w;
+
+    (void) cookie;
+    for (k = 0; k < size; k += len) {
+        n = chan.lineStart ? (size_t) snprintf (out, sizeof (out), "%s: ", chan.tag) : 0;
+        nl = memchr (buf + k, '\n', size - k);
+        len = (nl != NULL) ? (size_t) (nl - (buf + k)) + 1 : size - k;
+        if (len > sizeof (out) - n) {                                         /* a long line is split */
+            len = sizeof (out) - n;
+        }
+        memcpy (out + n, buf + k, len);
+        chan.lineStart = (out[n + len - 1] == '\n');
+        while ((w = write (chan.fd, out, n + len)) == -1) {
+            if (errno != EINTR) {
+                return -1;
+            }
+        }
+    }
+    return (ssize_t) size;
+}
+
+/**
+ *  \brief Redirection of the diagnostics of an entity.
+ *
+ *  If the diagnostics are collected, stderr is replaced by a line buffered stream that tags every line with the
+ *  name of the entity (the error file name, without the <tt>error_</tt> prefix) and writes it into the pipe;
+ *  otherwise stderr is redirected, unbuffered, to the error file.
+ *
+ *  \param name name of the error file of the entity
+ */
+void errorRedirect (const char *name)
+{
+    static char buf[PIPE_BUF];
+    cookie_io_functions_t io = { .read = NULL, .write = chanWrite, .seek = NULL, .close = NULL };
+    char *fdStr, *end;
+    FILE *fp;
+
+    if ((fdStr = getenv (ERRENV)) != NULL) {
+        chan.fd = (int) strtol (fdStr, &end, 10);
+        if ((end != fdStr) && (*end == '\0') && (fcntl (chan.fd, F_GETFD) != -1)) {
+            snprintf (chan.tag, sizeof (chan.tag), "%s", (strncmp (name, "error_", 6) == 0) ? name + 6 : name);
+            chan.lineStart = true;
+            if ((fp = fopencookie (NULL, "w", io)) != NULL) {
+                setvbuf (fp, buf, _IOLBF, sizeof (buf));
+                stderr = fp;
+                return;
+            }
+        }
+    }
+    freopen (name, "w", stderr);                                 /* the diagnostics are not collected */
+    setbuf (stderr, NULL);
+}
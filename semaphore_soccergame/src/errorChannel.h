@@ -0,0 +1,62 @@
+/**
+ *  \file errorChannel.h (interface file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief Channel of the diagnostics of the intervening entities.
+ *
+ *  By default every entity redirects its stderr, unbuffered, to an error file of its own (<tt>error_PL00</tt>,
+ *  ...), that is created whether the entity reports anything or not. The generator may instead collect the
+ *  diagnostics of every entity (option <tt>-e</tt>): the entities write them, one line at a time and tagged by
+ *  the name of the entity, into a single pipe whose end they inherit, and a collector process drains it in large
+ *  chunks into a single file, that is only created once something is reported. The lines of different entities
+ *  are not mixed up, as long as they are at most <tt>PIPE_BUF</tt> bytes long.
+ *
+ *  The inherited end of the pipe is passed to the entities in the <tt>ERRENV</tt> environment variable.
+ *
+ *  Defined operations:
+ *     \li starting the collection of the diagnostics
+ *     \li ending the collection of the diagnostics
+ *     \li redirection of the diagnostics of an entity.
+ */
+
+#ifndef ERRORCHANNEL_H_
+#define ERRORCHANNEL_H_
+
+/** \brief environment variable holding the end of the pipe of the diagnostics, when they are collected */
+#define  ERRENV         "SOCCER_ERRFD"
+
+/**
+ *  \brief Starting the collection of the diagnostics.
+ *
+ *  The pipe is created, the collector process is generated and the end of the pipe is exported in
+ *  <tt>ERRENV</tt> for the entities generated afterwards. It must be called before any other process or pipe is
+ *  created, so that the collector does not hold them.
+ *
+ *  \param fileName name of the file of the diagnostics
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+extern int errorCollect (const char *fileName);
+
+/**
+ *  \brief Ending the collection of the diagnostics.
+ *
+ *  The generator closes its end of the pipe and waits for the collector to write what is left. It must be
+ *  called once every entity has terminated; it does nothing if the diagnostics are not collected.
+ */
+extern void errorCollectEnd (void);
+
+/**
+ *  \brief Redirection of the diagnostics of an entity.
+ *
+ *  If the diagnostics are collected, stderr is replaced by a line buffered stream that tags every line with the
+ *  name of the entity (the error file name, without the <tt>error_</tt> prefix) and writes it into the pipe;
+ *  otherwise stderr is redirected, unbuffered, to the error file.
+ *
+ *  \param name name of the error file of the entity
+ */
+extern void errorRedirect (const char *name);
+
+#endif /* ERRORCHANNEL_H_ */
@@ -0,0 +1,271 @@
+/**
+ *  \file logDecoder.c (implementation file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  Decoder of binary logging files.
+ *
+ *  The file is mapped onto the process address space and turned back into the text view written by
+ *  <tt>logging.c</tt> or into the filtered view produced by <tt>filter_log.awk</tt>, where the states that did
+ *  not change since the previous line are shown as '.'. The separators between the runs of a batch are turned back
+ *  into the lines that announce each run.
+ *
+ *  Upon execution, one parameter is requested:
+ *    \li name of the binary logging file.
+ *
+ *  Options:
+ *    \li <tt>-f</tt>: filtered view.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "probConst.h"
+#include "probDataStruct.h"
+#include "logging.h"
+
+/** \brief size of the output buffer (bytes) */
+#define  OUTBUFSIZE     (1 << 20)
+
+/** \brief output buffer */
+static char outBuf[OUTBUFSIZE];
+
+/** \brief number of bytes stored in the output buffer */
+static size_t outLen = 0;
+
+/** \brief flushing the output buffer to stdout */
+static void flushOut (void)
+{
+    if (fwrite (outBuf, 1, outLen, stdout) != outLen) {
+        perror ("error on writing the decoded log");
+        exit (EXIT_FAILURE);
+    }
+    outLen = 0;
+}
+
+/** \brief right-justified field of the given width, followed by a blank if <tt>sep</tt> is set */
+static void putField (const char *val, int len, int width, bool sep)
+{
+    int i;
+
+    for (i = len; i < width; i++) {
+        outBuf[outLen++] = ' ';
+    }
+    memcpy (outBuf + outLen, val, (size_t) len);
+    outLen += (size_t) len;
+    if (sep) {
+        outBuf[outLen++] = ' ';
+    }
+}
+
+/** \brief width of a column of the text view (see logColWidth) */
+static int colWidth (LOG_BIN_HDR *hdr)
+{
+    return logColWidth (hdr->nPlayers, hdr->nGoalies, hdr->nReferees);
+}
+
+/** \brief width of field <tt>i</tt> in the filtered view: first goalie and first referee absorb the group blank */
+static int filteredWidth (LOG_BIN_HDR *hdr, int i)
+{
+    return colWidth (hdr) + (((i == hdr->nPlayers) || (i == hdr->nPlayers + hdr->nGoalies)) ? 1 : 0);
+}
+
+/** \brief name of an entity in the column header, as a field of the given width (see putField) */
+static void putName (char kind, int d, int num, int width, bool sep)
+{
+    char name[d + 2];                                                      /* kind, d digits and the terminator */
+    int n;
+
+    if (outLen + (size_t) width + 2 > OUTBUFSIZE) {
+        flushOut ();
+    }
+    if ((n = snprintf (name, sizeof (name), "%c%0*d", kind, d, num)) >= (int) sizeof (name)) {
+        n = (int) sizeof (name) - 1;
+    }
+    putField (name, n, width, sep);
+}
+
+/** \brief title, shape of the teams and column header, as written by createLog (or by filter_log.awk in the filtered view) */
+static void putHeader (LOG_BIN_HDR *hdr, bool filtered)
+{
+    int i, width = hdr->nPlayers + hdr->nGoalies + hdr->nReferees, w = colWidth (hdr), d = w - 2;
+
+    outLen += (size_t) sprintf (outBuf + outLen, "%21cSoccerGame - Description of the internal state\n", ' ');
+    outLen += (size_t) sprintf (outBuf + outLen, LOG_TEAMS "\n", hdr->nTeams, hdr->teamPlayers, hdr->teamGoalies,
+                                hdr->split ? LOG_SPLIT : "");
+    if (filtered) {
+        for (i = 0; i < width; i++) {
+            if (i < hdr->nPlayers) {
+                putName ('P', d, i, filteredWidth (hdr, i), true);
+            }
+            else if (i < hdr->nPlayers + hdr->nGoalies) {
+                putName ('G', d, i - hdr->nPlayers, filteredWidth (hdr, i), true);
+            }
+            else putName ('R', d, i - hdr->nPlayers - hdr->nGoalies + 1, filteredWidth (hdr, i), true);
+        }
+    }
+    else {
+        for (i = 0; i < hdr->nPlayers; i++) {
+            putName ('P', d, i, w, false);
+        }
+        outBuf[outLen++] = ' ';
+        for (i = 0; i < hdr->nGoalies; i++) {
+            putName ('G', d, i, w, false);
+        }
+        outBuf[outLen++] = ' ';
+        for (i = 0; i < hdr->nReferees; i++) {
+            putName ('R', d, i + 1, w, false);
+        }
+        outBuf[outLen++] = ' ';
+    }
+    outBuf[outLen++] = '\n';
+}
+
+/** \brief one record in the text view */
+static void putRecord (LOG_BIN_HDR *hdr, const char *rec)
+{
+    int i, width = hdr->nPlayers + hdr->nGoalies + hdr->nReferees, w = colWidth (hdr);
+
+    for (i = 0; i < width; i++) {
+        if ((i == hdr->nPlayers) || (i == hdr->nPlayers + hdr->nGoalies)) {
+            outBuf[outLen++] = ' ';
+        }
+        putField (rec + i, 1, w, false);
+    }
+    outBuf[outLen++] = '\n';
+}
+
+/** \brief one record in the filtered view; <tt>prev</tt> is NULL for the first record */
+static void putFiltered (LOG_BIN_HDR *hdr, const char *rec, const char *prev)
+{
+    int i, width = hdr->nPlayers + hdr->nGoalies + hdr->nReferees;
+
+    for (i = 0; i < width; i++) {
+        putField (((prev != NULL) && (rec[i] == prev[i])) ? "." : rec + i, 1, filteredWidth (hdr, i), true);
+    }
+    outBuf[outLen++] = '\n';
+}
+
+/** \brief seed and arrival delays of a match, as written by logDelays (filter_log.awk passes them unchanged) */
+static void putDelays (LOG_BIN_HDR *hdr, const uint32_t *blk)
+{
+    int i, width = hdr->nPlayers + hdr->nGoalies + hdr->nReferees, w = colWidth (hdr);
+
+    outLen += (size_t) sprintf (outBuf + outLen, "Seed %u - arrival delays (us)\n", (unsigned int) blk[0]);
+    for (i = 0; i < width; i++) {
+        if ((i == hdr->nPlayers) || (i == hdr->nPlayers + hdr->nGoalies)) {
+            outBuf[outLen++] = ' ';
+        }
+        outLen += (size_t) sprintf (outBuf + outLen, "%*u", w, (unsigned int) blk[i + 1]);
+    }
+    outBuf[outLen++] = '\n';
+}
+
+/**
+ *  \brief Main program.
+ *
+ *  Its role is to decode a binary logging file to stdout.
+ */
+int main (int argc, char *argv[])
+{
+    bool filtered = false;                                                                     /* filtered view flag */
+    int opt;                                                                                       /* command option */
+    int fd;                                                                                   /* file descriptor */
+    struct stat st;                                                                               /* file status */
+    char *base;                                                                          /* mapped logging file */
+    LOG_BIN_HDR hdr;                                                                                 /* file header */
+    const char *prev;                                                                /* previous record, if any */
+    uint32_t *delays;                                                        /* seed and delays of a match */
+    size_t blkSize;                                                                    /* size of seed and delays */
+    int run = 0;                                                                          /* number of the run */
+    size_t width, off;                                                          /* record width, current offset */
+
+    while ((opt = getopt (argc, argv, "f")) != -1) {
+        switch (opt) {
+            case 'f':
+                filtered = true;
+                break;
+            default:
+                fprintf (stderr, "Usage: %s [-f] logfile\n", argv[0]);
+                exit (EXIT_FAILURE);
+        }
+    }
+    if (optind != argc - 1) {
+        fprintf (stderr, "Usage: %s [-f] logfile\n", argv[0]);
+        exit (EXIT_FAILURE);
+    }
+
+    /* mapping the logging file */
+    if ((fd = open (argv[optind], O_RDONLY)) == -1) {
+        perror ("error on opening the logging file");
+        exit (EXIT_FAILURE);
+    }
+    if (fstat (fd, &st) == -1) {
+        perror ("error on getting the logging file status");
+        exit (EXIT_FAILURE);
+    }
+    if ((size_t) st.st_size < sizeof (hdr)) {
+        fprintf (stderr, "%s is not a binary logging file\n", argv[optind]);
+        exit (EXIT_FAILURE);
+    }
+    if ((base = mmap (NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED) {
+        perror ("error on mapping the logging file");
+        exit (EXIT_FAILURE);
+    }
+    madvise (base, (size_t) st.st_size, MADV_SEQUENTIAL);
+
+    memcpy (&hdr, base, sizeof (hdr));
+    if ((memcmp (hdr.magic, LOG_MAGIC, sizeof (hdr.magic)) != 0) || (hdr.version != LOG_VERSION)) {
+        fprintf (stderr, "%s is not a binary logging file\n", argv[optind]);
+        exit (EXIT_FAILURE);
+    }
+    width = (size_t) hdr.nPlayers + hdr.nGoalies + hdr.nReferees;
+    blkSize = (width + 1) * sizeof (uint32_t);
+    if ((delays = malloc (blkSize)) == NULL) {
+        perror ("error on allocating the arrival delays");
+        exit (EXIT_FAILURE);
+    }
+
+    /* decoding */
+    putHeader (&hdr, filtered);
+    for (off = sizeof (hdr), prev = NULL; off + width <= (size_t) st.st_size; off += width) {
+        if (outLen + (size_t) (colWidth (&hdr) + 2) * width + 32 > OUTBUFSIZE) {
+            flushOut ();
+        }
+        if (base[off] == LOG_END) {                                                    /* separator between runs */
+            outLen += (size_t) sprintf (outBuf + outLen, "\nRun %d\n", ++run);
+            prev = NULL;
+            continue;
+        }
+        if (base[off] == LOG_DELAYS) {                             /* seed and arrival delays of the next match */
+            if (off + width + blkSize > (size_t) st.st_size) {
+                break;
+            }
+            memcpy (delays, base + off + width, blkSize);          /* the block is not aligned in the file */
+            putDelays (&hdr, delays);
+            off += blkSize;
+            prev = NULL;
+            continue;
+        }
+        if (filtered) {
+            putFiltered (&hdr, base + off, prev);
+        }
+        else putRecord (&hdr, base + off);
+        prev = base + off;
+    }
+    flushOut ();
+    free (delays);
+
+    munmap (base, (size_t) st.st_size);
+    close (fd);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,577 @@
+/**
+ *  \file logValidator.c (implementation file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  Validator of logging files.
+ *
+ *  Every run of each logging file, in the text format written by <tt>logging.c</tt> or in the binary format, is
+ *  checked against the protocol of the match:
+ *    \li the run starts with every entity arriving
+ *    \li each state change of a player, goalie or referee is a transition of its life cycle
+ *    \li players and goalies only play once a referee started their match, and a referee only referees once every
+ *        player and goalie of its match plays
+ *    \li at the end of the run every referee ended its match, the teams of each match are complete (team one and
+ *        team two) and the players and goalies that were not needed are late.
+ *
+ *  The file is mapped onto the process address space and each record is compared with the previous one eight
+ *  bytes at a time, so that only the columns that changed are decoded; the violations are reported with the run
+ *  and the line of the file (the record, in the binary format). The columns of the state records of the text
+ *  format are at fixed positions, as are the bytes of the binary records. The shape of the teams is read from the
+ *  header of the file. Split logging files (option <tt>-s</tt> of the generator), that the header tells, do not
+ *  hold whole matches and are not validated.
+ *
+ *  Upon execution, the names of the logging files are requested.
+ *
+ *  Options, for the text logging files whose header does not hold the shape of the teams:
+ *    \li <tt>-t n</tt>: number of teams in each match (default <tt>NUMTEAMS</tt>)
+ *    \li <tt>-P n</tt>: number of players in each team (default <tt>NUMTEAMPLAYERS</tt>)
+ *    \li <tt>-G n</tt>: number of goalies in each team (default <tt>NUMTEAMGOALIES</tt>)
+ *    \li <tt>-q</tt>: quiet - only the summary of each file is printed.
+ *
+ *  The exit status is a failure if a violation was found.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "probConst.h"
+#include "probDataStruct.h"
+#include "logging.h"
+
+/** \brief number of violations reported for a run, the others are only counted */
+#define  MAXREPORTS     5
+
+/**
+ *  \brief Definition of <em>run under validation</em> data type.
+ */
+typedef struct
+{   /** \brief number of the run (from 1) */
+    int run;
+
+    /** \brief previous state record of the run - NULL before the first one */
+    const char *prev;
+
+    /** \brief line (record) of the previous state record */
+    unsigned long prevLine;
+
+    /** \brief number of players and goalies that play */
+    int playing;
+
+    /** \brief number of referees that started their match (or went further) */
+    int started;
+
+    /** \brief number of referees that referee their match (or ended it) */
+    int refereeing;
+
+    /** \brief number of violations found */
+    int errors;
+
+} RUN;
+
+/** \brief number of players, goalies and referees of the file being validated */
+static int nPlayers, nGoalies, nReferees;
+
+/** \brief number of teams in each match, of players and of goalies in each team, of the file being validated */
+static int nTeams, teamPlayers, teamGoalies;
+
+/** \brief shape of the teams of the files whose header does not hold it (options) */
+static int optTeams = NUMTEAMS, optPlayers = NUMTEAMPLAYERS, optGoalies = NUMTEAMGOALIES;
+
+/** \brief only the summary of each file is printed */
+static bool quiet = false;
+
+/** \brief name of the file being validated */
+static const char *fName;
+
+/** \brief width of a record (bytes, the end of line included in the text format) */
+static size_t width;
+
+/** \brief entity of each byte of a record - -1 for the blanks of the text format */
+static int *column;
+
+/** \brief width of a column of the text format (see logColWidth) */
+static int colW = 4;
+
+/** \brief name of entity e, as in the column header */
+static void entityName (char name[], int e)
+{
+    if (e < nPlayers) {
+        sprintf (name, "P%0*d", colW - 2, e);
+    }
+    else if (e < nPlayers + nGoalies) {
+        sprintf (name, "G%0*d", colW - 2, e - nPlayers);
+    }
+    else sprintf (name, "R%0*d", colW - 2, e - nPlayers - nGoalies + 1);
+}
+
+/** \brief reporting a violation of the run at the given line */
+static void violation (RUN *r, unsigned long line, const char *what, int e, char from, char to)
+{
+    char name[16];
+
+    if ((r->errors++ >= MAXREPORTS) || quiet) {
+        return;
+    }
+    if (e < 0) {
+        printf ("%s: run %d, line %lu: %s\n", fName, r->run, line, what);
+        return;
+    }
+    entityName (name, e);
+    printf ("%s: run %d, line %lu: %s %s (%c -> %c)\n", fName, r->run, line, what, name, from, to);
+}
+
+/** \brief the change of a player or goalie from <tt>from</tt> to <tt>to</tt> is a transition of its life cycle */
+static bool playerMove (char from, char to)
+{
+    switch (from) {
+        case ARRIVING:
+            return (to == LATE) || (to == FORMING_TEAM) || (to == WAITING_TEAM);
+        case FORMING_TEAM:
+        case WAITING_TEAM:
+            return (to == WAITING_START_1) || (to == WAITING_START_2);
+        case WAITING_START_1:
+            return to == PLAYING_1;
+        case WAITING_START_2:
+            return to == PLAYING_2;
+        default:
+            return false;                                                    /* late and playing are final */
+    }
+}
+
+/** \brief the change of a referee from <tt>from</tt> to <tt>to</tt> is a transition of its life cycle */
+static bool refereeMove (char from, char to)
+{
+    switch (from) {
+        case ARRIVINGR:
+            return to == WAITING_TEAMS;
+        case WAITING_TEAMS:
+            return to == STARTING_GAME;
+        case STARTING_GAME:
+            return to == REFEREEING;
+        case REFEREEING:
+            return to == ENDING_GAME;
+        default:
+            return false;
+    }
+}
+
+/** \brief state <tt>s</tt> of a player or goalie is a playing one */
+static bool isPlaying (char s)
+{
+    return (s == PLAYING_1) || (s == PLAYING_2);
+}
+
+/**
+ *  \brief Validating a state record of a run.
+ *
+ *  The first record is checked in full; each of the others is compared with the previous one a word at a time and
+ *  only the entities whose column changed are checked.
+ *
+ *  \param r run under validation
+ *  \param rec state record
+ *  \param line line (record) of the file
+ */
+static void checkRecord (RUN *r, const char *rec, unsigned long line)
+{
+    int perMatch = nTeams * (teamPlayers + teamGoalies);                /* players and goalies of a match */
+    bool played = false, refereed = false;           /* an entity started playing, a referee started refereeing */
+    size_t pos, b, n;
+    uint64_t cur, prev;
+    int e;
+
+    if (r->prev == NULL) {                                                            /* every entity arrives */
+        for (pos = 0; pos < width; pos++) {
+            if (((e = column[pos]) >= 0) && (rec[pos] != ((e < nPlayers + nGoalies) ? ARRIVING : ARRIVINGR))) {
+                violation (r, line, "initial state of", e, ARRIVING, rec[pos]);
+            }
+        }
+        r->prev = rec;
+        r->prevLine = line;
+        return;
+    }
+
+    for (pos = 0; pos < width; pos += 8) {
+        n = (width - pos < 8) ? width - pos : 8;
+        cur = prev = 0;
+        memcpy (&cur, rec + pos, n);
+        memcpy (&prev, r->prev + pos, n);
+        if (cur == prev) {                                             /* the usual case: no column changed */
+            continue;
+        }
+        for (b = pos; b < pos + n; b++) {
+            char from = r->prev[b], to = rec[b];
+            if ((from == to) || ((e = column[b]) < 0)) {
+                continue;
+            }
+            if (e < nPlayers + nGoalies) {
+                if (!playerMove (from, to)) {
+                    violation (r, line, "invalid transition of", e, from, to);
+                }
+                if (isPlaying (to) && !isPlaying (from)) {
+                    r->playing++;
+                    played = true;
+                }
+            }
+            else {
+                if (!refereeMove (from, to)) {
+                    violation (r, line, "invalid transition of", e, from, to);
+                }
+                if ((to == STARTING_GAME) || (to == REFEREEING) || (to == ENDING_GAME)) {
+                    r->started += (from == ARRIVINGR) || (from == WAITING_TEAMS);
+                }
+                if ((to == REFEREEING) || (to == ENDING_GAME)) {
+                    r->refereeing += (from != REFEREEING);
+                    refereed = refereed || (to == REFEREEING);
+                }
+            }
+        }
+    }
+    if (played && (r->playing > r->started * perMatch)) {
+        violation (r, line, "players or goalies play before their match is started", -1, 0, 0);
+    }
+    if (refereed && (r->playing < r->refereeing * perMatch)) {
+        violation (r, line, "a referee referees before every player and goalie of the match plays", -1, 0, 0);
+    }
+    r->prev = rec;
+    r->prevLine = line;
+}
+
+/**
+ *  \brief Validating the end of a run.
+ *
+ *  \param r run under validation
+ *
+ *  \return \c true, if no violation was found in the run
+ */
+static bool endRun (RUN *r)
+{
+    int one = 0, two = 0, late = 0, oneG = 0, twoG = 0, lateG = 0, ended = 0;
+    int teamOne = nReferees * ((nTeams + 1) / 2), teamTwo = nReferees * (nTeams / 2);   /* teams of each side */
+    char what[128];
+    size_t pos;
+    int e;
+
+    if (r->prev == NULL) {
+        violation (r, 0, "no state record", -1, 0, 0);
+        return false;
+    }
+    for (pos = 0; pos < width; pos++) {
+        if ((e = column[pos]) < 0) {
+            continue;
+        }
+        char s = r->prev[pos];
+        if (e < nPlayers) {
+            one += (s == PLAYING_1);
+            two += (s == PLAYING_2);
+            late += (s == LATE);
+        }
+        else if (e < nPlayers + nGoalies) {
+            oneG += (s == PLAYING_1);
+            twoG += (s == PLAYING_2);
+            lateG += (s == LATE);
+        }
+        else ended += (s == ENDING_GAME);
+    }
+    if (ended != nReferees) {
+        sprintf (what, "%d of %d referees ended their match", ended, nReferees);
+        violation (r, r->prevLine, what, -1, 0, 0);
+    }
+    if ((one != teamOne * teamPlayers) || (two != teamTwo * teamPlayers) || (late != nPlayers - one - two)) {
+        sprintf (what, "players: %d in team one, %d in team two, %d late (expected %d, %d, %d)", one, two, late,
+                 teamOne * teamPlayers, teamTwo * teamPlayers, nPlayers - (teamOne + teamTwo) * teamPlayers);
+        violation (r, r->prevLine, what, -1, 0, 0);
+    }
+    if ((oneG != teamOne * teamGoalies) || (twoG != teamTwo * teamGoalies) || (lateG != nGoalies - oneG - twoG)) {
+        sprintf (what, "goalies: %d in team one, %d in team two, %d late (expected %d, %d, %d)", oneG, twoG, lateG,
+                 teamOne * teamGoalies, teamTwo * teamGoalies, nGoalies - (teamOne + teamTwo) * teamGoalies);
+        violation (r, r->prevLine, what, -1, 0, 0);
+    }
+    if ((r->errors > MAXREPORTS) && !quiet) {
+        printf ("%s: run %d: %d more violations\n", fName, r->run, r->errors - MAXREPORTS);
+    }
+    return r->errors == 0;
+}
+
+/** \brief starting the validation of run <tt>run</tt> */
+static void startRun (RUN *r, int run)
+{
+    memset (r, 0, sizeof (RUN));
+    r->run = run;
+}
+
+/** \brief the columns of the state records, for the population of the file */
+static void setColumns (bool binary)
+{
+    int n = nPlayers + nGoalies + nReferees, e;
+
+    colW = logColWidth (nPlayers, nGoalies, nReferees);
+    width = binary ? (size_t) n : (size_t) colW * n + 3;             /* see the record formats of logging.c */
+    if ((column = malloc (width * sizeof (int))) == NULL) {
+        perror ("error on allocating the columns");
+        exit (EXIT_FAILURE);
+    }
+    for (size_t pos = 0; pos < width; pos++) {
+        column[pos] = binary ? (int) pos : -1;
+    }
+    if (!binary) {
+        for (e = 0; e < n; e++) {
+            column[colW * e + colW - 1 + (e >= nPlayers) + (e >= nPlayers + nGoalies)] = e;
+        }
+    }
+}
+
+/** \brief shape of the teams, from the line of the header of the text format that spans <tt>p</tt> to <tt>eol</tt>
+           (see <tt>LOG_TEAMS</tt>): its first three numbers */
+static void teamsLine (const char *p, const char *eol)
+{
+    int *shape[3] = { &nTeams, &teamPlayers, &teamGoalies }, i = 0;
+
+    for (; (p < eol) && (i < 3); p++) {                              /* the file is not a string: no strtol */
+        if ((*p >= '0') && (*p <= '9')) {
+            for (*shape[i] = 0; (p < eol) && (*p >= '0') && (*p <= '9'); p++) {
+                *shape[i] = *shape[i] * 10 + (*p - '0');
+            }
+            i++;
+        }
+    }
+}
+
+/**
+ *  \brief Validating a binary logging file.
+ *
+ *  \param base mapped file
+ *  \param size file size
+ *  \param p_bad pointer to the location where the number of runs with violations is added
+ *
+ *  \return number of runs, -1 if the file is of another version of the format, or -2 if it is split
+ */
+static int checkBinary (const char *base, size_t size, int *p_bad)
+{
+    LOG_BIN_HDR hdr;                                                                                 /* file header */
+    RUN r;                                                                                   /* run under validation */
+    int runs = 0;
+    size_t off, blkSize;                                                      /* current offset, seed and delays */
+    unsigned long rec = 0;                                                                  /* record number */
+
+    memcpy (&hdr, base, sizeof (hdr));
+    if (hdr.version != LOG_VERSION) {
+        return -1;
+    }
+    if (hdr.split) {
+        return -2;
+    }
+    nPlayers = hdr.nPlayers;
+    nGoalies = hdr.nGoalies;
+    nReferees = hdr.nReferees;
+    nTeams = hdr.nTeams;
+    teamPlayers = hdr.teamPlayers;
+    teamGoalies = hdr.teamGoalies;
+    setColumns (true);
+    blkSize = (width + 1) * sizeof (uint32_t);
+
+    startRun (&r, 1);
+    for (off = sizeof (hdr); off + width <= size; off += width) {
+        rec++;
+        if (base[off] == LOG_DELAYS) {                                           /* seed and arrival delays follow */
+            off += blkSize;
+            continue;
+        }
+        if (base[off] == LOG_END) {                                                    /* separator between runs */
+            if (r.prev != NULL) {
+                *p_bad += !endRun (&r);
+                runs++;
+            }
+            startRun (&r, runs + 1);
+            continue;
+        }
+        checkRecord (&r, base + off, rec);
+    }
+    if (r.prev != NULL) {
+        *p_bad += !endRun (&r);
+        runs++;
+    }
+    return runs;
+}
+
+/**
+ *  \brief Validating a text logging file.
+ *
+ *  \param base mapped file
+ *  \param size file size
+ *  \param p_bad pointer to the location where the number of runs with violations is added
+ *
+ *  \return number of runs, -1 if the file has no column header, or -2 if it is split
+ */
+static int checkText (const char *base, size_t size, int *p_bad)
+{
+    RUN r;                                                                                   /* run under validation */
+    int runs = 0;
+    bool header = false, delays = false;          /* the column header was read, the next line holds the delays */
+    const char *p, *end = base + size, *eol;
+    unsigned long line = 0;
+    int run;
+
+    nPlayers = nGoalies = nReferees = 0;
+    nTeams = optTeams;
+    teamPlayers = optPlayers;
+    teamGoalies = optGoalies;
+    startRun (&r, 1);
+    for (p = base; p < end; p = eol + 1) {
+        if ((eol = memchr (p, '\n', (size_t) (end - p))) == NULL) {
+            eol = end;
+        }
+        line++;
+        if (header && ((size_t) (eol + 1 - p) == width)) {          /* a state record, or the arrival delays */
+            if (delays) {
+                delays = false;
+            }
+            else checkRecord (&r, p, line);
+            continue;
+        }
+        if (p == eol) {                                                                          /* blank line */
+            continue;
+        }
+        if (strncmp (p, "Run ", 4) == 0) {                             /* the file is not a string: no sscanf */
+            run = (int) strtol (p + 4, NULL, 10);
+            if (r.prev != NULL) {
+                *p_bad += !endRun (&r);
+                runs++;
+            }
+            startRun (&r, run);
+            continue;
+        }
+        if (strncmp (p, "Seed ", 5) == 0) {
+            delays = true;
+            continue;
+        }
+        if (!header && (strncmp (p, "Teams ", 6) == 0)) {                            /* shape of the teams */
+            if ((size_t) (eol - p) >= strlen (LOG_SPLIT) &&
+                (memcmp (eol - strlen (LOG_SPLIT), LOG_SPLIT, strlen (LOG_SPLIT)) == 0)) {
+                return -2;
+            }
+            teamsLine (p, eol);
+            continue;
+        }
+        if (!header && (strncmp (p, " P0", 3) == 0)) {                               /* column header */
+            const char *q;
+            for (q = p; q < eol; q++) {
+                if ((*q != ' ') && ((q == p) || (q[-1] == ' '))) {                      /* a letter, then digits */
+                    nPlayers += (*q == 'P');
+                    nGoalies += (*q == 'G');
+                    nReferees += (*q == 'R');
+                }
+            }
+            setColumns (false);
+            header = true;
+            continue;
+        }
+        if (header) {
+            violation (&r, line, "line is not a record", -1, 0, 0);
+        }
+    }
+    if (!header) {
+        return -1;
+    }
+    if ((r.prev != NULL) || (r.errors > 0)) {
+        *p_bad += !endRun (&r);
+        runs++;
+    }
+    return runs;
+}
+
+/**
+ *  \brief Main program.
+ *
+ *  Its role is to validate the logging files and to print a summary of each one.
+ */
+int main (int argc, char *argv[])
+{
+    int opt;                                                                                       /* command option */
+    int fd;                                                                                   /* file descriptor */
+    struct stat st;                                                                               /* file status */
+    char *base;                                                                          /* mapped logging file */
+    int runs, bad;                                                              /* runs of a file, violating runs */
+    bool failed = false;                                                            /* a violation was found */
+    int i;
+
+    while ((opt = getopt (argc, argv, "t:P:G:q")) != -1) {
+        switch (opt) {
+            case 't':
+                optTeams = atoi (optarg);
+                break;
+            case 'P':
+                optPlayers = atoi (optarg);
+                break;
+            case 'G':
+                optGoalies = atoi (optarg);
+                break;
+            case 'q':
+                quiet = true;
+                break;
+            default:
+                fprintf (stderr, "Usage: %s [-t teams] [-P teamPlayers] [-G teamGoalies] [-q] logfile...\n", argv[0]);
+                exit (EXIT_FAILURE);
+        }
+    }
+    if ((optind == argc) || (optTeams < 1) || (optPlayers < 1) || (optGoalies < 0)) {
+        fprintf (stderr, "Usage: %s [-t teams] [-P teamPlayers] [-G teamGoalies] [-q] logfile...\n", argv[0]);
+        exit (EXIT_FAILURE);
+    }
+
+    for (i = optind; i < argc; i++) {
+        fName = argv[i];
+
+        /* mapping the logging file */
+        if ((fd = open (fName, O_RDONLY)) == -1) {
+            perror ("error on opening the logging file");
+            exit (EXIT_FAILURE);
+        }
+        if (fstat (fd, &st) == -1) {
+            perror ("error on getting the logging file status");
+            exit (EXIT_FAILURE);
+        }
+        if (st.st_size == 0) {
+            printf ("%s: empty file\n", fName);
+            failed = true;
+            close (fd);
+            continue;
+        }
+        if ((base = mmap (NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED) {
+            perror ("error on mapping the logging file");
+            exit (EXIT_FAILURE);
+        }
+        madvise (base, (size_t) st.st_size, MADV_SEQUENTIAL);
+
+        /* validating the runs */
+        bad = 0;
+        if (((size_t) st.st_size >= sizeof (LOG_BIN_HDR)) && (memcmp (base, LOG_MAGIC, 4) == 0)) {
+            runs = checkBinary (base, (size_t) st.st_size, &bad);
+        }
+        else runs = checkText (base, (size_t) st.st_size, &bad);
+        if (runs == -1) {
+            printf ("%s: not a logging file\n", fName);
+            failed = true;
+        }
+        else if (runs == -2) {
+            printf ("%s: split logging file, not validated\n", fName);
+        }
+        else printf ("%s: %d runs, %d valid, %d violating\n", fName, runs, runs - bad, bad);
+        failed = failed || (bad > 0);
+
+        free (column);
+        column = NULL;
+        munmap (base, (size_t) st.st_size);
+        close (fd);
+    }
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -7,7 +7,18 @@
  *
  *  Defined operations:
  *     \li file initialization
- *     \li writing the present full state as a single line at the end of the file.
+ *     \li writing the present full state as a single line at the end of the file
+ *     \li attaching an entity to the buffered log
+ *     \li merging the buffered logs of all entities into the logging file
+ *     \li draining the shared log ring into the logging file
+ *     \li mapping a window of the logging file for the records of a match
+ *     \li trimming the logging file to the records of the match
+ *     \li stopping the logger
+ *     \li naming the logging file of a pitch
+ *     \li separating the runs of a batch
+ *     \li recording the arrival delays of a match
+ *     \li printing the present full state
+ *     \li taking a snapshot of the state of the intervening entities.
  *
  *  \author Nuno Lau - December 2024
  */
@@ -16,13 +27,91 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <errno.h>
 
 #include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
 #include <unistd.h>
-
+#include <time.h>
+#include <sched.h>
+#ifdef SOCCER_THREADS
+#include <pthread.h>
+#endif
 
 #include "probConst.h"
 #include "probDataStruct.h"
+#include "logging.h"
+#include "semaphore.h"
+#include "trace.h"
+
+/** \brief size of the per-entity log buffer (bytes) */
+#define  LOGBUFSIZE     65536
+/** \brief width of a column of the text format, for the population of <tt>p_fSt</tt> (see logColWidth) */
+#define  LOGCOLWIDTH(p_fSt)    logColWidth ((p_fSt)->nPlayers, (p_fSt)->nGoalies, (p_fSt)->nReferees)
+/** \brief size of a single log record (bytes), for the population of <tt>p_fSt</tt>: a column per entity,
+           2 group separators, end of line and end of string */
+#define  LOGRECSIZE(p_fSt)     ((size_t) LOGCOLWIDTH (p_fSt) *                                                    \
+                                ((size_t) (p_fSt)->nPlayers + (p_fSt)->nGoalies + (p_fSt)->nReferees) + 4)
+/** \brief size of the prefix of each buffered record: sequence number (4 bytes) + record length (2 bytes) */
+#define  SEQWIDTH       6
+/** \brief number of records of the window of a match, in mapped mode: an entity changes its state at most 5
+           times in a match */
+#define  MAPRECS(p_fSt)        (8 * ((size_t) (p_fSt)->nPlayers + (p_fSt)->nGoalies + (p_fSt)->nReferees))
+/** \brief size of the key that precedes each record in the window, in mapped mode: the number of writes of the state
+           that the snapshot of the record reflects */
+#define  MAPKEYWIDTH    sizeof (uint32_t)
+/** \brief number of attempts of a snapshot interrupted by writers before the processor is yielded to them */
+#define  SNAPSPIN       64
+
+/** \brief pointer to the logging control in the shared region (NULL if not attached) */
+static LOG_CTL *lCtl = NULL;
+
+/** \brief the process is attached as an intervening entity (the generator only logs directly); one per thread in
+           the thread-based engine, whose main thread is the generator */
+static _Thread_local bool lEntity = false;
+
+/** \brief private log file descriptor of the entity, in buffered mode */
+static int logFd = -1;
+
+/** \brief per-entity buffer of preformatted records, in buffered mode */
+static char logBuf[LOGBUFSIZE];
+
+/** \brief number of bytes stored in the buffer */
+static size_t logLen = 0;
+
+/** \brief semaphore set identifier, in ring mode */
+static int lSemgid;
+
+/** \brief kind of the attached entity, in ring mode (one per thread in the thread-based engine) */
+static _Thread_local int lKind;
+
+/** \brief id of the attached entity, in ring mode (one per thread in the thread-based engine) */
+static _Thread_local int lId;
+
+/** \brief the private log file of the process was already opened, in buffered mode */
+static atomic_bool lOpened = false;
+
+/** \brief the private log file is flushed on process exit, once it was opened */
+static bool lAtExit = false;
+
+/** \brief window of the logging file mapped by the process, in mapped mode - NULL if there is none */
+static char *lMap = NULL;
+
+/** \brief start of the mapping of the window, at a page boundary of the file */
+static void *lMapAddr;
+
+/** \brief length of the mapping of the window (bytes) */
+static size_t lMapLen;
+
+/** \brief offset of the mapped window in the logging file */
+static uint64_t lMapBase;
+
+#ifdef SOCCER_THREADS
+/** \brief access to the buffer of the process, shared by the entity threads of different pitches */
+static pthread_mutex_t lBufLock = PTHREAD_MUTEX_INITIALIZER;
+#endif
 
 /* internal functions */
 
@@ -62,28 +151,271 @@ static void closeLog(FILE *fic)
 
 static void printHeader(FILE *fic, FULL_STAT *p_fSt)
 {
-    
+    int d = LOGCOLWIDTH (p_fSt) - 2;                                            /* digits of the entity numbers */
+
     int p;
     for(p=0; p < p_fSt->nPlayers; p++) {
-        fprintf(fic, " %s%02d", "P", p);
+        fprintf(fic, " %s%0*d", "P", d, p);
     }
 
     fprintf(fic," ");
 
     int g;
     for(g=0; g < p_fSt->nGoalies; g++) {
-        fprintf(fic, " %s%02d", "G", g);
+        fprintf(fic, " %s%0*d", "G", d, g);
     }
 
     fprintf(fic," ");
 
-    fprintf(fic," %s%02d","R",1);
+    int r;
+    for(r=0; r < p_fSt->nReferees; r++) {
+        fprintf(fic, " %s%0*d", "R", d, r+1);
+    }
 
     fprintf(fic," ");
 
     fprintf(fic,"\n");
 }
 
+static int logFormat (void)
+{
+    return (lCtl == NULL) ? LOG_TEXT : lCtl->format;
+}
+
+static int formatBinary (char *buf, STAT *p_st)
+{
+    char *q = buf;
+
+    int p;
+    for(p=0; p < (int) p_st->nPlayers; p++) {
+        *q++ = (char) PLAYERSTAT(p_st, p);
+    }
+
+    int g;
+    for(g=0; g < (int) p_st->nGoalies; g++) {
+        *q++ = (char) GOALIESTAT(p_st, g);
+    }
+
+    int r;
+    for(r=0; r < (int) p_st->nReferees; r++) {
+        *q++ = (char) REFEREESTAT(p_st, r);
+    }
+
+    return (int) (q - buf);
+}
+
+static int formatText (char *buf, STAT *p_st)
+{
+    char *q = buf;
+    int w = LOGCOLWIDTH (p_st);                                                               /* column width */
+
+    int p;
+    for(p=0; p < (int) p_st->nPlayers; p++) {
+        q += sprintf(q,"%*c",w,PLAYERSTAT(p_st, p));
+    }
+
+    *q++ = ' ';
+
+    int g;
+    for(g=0; g < (int) p_st->nGoalies; g++) {
+        q += sprintf(q,"%*c",w,GOALIESTAT(p_st, g));
+    }
+
+    *q++ = ' ';
+
+    int r;
+    for(r=0; r < (int) p_st->nReferees; r++) {
+        q += sprintf(q,"%*c",w,REFEREESTAT(p_st, r));
+    }
+
+    *q++ = '\n';
+    *q = '\0';
+
+    return (int) (q - buf);
+}
+
+static int formatState (char *buf, STAT *p_st)
+{
+    if (logFormat () == LOG_BINARY) {
+        return formatBinary (buf, p_st);
+    }
+    return formatText (buf, p_st);
+}
+
+static void privateLogName (char name[], char nFic[], int pid)
+{
+    if ((nFic == NULL) || (strlen (nFic) == 0)) {
+        sprintf (name, "stdout.%d", pid);
+    }
+    else sprintf (name, "%s.%d", nFic, pid);
+}
+
+static void flushLog (void)
+{
+    size_t done = 0;
+    ssize_t n;
+
+    while (done < logLen) {
+        if ((n = write (logFd, logBuf + done, logLen - done)) == -1) {
+            perror ("error on writing private log file");
+            exit (EXIT_FAILURE);
+        }
+        done += (size_t) n;
+    }
+    logLen = 0;
+}
+
+static int entityState (FULL_STAT *p_fSt, int kind, int id)
+{
+    switch (kind) {
+        case LOG_PLAYER:
+            return (int) PLAYERSTAT(&p_fSt->st, id);
+        case LOG_GOALIE:
+            return (int) GOALIESTAT(&p_fSt->st, id);
+        default:
+            return (int) REFEREESTAT(&p_fSt->st, id);
+    }
+}
+
+/** \brief width of a record in the logging file, without the end of string */
+static size_t recWidth (FULL_STAT *p_fSt)
+{
+    if (logFormat () == LOG_BINARY) {
+        return (size_t) p_fSt->nPlayers + p_fSt->nGoalies + p_fSt->nReferees;
+    }
+    return LOGRECSIZE (p_fSt) - 1;
+}
+
+/** \brief width of a slot of the window, in mapped mode: the key and the record */
+static size_t slotWidth (FULL_STAT *p_fSt)
+{
+    return MAPKEYWIDTH + recWidth (p_fSt);
+}
+
+/** \brief slot of the window and its key, as sorted when the file is trimmed */
+typedef struct
+{   uint32_t key;
+    uint32_t slot;
+} MAP_KEY;
+
+/** \brief order of the records of the window: by key, then by slot (records of equal keys are equal) */
+static int cmpKey (const void *a, const void *b)
+{
+    const MAP_KEY *ka = a, *kb = b;
+
+    if (ka->key != kb->key) {
+        return (ka->key < kb->key) ? -1 : 1;
+    }
+    return (ka->slot < kb->slot) ? -1 : (ka->slot > kb->slot);
+}
+
+/** \brief unmapping the window of the logging file mapped by the process */
+static void unmapWindow (void)
+{
+    if (lMap == NULL) {
+        return;
+    }
+    if (munmap (lMapAddr, lMapLen) == -1) {
+        perror ("error on unmapping the logging file");
+        exit (EXIT_FAILURE);
+    }
+    lMap = NULL;
+}
+
+/** \brief mapping the window of the logging file set for the match in the logging control */
+static void mapWindow (char nFic[])
+{
+    int fd;                                                                                      /* file descriptor */
+    off_t page = (off_t) (lCtl->mapBase / (uint64_t) sysconf (_SC_PAGESIZE) * (uint64_t) sysconf (_SC_PAGESIZE));
+
+    unmapWindow ();
+    if ((fd = open (nFic, O_RDWR)) == -1) {
+        perror ("error on opening log file");
+        exit (EXIT_FAILURE);
+    }
+    lMapLen = (size_t) (lCtl->mapBase - (uint64_t) page + lCtl->mapCap);
+    if ((lMapAddr = mmap (NULL, lMapLen, PROT_READ | PROT_WRITE, MAP_SHARED, fd, page)) == MAP_FAILED) {
+        perror ("error on mapping the logging file");
+        exit (EXIT_FAILURE);
+    }
+    close (fd);
+    lMap = (char *) lMapAddr + (lCtl->mapBase - (uint64_t) page);
+    lMapBase = lCtl->mapBase;
+}
+
+static void applyRecord (FULL_STAT *p_fSt, LOG_REC *rec)
+{
+    switch (rec->kind) {
+        case LOG_PLAYER:
+            PLAYERSTAT(&p_fSt->st, rec->id) = rec->state;
+            break;
+        case LOG_GOALIE:
+            GOALIESTAT(&p_fSt->st, rec->id) = rec->state;
+            break;
+        default:
+            REFEREESTAT(&p_fSt->st, rec->id) = rec->state;
+    }
+}
+
+static void appendRecord (LOG_CTL *p_lCtl, int semgid, int kind, int id, int state)
+{
+    unsigned int seq = atomic_fetch_add (&p_lCtl->seq, 1);     /* entities on different pitches log concurrently */
+    LOG_REC *rec;                                                                                /* slot in the ring */
+    struct timespec now;                                                                    /* time of state change */
+
+    while (seq - atomic_load (&p_lCtl->tail) >= LOGRINGSIZE) {                          /* ring is full: backpressure */
+        atomic_fetch_add (&p_lCtl->waitSlots, 1);
+        if ((seq - atomic_load (&p_lCtl->tail) >= LOGRINGSIZE) && (semDown (semgid, p_lCtl->slots) == -1)) {
+            perror ("error on the down operation for semaphore access of log slots");
+            exit (EXIT_FAILURE);
+        }
+    }
+
+    clock_gettime (CLOCK_MONOTONIC, &now);
+    rec = &p_lCtl->ring[seq % LOGRINGSIZE];
+    rec->seq   = seq;
+    rec->kind  = (unsigned char) kind;
+    rec->state = (unsigned char) state;
+    rec->id    = (unsigned short) id;
+    rec->ts    = (uint64_t) now.tv_sec * 1000000000 + (uint64_t) now.tv_nsec;
+    atomic_store (&rec->ready, seq + 1);                                                       /* publish the record */
+
+    if (atomic_exchange (&p_lCtl->waitItems, 0) && (semUp (semgid, p_lCtl->items) == -1)) {
+        perror ("error on the up operation for semaphore access of log items");
+        exit (EXIT_FAILURE);
+    }
+}
+
+/** \brief entering the log, in direct mode: the entities of different pitches log one at a time */
+static void lockLog (void)
+{
+    if (semDown (lSemgid, lCtl->lock) == -1) {
+        perror ("error on the down operation for semaphore access of the log");
+        exit (EXIT_FAILURE);
+    }
+}
+
+/** \brief leaving the log, in direct mode */
+static void unlockLog (void)
+{
+    if (semUp (lSemgid, lCtl->lock) == -1) {
+        perror ("error on the up operation for semaphore access of the log");
+        exit (EXIT_FAILURE);
+    }
+}
+
+static bool readRecord (FILE *in, uint32_t *p_seq, uint16_t *p_len, char *rec, size_t maxLen)
+{
+    char prefix[SEQWIDTH];                                                   /* sequence number and record length */
+
+    if (fread (prefix, SEQWIDTH, 1, in) != 1) {
+        return false;
+    }
+    memcpy (p_seq, prefix, sizeof (*p_seq));
+    memcpy (p_len, prefix + sizeof (*p_seq), sizeof (*p_len));
+    return (*p_len <= maxLen) && (fread (rec, 1, *p_len, in) == *p_len);
+}
+
 /* external functions */
 
 /**
@@ -94,19 +426,45 @@ static void printHeader(FILE *fic, FULL_STAT *p_fSt)
  *
  *  The file header consists of
  *       \li a title line
+ *       \li the shape of the teams (<tt>LOG_TEAMS</tt>)
  *       \li a blank line.
  *
+ *  In <tt>LOG_BINARY</tt> format the header is a <tt>LOG_BIN_HDR</tt> instead.
+ *
  *  \param nFic name of the logging file
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ *  \param p_lCtl pointer to the logging control, that sets the format of the file
  */
-void createLog (char nFic[], FULL_STAT *p_fSt)
+void createLog (char nFic[], FULL_STAT *p_fSt, LOG_CTL *p_lCtl)
 {
     FILE *fic;                                                                                      /* file descriptor */
+    LOG_BIN_HDR hdr;                                                                                 /* binary header */
 
+    lCtl = p_lCtl;
     fic = openLog(nFic,"w");
 
-    /* title line + blank line */
+    if (logFormat () == LOG_BINARY) {
+        memset (&hdr, 0, sizeof (hdr));
+        memcpy (hdr.magic, LOG_MAGIC, sizeof (hdr.magic));
+        hdr.version     = LOG_VERSION;
+        hdr.nPlayers    = (uint16_t) p_fSt->nPlayers;
+        hdr.nGoalies    = (uint16_t) p_fSt->nGoalies;
+        hdr.nReferees   = (uint16_t) p_fSt->nReferees;
+        hdr.seed        = p_fSt->seed;
+        hdr.nTeams      = (uint16_t) p_fSt->nTeams;
+        hdr.teamPlayers = (uint16_t) p_fSt->teamPlayers;
+        hdr.teamGoalies = (uint16_t) p_fSt->teamGoalies;
+        hdr.split       = p_lCtl->split;
+        fwrite (&hdr, sizeof (hdr), 1, fic);
+        closeLog(fic);
+        return;
+    }
 
-    fprintf (fic, "%21cSoccerGame - Description of the internal state\n\n", ' ');
+    /* title line + shape of the teams + blank line */
+
+    fprintf (fic, "%21cSoccerGame - Description of the internal state\n", ' ');
+    fprintf (fic, LOG_TEAMS "\n", p_fSt->nTeams, p_fSt->teamPlayers, p_fSt->teamGoalies,
+             p_lCtl->split ? LOG_SPLIT : "");
     printHeader(fic, p_fSt);
 
     closeLog(fic);
@@ -122,33 +480,509 @@ void createLog (char nFic[], FULL_STAT *p_fSt)
  *    \li goalies state 
  *    \li referee state 
  *
+ *  In <tt>LOG_BINARY</tt> format the line is a fixed width record with one byte per entity, in the same order.
+ *  The line is formatted from a snapshot of the state (see <tt>snapshotState</tt>), so that the entities of other
+ *  pitches, that change their states at the same time, never leave a torn line. The lines follow the order of their
+ *  snapshots, whatever the pitches of the entities: in <tt>LOG_DIRECT</tt> mode the snapshot and the writing of the
+ *  line are a single step under the lock of the log, and in <tt>LOG_BUFFERED</tt> and <tt>LOG_MAPPED</tt> modes the
+ *  record is keyed by the number of writes of the state that its snapshot reflects, and the records are put in the
+ *  order of their keys when they are merged or when the file is trimmed.
+ *
  *  \param nFic name of the logging file
  *  \param p_fSt pointer to the location where the full internal state of the problem is stored
  */
 void saveState (char nFic[], FULL_STAT *p_fSt)
 {
     FILE *fic;                                                                                      /* file descriptor */
+    char line[LOGRECSIZE (p_fSt)];                                                                /* formatted record */
+    uint32_t seq;                                                                          /* record sequence number */
+    uint16_t len;                                                                                   /* record length */
+    uint64_t off;                                                             /* slot of the record, in mapped mode */
+    _Alignas (STAT) char snapBuf[STATSIZE (p_fSt->nPlayers, p_fSt->nGoalies, p_fSt->nReferees)];
+    STAT *snap = (STAT *) snapBuf;                                        /* consistent copy of the entity states */
+
+    atomic_fetch_add_explicit (&p_fSt->changes, 1, memory_order_relaxed);              /* progress of the match */
+
+    if (lEntity && (lCtl->trace[0] != '\0')) {                                 /* the state change is timed */
+        traceState (entityState (p_fSt, lKind, lId));
+    }
+
+    if (lEntity && (lCtl->mode == LOG_RING)) {
+        appendRecord (lCtl, lSemgid, lKind, lId, entityState (p_fSt, lKind, lId));
+        return;
+    }
+
+    if (lEntity && (lCtl->mode == LOG_MAPPED)) {
+        off = atomic_fetch_add (&lCtl->mapUsed, slotWidth (p_fSt));
+        if (off + slotWidth (p_fSt) > lCtl->mapCap) {
+            fprintf (stderr, "The window of the mapped logging file is full\n");
+            exit (EXIT_FAILURE);
+        }
+        seq = snapshotState (p_fSt, snap);          /* the records are sorted by it when the file is trimmed */
+        formatState (line, snap);                                          /* the end of string is not copied */
+        memcpy (lMap + off, &seq, MAPKEYWIDTH);
+        memcpy (lMap + off + MAPKEYWIDTH, line, recWidth (p_fSt));
+        return;
+    }
+
+    if (lEntity && (lCtl->mode == LOG_BUFFERED)) {
+#ifdef SOCCER_THREADS
+        pthread_mutex_lock (&lBufLock);                          /* records of the buffer stay in sequence order */
+#endif
+        seq = snapshotState (p_fSt, snap);               /* the records are merged in the order of the snapshots */
+        if (logLen + SEQWIDTH + LOGRECSIZE (p_fSt) > LOGBUFSIZE) {
+            flushLog ();
+        }
+        len = (uint16_t) formatState (logBuf + logLen + SEQWIDTH, snap);
+        memcpy (logBuf + logLen, &seq, sizeof (seq));
+        memcpy (logBuf + logLen + sizeof (seq), &len, sizeof (len));
+        logLen += SEQWIDTH + len;
+#ifdef SOCCER_THREADS
+        pthread_mutex_unlock (&lBufLock);
+#endif
+        return;
+    }
 
+    if (lEntity) {                                         /* the generator only logs while no entity does */
+        lockLog ();
+    }
+    snapshotState (p_fSt, snap);
     fic = openLog(nFic,"a");
 
-    int p;
-    for(p=0; p < p_fSt->nPlayers; p++) {
-        fprintf(fic,"%4c",p_fSt->st.playerStat[p]);
+    fwrite (line, 1, (size_t) formatState (line, snap), fic);
+
+    closeLog(fic);
+    if (lEntity) {
+        unlockLog ();
     }
+}
 
-    fprintf(fic," ");
+/**
+ *  \brief Attaching the calling entity to the log.
+ *
+ *  Must be called once, after the mapping of the shared region. In <tt>LOG_BUFFERED</tt> mode the private
+ *  log file of the entity is opened here and its records are flushed on process exit (or by <tt>logDetach</tt>).
+ *  In the thread-based engine every entity thread attaches itself; the records of all of them are kept, in
+ *  sequence order, in the private log file of the process, opened by the first one.
+ *  In <tt>LOG_RING</tt> mode the entity kind and id are kept to fill its state change records.
+ *  In <tt>LOG_MAPPED</tt> mode the window of the match is mapped, unless the process already did.
+ *  In <tt>LOG_DIRECT</tt> mode nothing else is done. In every mode the entity is attached to the trace,
+ *  if there is one.
+ *
+ *  \param nFic name of the logging file
+ *  \param p_lCtl pointer to the logging control in the shared region
+ *  \param semgid semaphore set identifier
+ *  \param kind entity kind (<tt>LOG_PLAYER</tt>, <tt>LOG_GOALIE</tt> or <tt>LOG_REFEREE</tt>)
+ *  \param id entity id
+ */
+void logAttach (char nFic[], LOG_CTL *p_lCtl, int semgid, int kind, int id)
+{
+    char name[128];                                                                          /* private log file name */
+
+    lCtl = p_lCtl;
+    lEntity = true;
+    lSemgid = semgid;
+    lKind = kind;
+    lId = id;
+    if (lCtl->trace[0] != '\0') {
+        traceAttach (lCtl->trace, kind, id);
+    }
+    if ((lCtl->mode == LOG_MAPPED) && ((lMap == NULL) || (lMapBase != lCtl->mapBase))) {
+        mapWindow (nFic);                                           /* a new match of a tournament or a worker */
+    }
+    if ((lCtl->mode != LOG_BUFFERED) || atomic_exchange (&lOpened, true)) {
+        return;
+    }
 
-    int g;
-    for(g=0; g < p_fSt->nGoalies; g++) {
-        fprintf(fic,"%4c",p_fSt->st.goalieStat[g]);
+    privateLogName (name, nFic, getpid ());
+    if ((logFd = open (name, O_WRONLY | O_CREAT | O_TRUNC, 0600)) == -1) {
+        perror ("error on opening private log file");
+        exit (EXIT_FAILURE);
+    }
+    if (!lAtExit) {                                                  /* the process may attach again in a batch */
+        atexit (flushLog);
+        lAtExit = true;
     }
+}
 
-    fprintf(fic," ");
+/**
+ *  \brief Detaching the process from the log.
+ *
+ *  In <tt>LOG_BUFFERED</tt> mode the pending records are flushed and the private log file is closed, so that it
+ *  can be merged before the process exits. Nothing is done in the other modes.
+ */
+void logDetach (void)
+{
+    if (logFd == -1) {
+        return;
+    }
+    flushLog ();
+    if (close (logFd) == -1) {
+        perror ("error on closing private log file");
+        exit (EXIT_FAILURE);
+    }
+    logFd = -1;
+    atomic_store (&lOpened, false);
+}
 
-    fprintf(fic,"%4c",p_fSt->st.refereeStat);
+/**
+ *  \brief Merging the private log files of the entities into the logging file.
+ *
+ *  Records are appended in sequence number order and the private files are removed.
+ *  Only meaningful in <tt>LOG_BUFFERED</tt> mode.
+ *
+ *  \param nFic name of the logging file
+ *  \param p_fSt pointer to the full internal state of the problem (only the configuration is read)
+ *  \param pids process identifiers of the entities that were attached to the log
+ *  \param nProc number of entities
+ */
+void mergeLog (char nFic[], FULL_STAT *p_fSt, int pids[], int nProc)
+{
+    FILE *fic;                                                                                      /* file descriptor */
+    FILE *in[nProc];                                                                  /* private log files descriptors */
+    size_t recSize = LOGRECSIZE (p_fSt);                                                    /* maximum record size */
+    char (*line)[recSize];                                                          /* current record of each file */
+    uint32_t seq[nProc];                                                     /* sequence number of current records */
+    uint16_t len[nProc];                                                              /* length of current records */
+    bool pending[nProc];                                                     /* private file has a current record */
+    char name[128];                                                                          /* private log file name */
+    int i, next;
+
+    if ((line = malloc (nProc * recSize)) == NULL) {
+        perror ("error on allocating the merge buffers");
+        exit (EXIT_FAILURE);
+    }
 
-    fprintf(fic,"\n");
+    for (i = 0; i < nProc; i++) {
+        privateLogName (name, nFic, pids[i]);
+        pending[i] = false;
+        if ((in[i] = fopen (name, "r")) == NULL) {                   /* entity may have failed before attaching */
+            continue;
+        }
+        unlink (name);
+        pending[i] = readRecord (in[i], &seq[i], &len[i], line[i], recSize);
+    }
+
+    fic = openLog(nFic,"a");
+
+    while (true) {
+        next = -1;
+        for (i = 0; i < nProc; i++) {
+            if (pending[i] && ((next == -1) || (seq[i] < seq[next]))) {
+                next = i;
+            }
+        }
+        if (next == -1) {
+            break;
+        }
+        fwrite (line[next], 1, len[next], fic);
+        pending[next] = readRecord (in[next], &seq[next], &len[next], line[next], recSize);
+    }
+
+    closeLog(fic);
+
+    for (i = 0; i < nProc; i++) {
+        if (in[i] != NULL) {
+            fclose (in[i]);
+        }
+    }
+    free (line);
+}
+
+
+/**
+ *  \brief Draining the shared log ring into the logging file.
+ *
+ *  Carried out by the logger process in <tt>LOG_RING</tt> mode. Records are formatted as complete lines, in
+ *  sequence order, until the end of log marker is found.
+ *
+ *  \param nFic name of the logging file
+ *  \param p_fSt pointer to the full internal state of the problem (only the configuration is read)
+ *  \param p_lCtl pointer to the logging control in the shared region
+ *  \param semgid semaphore set identifier
+ */
+void drainLog (char nFic[], FULL_STAT *p_fSt, LOG_CTL *p_lCtl, int semgid)
+{
+    FILE *fic;                                                                                      /* file descriptor */
+    FULL_STAT *fSt;                                                                /* state as seen by the logger */
+    char line[LOGRECSIZE (p_fSt)];                                                                /* formatted record */
+    unsigned int tail = atomic_load (&p_lCtl->tail);                            /* sequence number of next record */
+    LOG_REC *rec;                                                                                  /* current record */
+    bool end;                                                                               /* end of log was found */
+    size_t size = FULLSTATSIZE (p_fSt->nPlayers, p_fSt->nGoalies, p_fSt->nReferees);          /* logger state size */
+
+    lCtl = p_lCtl;
+    size = (size + _Alignof (FULL_STAT) - 1) / _Alignof (FULL_STAT) * _Alignof (FULL_STAT);       /* aligned_alloc */
+    if ((fSt = aligned_alloc (_Alignof (FULL_STAT), size)) == NULL) {
+        perror ("error on allocating the logger state");
+        exit (EXIT_FAILURE);
+    }
+    memcpy (fSt, p_fSt, offsetof (FULL_STAT, st));
+    memcpy (&fSt->st, (char *) p_lCtl + p_lCtl->baseOff, STATSIZE (p_fSt->nPlayers, p_fSt->nGoalies, p_fSt->nReferees));
+    fic = openLog(nFic,"a");
+    setvbuf (fic, NULL, _IOFBF, LOGBUFSIZE);
+
+    while (true) {
+        rec = &p_lCtl->ring[tail % LOGRINGSIZE];
+        while (atomic_load (&rec->ready) != tail + 1) {                          /* next record is not written yet */
+            fflush (fic);
+            atomic_store (&p_lCtl->waitItems, 1);
+            if ((atomic_load (&rec->ready) != tail + 1) && (semDown (semgid, p_lCtl->items) == -1)) {
+                perror ("error on the down operation for semaphore access of log items");
+                exit (EXIT_FAILURE);
+            }
+        }
+
+        if (!(end = (rec->kind == LOG_END))) {
+            applyRecord (fSt, rec);
+            fwrite (line, 1, (size_t) formatState (line, &fSt->st), fic);
+        }
+
+        atomic_store (&p_lCtl->tail, ++tail);                                                  /* release the slot */
+        int n = atomic_exchange (&p_lCtl->waitSlots, 0);                        /* wake every entity waiting for it */
+        if ((n > 0) && (semUpN (semgid, p_lCtl->slots, (unsigned int) n) == -1)) {
+            perror ("error on the up operation for semaphore access of log slots");
+            exit (EXIT_FAILURE);
+        }
+
+        if (end) {
+            break;
+        }
+    }
 
     closeLog(fic);
+    free (fSt);
 }
 
+/**
+ *  \brief Mapping a window of the logging file for the records of a match.
+ *
+ *  The window starts at the end of the file and holds <tt>MAPRECS</tt> records.
+ *
+ *  \param nFic name of the logging file
+ *  \param p_fSt pointer to the full internal state of the problem (only the configuration is read)
+ *  \param p_lCtl pointer to the logging control in the shared region
+ */
+void mapLog (char nFic[], FULL_STAT *p_fSt, LOG_CTL *p_lCtl)
+{
+    int fd;                                                                                      /* file descriptor */
+    struct stat st;                                                                          /* file status */
+    int err;                                                                           /* preallocation status */
+
+    lCtl = p_lCtl;
+    if ((fd = open (nFic, O_RDWR)) == -1) {
+        perror ("error on opening log file");
+        exit (EXIT_FAILURE);
+    }
+    if (fstat (fd, &st) == -1) {
+        perror ("error on getting the size of the logging file");
+        exit (EXIT_FAILURE);
+    }
+    p_lCtl->mapBase = (uint64_t) st.st_size;
+    p_lCtl->mapCap = MAPRECS (p_fSt) * slotWidth (p_fSt);
+    atomic_store (&p_lCtl->mapUsed, 0);
+    if ((err = posix_fallocate (fd, st.st_size, (off_t) p_lCtl->mapCap)) != 0) {
+        errno = err;
+        perror ("error on preallocating the logging file");
+        exit (EXIT_FAILURE);
+    }
+    close (fd);
+    mapWindow (nFic);
+}
+
+/**
+ *  \brief Trimming the logging file to the records of the match.
+ *
+ *  The records of the slots that were reserved are sorted by their keys and written, without the keys, from the
+ *  start of the window.
+ *
+ *  \param nFic name of the logging file
+ *  \param p_fSt pointer to the full internal state of the problem (only the configuration is read)
+ *  \param p_lCtl pointer to the logging control in the shared region
+ */
+void trimLog (char nFic[], FULL_STAT *p_fSt, LOG_CTL *p_lCtl)
+{
+    uint64_t used = atomic_load (&p_lCtl->mapUsed);
+    size_t rw = recWidth (p_fSt), sw = slotWidth (p_fSt);                               /* record and slot widths */
+    size_t n, i;                                                                               /* reserved slots */
+    MAP_KEY *keys;                                                                        /* keys of the slots */
+    char *recs;                                                                      /* records, in key order */
+
+    if (used > p_lCtl->mapCap) {                                            /* an entity found the window full */
+        used = p_lCtl->mapCap;
+    }
+    n = (size_t) used / sw;
+    if ((keys = malloc ((n + 1) * sizeof (MAP_KEY))) == NULL || (recs = malloc (n * rw + 1)) == NULL) {
+        perror ("error on allocating the records of the window");
+        exit (EXIT_FAILURE);
+    }
+    for (i = 0; i < n; i++) {
+        memcpy (&keys[i].key, lMap + i * sw, MAPKEYWIDTH);
+        keys[i].slot = (uint32_t) i;
+    }
+    qsort (keys, n, sizeof (MAP_KEY), cmpKey);
+    for (i = 0; i < n; i++) {
+        memcpy (recs + i * rw, lMap + keys[i].slot * sw + MAPKEYWIDTH, rw);
+    }
+    memcpy (lMap, recs, n * rw);
+    free (recs);
+    free (keys);
+
+    unmapWindow ();
+    if (truncate (nFic, (off_t) (p_lCtl->mapBase + n * rw)) == -1) {
+        perror ("error on trimming the logging file");
+        exit (EXIT_FAILURE);
+    }
+}
+
+/**
+ *  \brief Stopping the logger.
+ *
+ *  Appends the end of log marker to the shared log ring. Must only be called once every entity has terminated.
+ *
+ *  \param p_lCtl pointer to the logging control in the shared region
+ *  \param semgid semaphore set identifier
+ */
+void stopLog (LOG_CTL *p_lCtl, int semgid)
+{
+    appendRecord (p_lCtl, semgid, LOG_END, 0, 0);
+}
+
+/**
+ *  \brief Naming the logging file of a pitch.
+ *
+ *  When the match of each pitch is logged in a file of its own, the file of pitch <tt>pitch</tt> is the logging
+ *  file name followed by <tt>.pitch</tt> and the pitch number (from 1); otherwise it is the logging file itself.
+ *  Only meaningful in <tt>LOG_DIRECT</tt> mode.
+ *
+ *  \param name pointer to the location where the name is stored
+ *  \param nFic name of the logging file
+ *  \param p_lCtl pointer to the logging control, that sets whether the pitches are logged apart
+ *  \param pitch pitch (0 .. nReferees-1)
+ */
+void pitchLogName (char name[], char nFic[], LOG_CTL *p_lCtl, int pitch)
+{
+    if (!p_lCtl->split) {
+        strcpy (name, (nFic == NULL) ? "" : nFic);
+    }
+    else if ((nFic == NULL) || (strlen (nFic) == 0)) {
+        sprintf (name, "stdout.pitch%02d", pitch + 1);
+    }
+    else sprintf (name, "%s.pitch%02d", nFic, pitch + 1);
+}
+
+/**
+ *  \brief Separating the runs of a batch in the logging file.
+ *
+ *  Appends a line that announces the run <tt>run</tt>, preceded by a blank line. In <tt>LOG_BINARY</tt> format a
+ *  record with every byte set to <tt>LOG_END</tt> is appended instead, that <tt>logdecoder</tt> turns back into
+ *  the same lines.
+ *
+ *  \param nFic name of the logging file
+ *  \param p_fSt pointer to the full internal state of the problem (only the configuration is read)
+ *  \param run run number (from 1)
+ */
+void separateLog (char nFic[], FULL_STAT *p_fSt, int run)
+{
+    FILE *fic;                                                                                      /* file descriptor */
+    size_t width = (size_t) p_fSt->nPlayers + p_fSt->nGoalies + p_fSt->nReferees;        /* binary record width */
+    char rec[width];                                                                             /* separator record */
+
+    fic = openLog(nFic,"a");
+
+    if (logFormat () == LOG_BINARY) {
+        memset (rec, LOG_END, width);
+        fwrite (rec, 1, width, fic);
+    }
+    else fprintf (fic, "\nRun %d\n", run);
+
+    closeLog(fic);
+}
+
+/**
+ *  \brief Recording the arrival delays of a match in the logging file.
+ *
+ *  \param nFic name of the logging file
+ *  \param p_fSt pointer to the full internal state of the problem (only the configuration is read)
+ *  \param delays arrival delays (us), players first, then goalies and referees
+ */
+void logDelays (char nFic[], FULL_STAT *p_fSt, unsigned int delays[])
+{
+    FILE *fic;                                                                                      /* file descriptor */
+    int e, n = p_fSt->nPlayers + p_fSt->nGoalies + p_fSt->nReferees, w = LOGCOLWIDTH (p_fSt);
+
+    fic = openLog(nFic,"a");
+
+    if (logFormat () == LOG_BINARY) {
+        char rec[n];                                                                               /* marker record */
+        uint32_t blk[n + 1];                                                                    /* seed and delays */
+        memset (rec, LOG_DELAYS, (size_t) n);
+        blk[0] = p_fSt->seed;
+        for (e = 0; e < n; e++) {
+            blk[e + 1] = delays[e];
+        }
+        fwrite (rec, 1, (size_t) n, fic);
+        fwrite (blk, sizeof (uint32_t), (size_t) n + 1, fic);
+        closeLog(fic);
+        return;
+    }
+
+    fprintf (fic, "Seed %u - arrival delays (us)\n", p_fSt->seed);
+    for (e = 0; e < n; e++) {
+        if ((e == p_fSt->nPlayers) || (e == p_fSt->nPlayers + p_fSt->nGoalies)) {
+            fprintf (fic, " ");                                                     /* as in the column header */
+        }
+        fprintf (fic, "%*u", w, delays[e]);
+    }
+    fprintf (fic, "\n");
+
+    closeLog(fic);
+}
+
+/**
+ *  \brief Printing the present full state.
+ *
+ *  \param fp output stream
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ */
+void printState (FILE *fp, FULL_STAT *p_fSt)
+{
+    char line[LOGRECSIZE (p_fSt)];                                                                /* formatted record */
+    _Alignas (STAT) char snapBuf[STATSIZE (p_fSt->nPlayers, p_fSt->nGoalies, p_fSt->nReferees)];
+    STAT *snap = (STAT *) snapBuf;                                        /* consistent copy of the entity states */
+
+    snapshotState (p_fSt, snap);
+    printHeader (fp, p_fSt);
+    fwrite (line, 1, (size_t) formatText (line, snap), fp);
+}
+
+/**
+ *  \brief Taking a snapshot of the state of the intervening entities.
+ *
+ *  The state is copied with no lock, between a read of the counter of completed writes and a read of the counter of
+ *  started writes (see <tt>SETSTATE</tt>); when they differ a write was under way or began meanwhile, and the copy
+ *  is taken again. Copies that reflect the same number of writes are equal, and one that reflects more is later.
+ *
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ *  \param p_st pointer to the copy, of size <tt>STATSIZE</tt> for the population
+ *
+ *  \return number of writes of the state that the copy reflects
+ */
+unsigned int snapshotState (FULL_STAT *p_fSt, STAT *p_st)
+{
+    size_t size = STATSIZE (p_fSt->nPlayers, p_fSt->nGoalies, p_fSt->nReferees);                 /* size of the copy */
+    unsigned int end;                                                          /* completed writes before the copy */
+    unsigned int tries;                                                                        /* attempts so far */
+
+    for (tries = 1; ; tries++) {
+        end = atomic_load_explicit (&p_fSt->stEnd, memory_order_acquire);
+        memcpy (p_st, &p_fSt->st, size);
+        atomic_thread_fence (memory_order_acquire);                          /* the copy is read before the check */
+        if (atomic_load_explicit (&p_fSt->stBegin, memory_order_relaxed) == end) {
+            return end;
+        }
+        if (tries % SNAPSPIN == 0) {                                     /* a writer may have lost the processor */
+            sched_yield ();
+        }
+    }
+}
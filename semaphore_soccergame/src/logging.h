@@ -7,7 +7,43 @@
  *
  *  Defined operations:
  *     \li file initialization
- *     \li writing the present full state as a single line at the end of the file.
+ *     \li writing the present full state as a single line at the end of the file
+ *     \li attaching an entity to the buffered log
+ *     \li merging the buffered logs of all entities into the logging file
+ *     \li draining the shared log ring into the logging file
+ *     \li mapping a window of the logging file for the records of a match
+ *     \li trimming the logging file to the records of the match
+ *     \li stopping the logger
+ *     \li naming the logging file of a pitch
+ *     \li separating the runs of a batch
+ *     \li recording the arrival delays of a match
+ *     \li printing the present full state
+ *     \li taking a snapshot of the state of the intervening entities.
+ *
+ *  Four logging modes are available:
+ *     \li <tt>LOG_DIRECT</tt>: every record is appended to the logging file, which is opened and closed
+ *         each time
+ *     \li <tt>LOG_BUFFERED</tt>: every entity keeps its log open, stamps each record with the number of writes of
+ *         the state that its snapshot reflects and flushes its records in large chunks to a private file;
+ *         the private files are merged in sequence order at the end of the simulation
+ *     \li <tt>LOG_RING</tt>: every entity appends a compact state change record to a ring in the shared region;
+ *         a dedicated logger process formats the records into the logging file concurrently
+ *     \li <tt>LOG_MAPPED</tt>: before each match the logging file is extended by a preallocated window, that every
+ *         entity maps shared; each record, whose width is fixed for the population, is written straight into the
+ *         slot reserved by an atomic addition on the offset of the window, with no system call, keyed by the number
+ *         of writes of the state that its snapshot reflects; at the end of the match the records are sorted by
+ *         their keys and the file is trimmed to them.
+ *
+ *  The records of the matches on different pitches are interleaved in the logging file. In <tt>LOG_DIRECT</tt>
+ *  mode the records of each match may be written instead to a file of its own (see <tt>pitchLogName</tt>), while
+ *  arrival and team formation stay in the logging file.
+ *
+ *  Independently of the mode, the file is written in one of two formats:
+ *     \li <tt>LOG_TEXT</tt>: a title, the shape of the teams (<tt>LOG_TEAMS</tt>), a column header and one line of
+ *         text per state change
+ *     \li <tt>LOG_BINARY</tt>: a <tt>LOG_BIN_HDR</tt> followed by one fixed width record per state change, holding
+ *         one byte (the state) per player, goalie and referee; the seed and the arrival delays of each match follow
+ *         a record with every byte set to <tt>LOG_DELAYS</tt>. <tt>logdecoder</tt> turns it back into text.
  *
  *  \author Nuno Lau - December 2024
  */
@@ -15,8 +51,116 @@
 #ifndef LOGGING_H_
 #define LOGGING_H_
 
+#include <stdio.h>
+#include <stdint.h>
+
 #include "probDataStruct.h"
 
+/** \brief records are appended directly to the logging file */
+#define  LOG_DIRECT        0
+/** \brief records are buffered per entity and merged at the end */
+#define  LOG_BUFFERED      1
+/** \brief records are appended to a shared ring drained by the logger */
+#define  LOG_RING          2
+/** \brief records are written into a preallocated window of the logging file, mapped by every entity */
+#define  LOG_MAPPED        3
+
+/* Logging formats */
+
+/** \brief one line of text per record */
+#define  LOG_TEXT          0
+/** \brief one byte per entity per record */
+#define  LOG_BINARY        1
+
+/**
+ *  \brief Width of a column of the text format.
+ *
+ *  A column is headed by a blank, the letter of the kind and the number of the entity, in two digits or, once there
+ *  are 100 entities of a kind or more, in as many as the largest number takes; every column of a file is as wide.
+ *
+ *  \param nPlayers number of players
+ *  \param nGoalies number of goalies
+ *  \param nReferees number of referees (they are numbered from 1)
+ *
+ *  \return width of a column (characters)
+ */
+static inline int logColWidth (int nPlayers, int nGoalies, int nReferees)
+{
+    int top = nReferees, w = 4;                                                       /* largest number, width */
+
+    if (nPlayers - 1 > top) {
+        top = nPlayers - 1;
+    }
+    if (nGoalies - 1 > top) {
+        top = nGoalies - 1;
+    }
+    for (; top >= 100; top /= 10) {
+        w++;
+    }
+    return w;
+}
+
+/** \brief line of the header of the text format with the shape of the teams: teams per match, players and goalies
+           per team, and <tt>LOG_SPLIT</tt> if the logging file is split */
+#define  LOG_TEAMS         "Teams %d per match, of %d players and %d goalies%s\n"
+/** \brief end of the <tt>LOG_TEAMS</tt> line of a split logging file, that does not hold whole matches */
+#define  LOG_SPLIT         " - split logging file"
+
+/** \brief magic number of binary logging files */
+#define  LOG_MAGIC        "SGBL"
+/** \brief version of the binary format */
+#define  LOG_VERSION       3
+/** \brief arrival delays marker: a record with every byte set to it is followed by the seed of the match and the
+           arrival delays of its entities (us), as <tt>uint32_t</tt> */
+#define  LOG_DELAYS        1
+
+/**
+ *  \brief Definition of <em>binary logging file header</em> data type.
+ */
+typedef struct
+{   /** \brief magic number - <tt>LOG_MAGIC</tt> */
+    char magic[4];
+
+    /** \brief format version - <tt>LOG_VERSION</tt> */
+    uint16_t version;
+
+    /** \brief number of players (bytes 0 .. nPlayers-1 of each record) */
+    uint16_t nPlayers;
+
+    /** \brief number of goalies (following bytes) */
+    uint16_t nGoalies;
+
+    /** \brief number of referees (last bytes) */
+    uint16_t nReferees;
+
+    /** \brief seed of the first match, that replays the batch (option <tt>-S</tt> of the generator) */
+    uint32_t seed;
+
+    /** \brief number of teams in each match */
+    uint16_t nTeams;
+
+    /** \brief number of players in each team */
+    uint16_t teamPlayers;
+
+    /** \brief number of goalies in each team */
+    uint16_t teamGoalies;
+
+    /** \brief the logging file is split: it does not hold whole matches (see <tt>pitchLogName</tt>) */
+    uint16_t split;
+
+} LOG_BIN_HDR;
+
+/* Entity kinds of state change records */
+
+/** \brief end of log marker */
+#define  LOG_END           0
+/** \brief player */
+#define  LOG_PLAYER       'P'
+/** \brief goalie */
+#define  LOG_GOALIE       'G'
+/** \brief referee */
+#define  LOG_REFEREE      'R'
+
 /**
  *  \brief File initialization.
  *
@@ -25,11 +169,16 @@
  *
  *  The file header consists of
  *       \li a title line
+ *       \li the shape of the teams (<tt>LOG_TEAMS</tt>)
  *       \li a blank line.
  *
+ *  In <tt>LOG_BINARY</tt> format the header is a <tt>LOG_BIN_HDR</tt> instead.
+ *
  *  \param nFic name of the logging file
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ *  \param p_lCtl pointer to the logging control, that sets the format of the file
  */
-extern void createLog (char nFic[], FULL_STAT *p_fSt);
+extern void createLog (char nFic[], FULL_STAT *p_fSt, LOG_CTL *p_lCtl);
 
 /**
  *  \brief write a log record (complete line) that includes the state of all entities and more info.
@@ -41,4 +190,164 @@ extern void createLog (char nFic[], FULL_STAT *p_fSt);
  */
 extern void saveState (char nFic[], FULL_STAT *p_fSt);
 
+/**
+ *  \brief Attaching the calling entity to the log.
+ *
+ *  Must be called once, after the mapping of the shared region. In <tt>LOG_BUFFERED</tt> mode the private
+ *  log file of the entity is opened here and its records are flushed on process exit (or by <tt>logDetach</tt>).
+ *  In the thread-based engine every entity thread attaches itself; the records of all of them are kept, in
+ *  sequence order, in the private log file of the process, opened by the first one.
+ *  In <tt>LOG_RING</tt> mode the entity kind and id are kept to fill its state change records.
+ *  In <tt>LOG_MAPPED</tt> mode the window of the match is mapped, unless the process already did.
+ *  In <tt>LOG_DIRECT</tt> mode nothing else is done. In every mode the entity is attached to the trace,
+ *  if there is one.
+ *
+ *  \param nFic name of the logging file
+ *  \param p_lCtl pointer to the logging control in the shared region
+ *  \param semgid semaphore set identifier
+ *  \param kind entity kind (<tt>LOG_PLAYER</tt>, <tt>LOG_GOALIE</tt> or <tt>LOG_REFEREE</tt>)
+ *  \param id entity id
+ */
+extern void logAttach (char nFic[], LOG_CTL *p_lCtl, int semgid, int kind, int id);
+
+/**
+ *  \brief Detaching the process from the log.
+ *
+ *  In <tt>LOG_BUFFERED</tt> mode the pending records are flushed and the private log file is closed, so that it
+ *  can be merged before the process exits. Nothing is done in the other modes.
+ */
+extern void logDetach (void);
+
+/**
+ *  \brief Merging the private log files of the entities into the logging file.
+ *
+ *  Records are appended in sequence number order and the private files are removed.
+ *  Only meaningful in <tt>LOG_BUFFERED</tt> mode.
+ *
+ *  \param nFic name of the logging file
+ *  \param p_fSt pointer to the full internal state of the problem (only the configuration is read)
+ *  \param pids process identifiers of the entities that were attached to the log
+ *  \param nProc number of entities
+ */
+extern void mergeLog (char nFic[], FULL_STAT *p_fSt, int pids[], int nProc);
+
+/**
+ *  \brief Draining the shared log ring into the logging file.
+ *
+ *  Carried out by the logger process in <tt>LOG_RING</tt> mode. Records are formatted as complete lines, in
+ *  sequence order, until the end of log marker is found.
+ *
+ *  \param nFic name of the logging file
+ *  \param p_fSt pointer to the full internal state of the problem (only the configuration is read)
+ *  \param p_lCtl pointer to the logging control in the shared region
+ *  \param semgid semaphore set identifier
+ */
+extern void drainLog (char nFic[], FULL_STAT *p_fSt, LOG_CTL *p_lCtl, int semgid);
+
+/**
+ *  \brief Mapping a window of the logging file for the records of a match.
+ *
+ *  Carried out by the generator in <tt>LOG_MAPPED</tt> mode, once the records that precede the match were
+ *  appended. The file is extended by a window preallocated for every state change the match may take, that the
+ *  generator maps (its entity threads write through it, in the thread-based engine) and the entities map when they
+ *  attach to the log.
+ *
+ *  \param nFic name of the logging file
+ *  \param p_fSt pointer to the full internal state of the problem (only the configuration is read)
+ *  \param p_lCtl pointer to the logging control in the shared region
+ */
+extern void mapLog (char nFic[], FULL_STAT *p_fSt, LOG_CTL *p_lCtl);
+
+/**
+ *  \brief Trimming the logging file to the records of the match.
+ *
+ *  Carried out by the generator in <tt>LOG_MAPPED</tt> mode, once the entities of the match are done: the records
+ *  of the slots that were reserved are put in the order of their snapshots, its window is unmapped and the file is
+ *  truncated to those records.
+ *
+ *  \param nFic name of the logging file
+ *  \param p_fSt pointer to the full internal state of the problem (only the configuration is read)
+ *  \param p_lCtl pointer to the logging control in the shared region
+ */
+extern void trimLog (char nFic[], FULL_STAT *p_fSt, LOG_CTL *p_lCtl);
+
+/**
+ *  \brief Stopping the logger.
+ *
+ *  Appends the end of log marker to the shared log ring. Must only be called once every entity has terminated.
+ *
+ *  \param p_lCtl pointer to the logging control in the shared region
+ *  \param semgid semaphore set identifier
+ */
+extern void stopLog (LOG_CTL *p_lCtl, int semgid);
+
+/**
+ *  \brief Naming the logging file of a pitch.
+ *
+ *  When the match of each pitch is logged in a file of its own, the file of pitch <tt>pitch</tt> is the logging
+ *  file name followed by <tt>.pitch</tt> and the pitch number (from 1); otherwise it is the logging file itself.
+ *  Only meaningful in <tt>LOG_DIRECT</tt> mode.
+ *
+ *  \param name pointer to the location where the name is stored
+ *  \param nFic name of the logging file
+ *  \param p_lCtl pointer to the logging control, that sets whether the pitches are logged apart
+ *  \param pitch pitch (0 .. nReferees-1)
+ */
+extern void pitchLogName (char name[], char nFic[], LOG_CTL *p_lCtl, int pitch);
+
+/**
+ *  \brief Separating the runs of a batch in the logging file.
+ *
+ *  Appends a line that announces the run <tt>run</tt>, preceded by a blank line. In <tt>LOG_BINARY</tt> format a
+ *  record with every byte set to <tt>LOG_END</tt> is appended instead, that <tt>logdecoder</tt> turns back into
+ *  the same lines.
+ *
+ *  \param nFic name of the logging file
+ *  \param p_fSt pointer to the full internal state of the problem (only the configuration is read)
+ *  \param run run number (from 1)
+ */
+extern void separateLog (char nFic[], FULL_STAT *p_fSt, int run);
+
+/**
+ *  \brief Recording the arrival delays of a match in the logging file.
+ *
+ *  Appends a line with the seed of the match, followed by a line with the time each player, goalie and referee
+ *  takes to arrive, aligned with the columns of the state lines; called after the header of the file or the
+ *  separator of the run, the match may be replayed with the same arrivals. In <tt>LOG_BINARY</tt> format a record
+ *  with every byte set to <tt>LOG_DELAYS</tt> is appended instead, followed by the seed and the delays as
+ *  <tt>uint32_t</tt>, that <tt>logdecoder</tt> turns back into the same lines.
+ *
+ *  \param nFic name of the logging file
+ *  \param p_fSt pointer to the full internal state of the problem (only the configuration is read)
+ *  \param delays arrival delays (us), players first, then goalies and referees
+ */
+extern void logDelays (char nFic[], FULL_STAT *p_fSt, unsigned int delays[]);
+
+/**
+ *  \brief Printing the present full state.
+ *
+ *  Writes the column header and the present full state as a line of text, whatever the format of the logging
+ *  file, to the stream <tt>fp</tt>; meant for diagnostics.
+ *
+ *  \param fp output stream
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ */
+extern void printState (FILE *fp, FULL_STAT *p_fSt);
+
+/**
+ *  \brief Taking a snapshot of the state of the intervening entities.
+ *
+ *  Copies <tt>p_fSt->st</tt> without taking the locks of the writers: the copy is taken again until no write of the
+ *  state (see <tt>SETSTATE</tt>) was under way or began while it was taken, so it never mixes states from before and
+ *  after a change. Meant for the observers of a match: the log, the watchdog and the monitors. The copies of
+ *  concurrent observers are ordered by the number of writes they reflect, not by the time they are used: the log
+ *  writes the line of a copy under its lock, or records that number with it (see <tt>saveState</tt>).
+ *
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ *  \param p_st pointer to the copy, of size <tt>STATSIZE</tt> for the population
+ *
+ *  \return number of writes of the state that the copy reflects
+ */
+extern unsigned int snapshotState (FULL_STAT *p_fSt, STAT *p_st);
+
 #endif /* LOGGING_H_ */
@@ -11,19 +11,32 @@
 #ifndef PROBCONST_H_
 #define PROBCONST_H_
 
-/* Generic parameters */
+/* Generic parameters - defaults, the generator may override them on the command line */
  
 /** \brief total number of players */
 #define  NUMPLAYERS       10
 /** \brief total number of goalies */
 #define  NUMGOALIES        3
-/** \brief total number of referees */
+/** \brief total number of referees, one match is played on the pitch of each */
 #define  NUMREFEREES       1
 
 /** \brief number of players in each team */
 #define  NUMTEAMPLAYERS     4
 /** \brief number of goalies in teach team */
 #define  NUMTEAMGOALIES     1
+/** \brief number of teams in a match */
+#define  NUMTEAMS           2
+
+/** \brief maximum number of players plus goalies */
+#define  MAXENTITIES     8192
+
+/** \brief default time without a state change after which a match is taken as stalled (ms) */
+#define  WATCHDOGMS      5000
+
+/* Logging parameters */
+
+/** \brief number of records in the shared log ring */
+#define  LOGRINGSIZE     1024
 
 
 /* Player/Goalie state constants */
@@ -45,6 +58,8 @@
 /** \brief player/goalie playing */
 #define  LATE              'L'
 
+/* With more than two teams in a match, its odd teams share the states of team 1 and its even teams those of team 2 */
+
 /* Referee state constants */
 
 /** \brief referee initial state, arriving  */
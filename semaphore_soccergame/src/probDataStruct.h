@@ -14,52 +14,228 @@
 #define PROBDATASTRUCT_H_
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <stddef.h>
 
 #include "probConst.h"
+#include "cacheLine.h"
+#include "trace.h"
+
+/** \brief state of an intervening entity, a single character: one byte in the padded layout (see cacheLine.h) */
+#ifdef SOCCER_PADDED
+typedef uint8_t ESTATE;
+#else
+typedef unsigned int ESTATE;
+#endif
 
 /**
  *  \brief Definition of <em>state of the intervening entities</em> data type.
+ *
+ *  Its size depends on the population: the state of the players is followed by the state of the goalies and the
+ *  state of the referees in <tt>stat</tt>, that must be accessed through <tt>PLAYERSTAT</tt>, <tt>GOALIESTAT</tt> and
+ *  <tt>REFEREESTAT</tt>.
  */
 typedef struct {
-    /** \brief players state */
-    unsigned int playerStat[NUMPLAYERS];
-    /** \brief goalies state */
-    unsigned int goalieStat[NUMGOALIES];
-    /** \brief referees state */
-    unsigned int refereeStat;
+    /** \brief number of players */
+    LINEALIGNED unsigned int nPlayers;
+    /** \brief number of goalies */
+    unsigned int nGoalies;
+    /** \brief number of referees */
+    unsigned int nReferees;
+    /** \brief players state, followed by goalies state and referees state */
+    ESTATE stat[];
 
 } STAT;
 
+/** \brief size of the state of the intervening entities, for a given population */
+#define  STATSIZE(nPlayers,nGoalies,nReferees) \
+         (sizeof (STAT) + ((size_t) (nPlayers) + (nGoalies) + (nReferees)) * sizeof (ESTATE))
+
+/** \brief state of player <tt>p</tt>, in the state pointed by <tt>p_st</tt> */
+#define  PLAYERSTAT(p_st,p)             ((p_st)->stat[(p)])
+
+/** \brief state of goalie <tt>g</tt>, in the state pointed by <tt>p_st</tt> */
+#define  GOALIESTAT(p_st,g)             ((p_st)->stat[(p_st)->nPlayers + (g)])
+
+/** \brief state of referee <tt>r</tt>, in the state pointed by <tt>p_st</tt> */
+#define  REFEREESTAT(p_st,r)            ((p_st)->stat[(p_st)->nPlayers + (p_st)->nGoalies + (r)])
+
 
 /**
  *  \brief Definition of <em>full state of the problem</em> data type.
+ *
+ *  The configuration of the match is read-mostly. In the padded layout each group of counters that is written by
+ *  different processes at the same time starts a cache line of its own: the arrival counters, the counters of the
+ *  critical region, the team ids taken, the state changes (and the counters of writes of the state), the next pitch
+ *  and the state of the entities.
  */
 typedef struct
-{   /** \brief state of all intervening entities */
-    STAT st;
-
-    /** \brief total number of players */
+{   /** \brief total number of players */
     int nPlayers;
 
     /** \brief total number of goalies */
     int nGoalies;
 
-    /** \brief total number of referees */
+    /** \brief total number of referees, one per pitch */
     int nReferees;
 
-    /** \brief number of players that already arrived */
-    int playersArrived;
-    /** \brief number of goalies that already arrived */
-    int goaliesArrived;
-    /** \brief number of players that arrived and are free (no team) */
-    int playersFree;
-    /** \brief number of goalies that arrived and are free (no team) */
-    int goaliesFree;
+    /** \brief number of teams in a match */
+    int nTeams;
+
+    /** \brief number of players in each team */
+    int teamPlayers;
+
+    /** \brief number of goalies in each team */
+    int teamGoalies;
+
+    /** \brief the intervening entities do not take time to arrive and to play (benchmark of the synchronization) */
+    bool noDelay;
+
+    /** \brief the delays advance a virtual clock instead of sleeping (thread-based engine, see vclock.h) */
+    bool virtualTime;
+
+    /** \brief seed of the random streams of the match: the stream of the entity of index e (players, then goalies,
+               then referees) is seeded with seed + e */
+    unsigned int seed;
+
+    /** \brief number of players that already arrived (updated outside the critical region) */
+    LINEALIGNED atomic_int playersArrived;
+    /** \brief number of goalies that already arrived (updated outside the critical region) */
+    LINEALIGNED atomic_int goaliesArrived;
+    /** \brief number of players that joined the queue of those waiting for a team - initial value=0 */
+    LINEALIGNED int playerQueueIn;
+    /** \brief number of players taken off that queue by the forming teammates: the players from playerQueueOut to
+               playerQueueIn are free (no team) */
+    int playerQueueOut;
+    /** \brief number of goalies that joined the queue of those waiting for a team - initial value=0 */
+    int goalieQueueIn;
+    /** \brief number of goalies taken off that queue by the forming teammates */
+    int goalieQueueOut;
 
     /** \brief id of team that will be formed next - initial value=1 */
     int teamId;
 
+    /** \brief number of state changes of the match, watched by the generator to tell a stalled match */
+    LINEALIGNED atomic_uint changes;
+    /** \brief number of writes of <tt>st</tt> that were started (see <tt>SETSTATE</tt>) */
+    atomic_uint stBegin;
+    /** \brief number of writes of <tt>st</tt> that were completed: it equals <tt>stBegin</tt> when none is under way */
+    atomic_uint stEnd;
+
+    /** \brief pitch that will be taken by the next referee to wait for teams, whose teams are the next ones to be
+               formed (updated outside the critical region) */
+    LINEALIGNED atomic_int nextPitch;
+
+    /** \brief state of all intervening entities - variable size, must be the last field */
+    STAT st;
+
 } FULL_STAT;
 
+/**
+ *  \brief changing to <tt>s</tt> the state <tt>e</tt> of an entity of the full state pointed by <tt>p_fSt</tt>,
+ *         e.g. <tt>SETSTATE (&sh->fSt, PLAYERSTAT (&sh->fSt.st, id), LATE)</tt>.
+ *
+ *  The write is enclosed by the counters of writes of the state, so that an observer may take a consistent copy of it
+ *  without the locks of the writers (see <tt>snapshotState</tt>). Entities of different pitches change their states
+ *  at the same time, so the counters are two instead of the parity of a single one. The critical region where the
+ *  state is changed and logged does not order the log lines of different pitches: <tt>saveState</tt> does.
+ */
+#define  SETSTATE(p_fSt,e,s) \
+         do { atomic_fetch_add (&(p_fSt)->stBegin, 1); (e) = (s); atomic_fetch_add (&(p_fSt)->stEnd, 1); } while (0)
+
+/** \brief size of the full state of the problem, for a given population */
+#define  FULLSTATSIZE(nPlayers,nGoalies,nReferees) \
+         (offsetof (FULL_STAT, st) + STATSIZE (nPlayers, nGoalies, nReferees))
+
+/**
+ *  \brief Definition of <em>state change record</em> data type.
+ *
+ *  Compact description of a single state change, as stored in the shared log ring.
+ */
+typedef struct
+{   /** \brief sequence number of the record */
+    unsigned int seq;
+
+    /** \brief entity kind (see logging.h) */
+    unsigned char kind;
+
+    /** \brief new state of the entity */
+    unsigned char state;
+
+    /** \brief entity id */
+    unsigned short id;
+
+    /** \brief time of the state change (ns, monotonic clock) */
+    uint64_t ts;
+
+    /** \brief sequence number of the record plus one, once it is completely written */
+    atomic_uint ready;
+
+} LOG_REC;
+
+/**
+ *  \brief Definition of <em>logging control</em> data type.
+ *
+ *  It lives in the shared region so that every intervening entity logs in the same mode and
+ *  takes its record sequence numbers from the same counter.
+ */
+typedef struct
+{   /** \brief logging mode (see logging.h) */
+    int mode;
+
+    /** \brief logging file format (see logging.h) */
+    int format;
+
+    /** \brief sequence number of the next record of the ring - taken by atomic increment, as entities on
+               different pitches log concurrently */
+    LINEALIGNED atomic_uint seq;
+
+    /** \brief sequence number of the next record to be drained from the ring by the logger */
+    LINEALIGNED atomic_uint tail;
+
+    /** \brief number of entities that wait for a free slot in the ring */
+    atomic_int waitSlots;
+
+    /** \brief set by the logger when it waits for records in the ring */
+    LINEALIGNED atomic_int waitItems;
+
+    /** \brief the match of each pitch is logged in a file of its own (see logging.h) */
+    LINEALIGNED bool split;
+
+    /** \brief name of the trace file - null string if the entities are not traced (see trace.h) */
+    char trace[TRACENAMESIZE];
+
+    /** \brief identification of semaphore used by entities to wait for a free slot in the ring - val = 0 */
+    unsigned int slots;
+
+    /** \brief identification of semaphore used by the logger to wait for records in the ring - val = 0 */
+    unsigned int items;
+
+    /** \brief identification of semaphore that makes the snapshot of the state and the writing of its line a single
+               step, in direct mode, so that the entities of different pitches write their lines in the order of
+               their snapshots - val = 1 */
+    unsigned int lock;
+
+    /** \brief offset, from this logging control, of the state of the intervening entities when the log was
+               created */
+    size_t baseOff;
+
+    /** \brief offset, in the logging file, of the window preallocated for the records of the match, in mapped
+               mode */
+    uint64_t mapBase;
+
+    /** \brief size of the window (bytes), in mapped mode */
+    uint64_t mapCap;
+
+    /** \brief number of bytes of the window reserved by the records of the match, in mapped mode - taken by atomic
+               addition, as entities on different pitches log concurrently */
+    LINEALIGNED atomic_uint_least64_t mapUsed;
+
+    /** \brief ring of state change records */
+    LINEALIGNED LOG_REC ring[LOGRINGSIZE];
+
+} LOG_CTL;
+
 
 #endif /* PROBDATASTRUCT_H_ */
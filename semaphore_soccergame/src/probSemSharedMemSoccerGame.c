@@ -11,9 +11,88 @@
  *  Upon execution, one parameter is requested:
  *    \li name of the logging file.
  *
+ *  Options:
+ *    \li <tt>-b</tt>: buffered logging - entities keep their records in private files that are merged at the end
+ *    \li <tt>-r</tt>: ring logging - entities append state change records to a shared ring drained by a logger
+ *    \li <tt>-M</tt>: mapped logging - entities write their records straight into a preallocated window of the
+ *        logging file, that they map (a logging file must be named)
+ *    \li <tt>-B</tt>: binary logging file - one byte per entity per record, decoded by <tt>logdecoder</tt>
+ *    \li <tt>-s</tt>: split logging file - the match of each pitch is logged in a file of its own (direct logging
+ *        only)
+ *    \li <tt>-p n</tt>: number of players (default <tt>NUMPLAYERS</tt>)
+ *    \li <tt>-g n</tt>: number of goalies (default <tt>NUMGOALIES</tt>)
+ *    \li <tt>-R n</tt>: number of referees, each one referees a match on a pitch of its own (default
+ *        <tt>NUMREFEREES</tt>)
+ *    \li <tt>-t n</tt>: number of teams in each match (default <tt>NUMTEAMS</tt>)
+ *    \li <tt>-P n</tt>: number of players in each team (default <tt>NUMTEAMPLAYERS</tt>)
+ *    \li <tt>-G n</tt>: number of goalies in each team (default <tt>NUMTEAMGOALIES</tt>)
+ *    \li <tt>-n n</tt> or <tt>--runs n</tt>: number of consecutive matches (default 1)
+ *    \li <tt>-o</tt> or <tt>--tournament</tt>: tournament - the matches of the batch are rounds played by the same
+ *        entity processes, that wait for the next round once theirs is over (process-based engine only)
+ *    \li <tt>-z</tt>: no delays - the intervening entities do not take time to arrive and to play, so that only the
+ *        synchronization is measured
+ *    \li <tt>-V</tt>: virtual time - the delays of the intervening entities advance a virtual clock instead of
+ *        sleeping and the entities take turns in virtual time order (thread-based engine only, see vclock.h)
+ *    \li <tt>-S n</tt> or <tt>--seed n</tt>: seed of the random delays (default: the process id of the generator)
+ *    \li <tt>-w ms</tt>: watchdog - a match without state changes for that long is stalled (default
+ *        <tt>WATCHDOGMS</tt>, 0 disables it)
+ *    \li <tt>-k</tt>: worker pool - a worker process per entity is generated once for the whole batch and runs its
+ *        life cycle in every match (process-based engine only, see semSharedMemWorker.c)
+ *    \li <tt>-e</tt> or <tt>--errors</tt>: collected diagnostics - the entities report into a pipe of the
+ *        generator instead of an error file each, and the reports are written, tagged by entity, into
+ *        <tt>ERRORFILE</tt>, that is only created if there is any (process-based engine only, see errorChannel.h)
+ *    \li <tt>-m file</tt>: metrics file - the timing of each match, as comma separated values (see
+ *        <tt>saveMetrics</tt>)
+ *    \li <tt>-T file</tt>: trace file - the time spent by every entity in each state, and blocked on each
+ *        semaphore, in the trace event format of Chrome and Perfetto (see trace.h)
+ *    \li <tt>-a policy</tt> or <tt>--affinity policy</tt>: placement - every entity is pinned to a processor,
+ *        <tt>compact</tt> (on the last level cache of the generator), <tt>spread</tt> (over every cache) or from a
+ *        list such as <tt>0,2,4-7</tt>, and the shared region is placed on their memory node (see affinity.h).
+ *
+ *  The shared region is sized for the population and the intervening entities read it from there. Players and
+ *  goalies that are not needed for the teams are late. The matches are played concurrently, each one taken by the
+ *  first referee that is free once its teams are formed.
+ *
+ *  The shared region and the semaphore set are created with a private key, that is passed to the entities in the
+ *  <tt>KEYENV</tt> environment variable, so that many simulations may run at the same time. They are destroyed if
+ *  the generator terminates early (on error or upon a fatal signal), and the entities are killed with it. The
+ *  entities are generated with <tt>posix_spawn</tt>, so that the generator address space is not copied.
+ *
+ *  In a batch of runs the shared region and the semaphore set are created once and reinitialized before each
+ *  match; the runs are separated in the logging file and their aggregate timing is reported on stderr. In a
+ *  tournament the entities are only generated for the first round: at the end of every round each one ups
+ *  <tt>roundEnd</tt> and waits on the <tt>roundStart</tt> semaphore of the next round (there are two, used in
+ *  turns), the generator counts them on <tt>roundEnd</tt>,
+ *  reinitializes the shared region while they wait and releases them for the next round (or to terminate, after
+ *  the last one). Late players and goalies take part in the next match like everybody else. A stalled round is
+ *  killed and the next one generates the entities again.
+ *
+ *  A stalled match, that deadlocked or lost an entity, is reported on stderr with the present state and the value
+ *  of every semaphore. In the process-based engine its processes are then killed and the batch goes on with the
+ *  next run; the generator terminates with a failure status at the end. In the thread-based engine the simulation
+ *  terminates at once.
+ *
+ *  The time every entity takes to arrive, and the time each match takes, are drawn by the generator before the
+ *  match, from a random stream of the entity seeded with the seed of the match plus the entity index (players,
+ *  then goalies, then referees); the first match of a batch has the seed of the command line and each one
+ *  advances it by the number of entities. The seed and the arrival delays are recorded in the logging file, so
+ *  that a simulation with the same seed and population replays the same arrivals, whatever the engine.
+ *
+ *  When built with <tt>SEM_STATS</tt> defined (<tt>make STATS=1</tt>), every semaphore operation is recorded in a
+ *  statistics block of the shared region, that is printed on stderr at the end.
+ *
+ *  The counters of the batch are kept in a monitoring page of the shared region, that <tt>soccertop</tt> watches
+ *  while the batch goes on (see soccerTop.c).
+ *
+ *  When built with <tt>SOCCER_THREADS</tt> defined (<tt>make threads</tt>), the intervening entities (and the
+ *  logger) run as threads of this process instead, on a process-private region and semaphore set; the options
+ *  and the logging file are the same.
+ *
  *  \author Nuno Lau - December 2024
  */
 
+#define _GNU_SOURCE                                                                /* pipe2, pthread_timedjoin_np */
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
@@ -23,13 +102,31 @@
 #include <sys/ipc.h>
 #include <string.h>
 #include <math.h>
+#include <stdint.h>
+#include <errno.h>
+#include <getopt.h>
+#include <limits.h>
+#include <time.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <fcntl.h>
+#include <spawn.h>
+#ifdef SOCCER_THREADS
+#include <pthread.h>
+#endif
 
 #include "probConst.h"
 #include "probDataStruct.h"
 #include "logging.h"
 #include "sharedDataSync.h"
 #include "semaphore.h"
+#include "semStat.h"
 #include "sharedMemory.h"
+#include "trace.h"
+#include "vclock.h"
+#include "soccerThreads.h"
+#include "affinity.h"
+#include "errorChannel.h"
 
 /** \brief name of player program */
 #define   PLAYER               "./player"
@@ -40,149 +137,1497 @@
 /** \brief name of referee program */
 #define   REFEREE              "./referee"
 
-void launch_processes(char *bin, char *prefix, int nProc, char *logFilename, int *pids)
+/** \brief name of logger program */
+#define   LOGGER               "./logger"
+
+/** \brief path to the worker of the pool */
+#define   WORKER               "./worker"
+
+/** \brief name of the file of the collected diagnostics */
+#define   ERRORFILE            "error_log"
+
+#ifndef SOCCER_THREADS
+
+/** \brief generator process, that owns the IPC resources (its children inherit the exit handler until they exec) */
+static pid_t ipcOwner = -1;
+
+/** \brief shared memory access identifier, while the region exists */
+static int ipcShmid = -1;
+
+/** \brief semaphore set access identifier, while the set exists */
+static int ipcSemgid = -1;
+
+/** \brief signals upon which the generator terminates and destroys the IPC resources */
+static const int fatalSig[] = { SIGHUP, SIGINT, SIGQUIT, SIGTERM, SIGPIPE, SIGABRT, SIGSEGV, SIGBUS, SIGFPE };
+
+/** \brief destruction of the IPC resources that still exist, when the generator terminates */
+static void ipcCleanup (void)
+{
+    if (getpid () != ipcOwner) {
+        return;
+    }
+    if (ipcSemgid != -1) {
+        semDestroy (ipcSemgid);
+        ipcSemgid = -1;
+    }
+    if (ipcShmid != -1) {
+        shmemDestroy (ipcShmid);
+        ipcShmid = -1;
+    }
+}
+
+/** \brief termination of the generator upon a fatal signal: the IPC resources are destroyed first */
+static void ipcFatal (int sig)
 {
-    char idstr[3];
+    ipcCleanup ();
+    signal (sig, SIG_DFL);
+    raise (sig);
+}
+
+/** \brief pinning of the generator to the processor of entity <tt>e</tt>, that the process it generates next
+           inherits (see affinity.h) */
+static void pinNext (int e)
+{
+    if (affinityOn () && (affinityPin (e) == -1)) {
+        perror ("error on pinning the intervening entity");
+        exit (EXIT_FAILURE);
+    }
+}
+
+/** \brief the generator gets back its own processors, once the processes are generated */
+static void pinDone (void)
+{
+    if (affinityOn () && (affinityRestore () == -1)) {
+        perror ("error on restoring the processors of the generator");
+        exit (EXIT_FAILURE);
+    }
+}
+
+/** \brief generation of the processes of an entity, with posix_spawn: the address space of the generator is not
+    copied (the entities see to it that they do not outlive the generator, see <tt>ownerAlive</tt>); process p is
+    entity base + p of the placement */
+void launch_processes(char *bin, char *prefix, int base, int nProc, char *logFilename, int *pids)
+{
+    char idstr[12];
     char errorFilename[128];
+    char *args[] = { bin, idstr, logFilename, errorFilename, NULL };
     int p;
     for (p = 0; p < nProc; p++) {           
-        if ((pids[p] = fork ()) < 0) {
-            perror ("error on the fork operation");
-            exit (EXIT_FAILURE);
-        }
         sprintf(idstr,"%d", p);
         sprintf(errorFilename,"error_%s%02d", prefix, p); 
-        if (pids[p] == 0)
-            if (execl (bin, bin, idstr, logFilename, errorFilename, NULL) < 0) { 
-                perror ("error on the generation of the process");
-                exit (EXIT_FAILURE);
-            }
+        pinNext (base + p);
+        if ((errno = posix_spawn (&pids[p], bin, NULL, NULL, args, environ)) != 0) { 
+            perror ("error on the generation of the process");
+            exit (EXIT_FAILURE);
+        }
     }
+    pinDone ();
 }
 
+#else
 
+/** \brief attributes of the thread of entity <tt>e</tt>: it is pinned to its processor, if the entities are
+           placed (see affinity.h) */
+static pthread_attr_t *pinAttr (pthread_attr_t *attr, int e)
+{
+    cpu_set_t set;
 
-/**
- *  \brief Main program.
- *
- *  Its role is starting the simulation by generating the intervening entities processes (players, goalies and referee)
- *  and waiting for their termination.
- */
-int main (int argc, char *argv[])
+    if (!affinityOn ()) {
+        return NULL;
+    }
+    affinityMask (e, &set);
+    if (((errno = pthread_attr_init (attr)) != 0) ||
+        ((errno = pthread_attr_setaffinity_np (attr, sizeof (set), &set)) != 0)) {
+        perror ("error on pinning the intervening entity");
+        exit (EXIT_FAILURE);
+    }
+    return attr;
+}
+
+/** \brief creation of the threads of an entity: thread t is entity base + t of the placement */
+void launch_threads(void *(*entry) (void *), int base, int nThr, pthread_t *tids)
 {
-    char nFic[51];                                                                              /*name of logging file */
-    int shmid,                                                                      /* shared memory access identifier */
-        semgid;                                                                     /* semaphore set access identifier */
-    unsigned int  m;                                                                             /* counting variables */
-    SHARED_DATA *sh;                                                                /* pointer to shared memory region */
-    int pidPL[NUMPLAYERS],                                                         /* players process identifier array */
-        pidGL[NUMGOALIES],                                                         /* goalies process identifier array */
-        pidRF;                                                                           /* referee process identifier */
-    int key;                                                           /*access key to shared memory and semaphore set */
-    int status,                                                                                    /* execution status */
-        info;                                                                                               /* info id */
+    pthread_attr_t attr, *p_attr;
+    int t;
+    for (t = 0; t < nThr; t++) {
+        p_attr = pinAttr (&attr, base + t);
+        if ((errno = pthread_create (&tids[t], p_attr, entry, (void *) (intptr_t) t)) != 0) {
+            perror ("error on the creation of the thread");
+            exit (EXIT_FAILURE);
+        }
+        if (p_attr != NULL) {
+            pthread_attr_destroy (p_attr);
+        }
+    }
+}
 
-    /* getting log file name */
-    if(argc==2) {
-        strcpy(nFic, argv[1]);
+void join_threads(int nThr, pthread_t *tids)
+{
+    int t;
+    for (t = 0; t < nThr; t++) {
+        if ((errno = pthread_join (tids[t], NULL)) != 0) {
+            perror ("error on waiting for an intervening thread");
+            exit (EXIT_FAILURE);
+        }
     }
-    else strcpy(nFic, "");
+}
 
-    /* getting key value */
-    if ((key = ftok (".", 'a')) == -1) {
-        perror ("error on generating the key");
-        exit (EXIT_FAILURE);
+
+/** \brief parameters of the logger thread */
+typedef struct
+{   /** \brief name of logging file */
+    char *nFic;
+    /** \brief pointer to shared region */
+    SHARED_DATA *sh;
+    /** \brief semaphore set access identifier */
+    int semgid;
+} LOGGER_ARG;
+
+/** \brief logger thread: drains the shared log ring into the logging file */
+static void *loggerThread (void *arg)
+{
+    LOGGER_ARG *lg = arg;
+
+    drainLog (lg->nFic, &lg->sh->fSt, &lg->sh->logCtl, lg->semgid);
+    atomic_fetch_add (&lg->sh->semOps, semOpCount);                            /* reporting the synchronization cost */
+    return NULL;
+}
+
+#endif
+
+/** \brief usage message */
+static void usage (char *prog)
+{
+    fprintf (stderr, "Usage: %s [-b|-r|-M|-s] [-B] [-p players] [-g goalies] [-R referees] [-t teams] [-P teamPlayers] "
+                     "[-G teamGoalies] [-n|--runs runs] [-o|--tournament] [-z|-V] [-S seed] [-w ms] [-k] [-e] [-m metrics] [-T trace] [-a policy] [logfile]\n", prog);
+    exit (EXIT_FAILURE);
+}
+
+/** \brief numerical option value, that must be at least <tt>min</tt> and at most <tt>max</tt> */
+static int numOption (char *prog, char *arg, int min, int max)
+{
+    char *tinp;                                                                   /* numerical parameters test flag */
+    long val = strtol (arg, &tinp, 0);
+
+    if ((*tinp != '\0') || (val < min) || (val > max)) {
+        usage (prog);
     }
+    return (int) val;
+}
 
-    /* creating and initializing the shared memory region and the log file */
-    if ((shmid = shmemCreate (key, sizeof (SHARED_DATA))) == -1) { 
-        perror ("error on creating the shared memory region");
-        exit (EXIT_FAILURE);
+/** \brief seed option value, any unsigned integer */
+static unsigned int seedOption (char *prog, char *arg)
+{
+    char *tinp;                                                                   /* numerical parameters test flag */
+    unsigned long val = strtoul (arg, &tinp, 0);
+
+    if ((*tinp != '\0') || (*arg == '-') || (val > UINT_MAX)) {
+        usage (prog);
     }
-    if (shmemAttach (shmid, (void **) &sh) == -1) { 
-        perror ("error on mapping the shared region on the process address space");
-        exit (EXIT_FAILURE);
+    return (unsigned int) val;
+}
+
+/**
+ *  \brief Drawing the delays of the intervening entities for a match.
+ *
+ *  Each entity has a random stream of its own, seeded with the seed of the match plus the entity index, from which
+ *  its arrival delay is drawn (and the duration of its match, for a referee), with the distributions of the
+ *  original simulation.
+ *
+ *  \param sh pointer to the shared region (the population, the seed and the offsets must be set)
+ */
+static void drawDelays (SHARED_DATA *sh)
+{
+    unsigned int e = 0;                                                                      /* entity index */
+    int p, g, r;
+
+    for (p = 0; p < sh->fSt.nPlayers; p++) {
+        srandom (sh->fSt.seed + e++);
+        PLAYERDELAY (sh, p) = (unsigned int) ((200.0*random())/(RAND_MAX+1.0)+50.0);
+    }
+    for (g = 0; g < sh->fSt.nGoalies; g++) {
+        srandom (sh->fSt.seed + e++);
+        GOALIEDELAY (sh, g) = (unsigned int) ((200.0*random())/(RAND_MAX+1.0)+60.0);
     }
+    for (r = 0; r < sh->fSt.nReferees; r++) {
+        srandom (sh->fSt.seed + e++);
+        REFEREEDELAY (sh, r) = (unsigned int) ((100.0*random())/(RAND_MAX+1.0)+10.0);
+        PLAYDELAY (sh, r) = (unsigned int) ((100.0*random())/(RAND_MAX+1.0)+900.0);
+    }
+}
+
+/** \brief offset rounded up to the alignment <tt>a</tt> */
+static size_t alignUp (size_t off, size_t a)
+{
+    return (off + a - 1) / a * a;
+}
 
-    /* initialize random generator */
-    srandom ((unsigned int) getpid ());                                
+/**
+ *  \brief Layout of the shared region for a given population.
+ *
+ *  Sets the offsets of the variable size arrays that follow the state of the intervening entities.
+ *
+ *  \param p_cfg population (only the configuration fields are read)
+ *  \param p_lay pointer to the location where the offsets are stored (only the offset fields are written)
+ *  \param p_baseOff pointer to the location where the offset of the initial state, from the start of the region,
+ *                   is stored
+ *
+ *  \return size of the shared region
+ */
+static size_t layoutSharedData (FULL_STAT *p_cfg, SHARED_DATA *p_lay, size_t *p_baseOff)
+{
+    size_t off = offsetof (SHARED_DATA, fSt) + FULLSTATSIZE (p_cfg->nPlayers, p_cfg->nGoalies, p_cfg->nReferees);
+
+    p_lay->playerQueueOff = off = alignUp (off, _Alignof (int));
+    off += (size_t) p_cfg->nPlayers * sizeof (int);
+    p_lay->goalieQueueOff = off = alignUp (off, _Alignof (int));
+    off += (size_t) p_cfg->nGoalies * sizeof (int);
+    p_lay->wordOff = off = alignUp (off, _Alignof (WAIT_WORD));
+    off += ((size_t) p_cfg->nPlayers + p_cfg->nGoalies) * sizeof (WAIT_WORD);
+    p_lay->teamOff = off = alignUp (off, _Alignof (BARRIER));
+    off += (size_t) p_cfg->nReferees * p_cfg->nTeams * sizeof (BARRIER);
+    p_lay->pitchOff = off = alignUp (off, _Alignof (PITCH));
+    off += (size_t) p_cfg->nReferees * sizeof (PITCH);
+    p_lay->delayOff = off = alignUp (off, _Alignof (unsigned int));
+    off += ((size_t) p_cfg->nPlayers + p_cfg->nGoalies + 2 * (size_t) p_cfg->nReferees) * sizeof (unsigned int);
+    p_lay->semStatOff = off = alignUp (off, _Alignof (SEM_USAGE));
+    off += (size_t) (SEM_NU (p_cfg->nReferees) + 1) * sizeof (SEM_USAGE);
+    *p_baseOff = off = alignUp (off, _Alignof (STAT));
+    off += STATSIZE (p_cfg->nPlayers, p_cfg->nGoalies, p_cfg->nReferees);
+
+    return (off > sizeof (SHARED_DATA)) ? off : sizeof (SHARED_DATA);
+}
+
+/**
+ *  \brief Initialization of the shared region for a match.
+ *
+ *  Sets the offsets of the variable size arrays, the population, the initial state of the intervening entities and
+ *  their delays (see <tt>drawDelays</tt>), the counters, the wait words, the semaphore ids and the barriers. The
+ *  logging mode, format and split are kept, so that the region may be reused for the consecutive matches of a
+ *  batch, and so are the semaphore statistics, that add up the operations of the whole batch.
+ *
+ *  \param sh pointer to the shared region
+ *  \param p_cfg population (only the configuration fields are read)
+ *  \param p_lay layout of the variable size arrays (only the offset fields are read)
+ */
+static void initSharedData (SHARED_DATA *sh, FULL_STAT *p_cfg, SHARED_DATA *p_lay)
+{
+    sh->playerQueueOff       = p_lay->playerQueueOff;                         /* variable size arrays of the region */
+    sh->goalieQueueOff       = p_lay->goalieQueueOff;
+    sh->wordOff              = p_lay->wordOff;
+    sh->teamOff              = p_lay->teamOff;
+    sh->pitchOff             = p_lay->pitchOff;
+    sh->delayOff             = p_lay->delayOff;
+    sh->semStatOff           = p_lay->semStatOff;
+
+    sh->fSt.nPlayers         = p_cfg->nPlayers;
+    sh->fSt.nGoalies         = p_cfg->nGoalies;
+    sh->fSt.nReferees        = p_cfg->nReferees;
+    sh->fSt.nTeams           = p_cfg->nTeams;
+    sh->fSt.teamPlayers      = p_cfg->teamPlayers;
+    sh->fSt.teamGoalies      = p_cfg->teamGoalies;
+    sh->fSt.noDelay          = p_cfg->noDelay;
+    sh->fSt.virtualTime      = p_cfg->virtualTime;
+    sh->fSt.seed             = p_cfg->seed;
+    sh->fSt.st.nPlayers      = (unsigned int) p_cfg->nPlayers;
+    sh->fSt.st.nGoalies      = (unsigned int) p_cfg->nGoalies;
+    sh->fSt.st.nReferees     = (unsigned int) p_cfg->nReferees;
 
-    /* initialize problem internal status */
     int p;
-    for (p = 0; p < NUMPLAYERS; p++) {
-        sh->fSt.st.playerStat[p]        = ARRIVING;                            /* the players are arriving */
+    for (p = 0; p < p_cfg->nPlayers; p++) {
+        PLAYERSTAT(&sh->fSt.st, p)      = ARRIVING;                            /* the players are arriving */
     }
     int g;
-    for (g = 0; g < NUMGOALIES; g++) {
-        sh->fSt.st.goalieStat[g]        = ARRIVING;                            /* the goalies are arriving */
+    for (g = 0; g < p_cfg->nGoalies; g++) {
+        GOALIESTAT(&sh->fSt.st, g)      = ARRIVING;                            /* the goalies are arriving */
+    }
+    int r;
+    for (r = 0; r < p_cfg->nReferees; r++) {
+        REFEREESTAT(&sh->fSt.st, r)     = ARRIVINGR;                          /* the referees are arriving */
     }
-    sh->fSt.st.refereeStat = ARRIVINGR;                                               /*referee is arriving*/
+    drawDelays (sh);
     
-    sh->fSt.nPlayers         = NUMPLAYERS;                                              
-    sh->fSt.nGoalies         = NUMGOALIES;
     sh->fSt.playersArrived   = 0;                                             
     sh->fSt.goaliesArrived   = 0;                                             
-    sh->fSt.playersFree      = 0;                                             
-    sh->fSt.goaliesFree      = 0;                                             
+    sh->fSt.playerQueueIn    = 0;                                              /* the queues are empty */
+    sh->fSt.playerQueueOut   = 0;
+    sh->fSt.goalieQueueIn    = 0;
+    sh->fSt.goalieQueueOut   = 0;
     sh->fSt.teamId           = 1;                                             
+    int e;
+    for (e = 0; e < p_cfg->nPlayers + p_cfg->nGoalies; e++) {        /* a stalled match may leave a word asleep */
+        wordInit (PLAYERWORD (sh, e));
+    }
+    sh->fSt.nextPitch        = 0;
+    sh->fSt.changes          = 0;
+    sh->tArrive              = 0;                                                   /* timing of the matches */
+    sh->semOps               = 0;
 
-    /* create log file */
-    createLog (nFic, &sh->fSt);                                  
-    saveState(nFic,&sh->fSt);
+    sh->logCtl.seq           = 0;
+    sh->logCtl.tail          = 0;
+    sh->logCtl.waitSlots     = 0;
+    sh->logCtl.waitItems     = 0;
+    memset (sh->logCtl.ring, 0, sizeof (sh->logCtl.ring));                        /* no record is ready */
 
     /* initialize semaphore ids */
     sh->mutex                       = MUTEX;                                /* mutual exclusion semaphore id */
-    sh->playersWaitTeam             = PLAYERSWAITTEAM;
-    sh->goaliesWaitTeam             = GOALIESWAITTEAM;
-    sh->playersWaitReferee          = PLAYERSWAITREFEREE;
-    sh->playersWaitEnd              = PLAYERSWAITEND;
-    sh->refereeWaitTeams            = REFEREEWAITTEAMS;
-    sh->playerRegistered            = PLAYERREGISTERED;
-    sh->playing                     = PLAYING;
- 
-     /* creating and initializing the semaphore set */
-    if ((semgid = semCreate (key, SEM_NU)) == -1) { 
-        perror ("error on creating the semaphore set");
+    sh->roundStart[0]               = ROUNDSTART (0);
+    sh->roundStart[1]               = ROUNDSTART (1);
+    sh->roundEnd                    = ROUNDEND;
+    for (r = 0; r < p_cfg->nReferees; r++) {                                            /* semaphores of the pitches */
+        PITCH *pt = &PITCHES (sh)[r];
+        pt->mutex                   = PITCHMUTEX (r);
+        pt->playersWaitReferee      = PLAYERSWAITREFEREE (r);
+        pt->playersWaitEnd          = PLAYERSWAITEND (r);
+        pt->playing                 = PLAYING (r);
+        pt->teamsFormed             = TEAMSFORMED (r);
+        barrierInit (&pt->start, pt->playersWaitReferee, pt->playing);
+        barrierInit (&pt->end, pt->playersWaitEnd, 0);
+        pt->referee                 = -1;
+        pt->tTeams = pt->tStart = pt->tPlaying = pt->tEnd = 0;
+        pt->tLeft                   = 0;
+    }
+    int t;
+    for (t = 1; t <= p_cfg->nReferees * p_cfg->nTeams; t++) {                /* the referee of its pitch waits */
+        barrierInit (TEAM (sh, t), 0, PITCHES (sh)[TEAMPITCH (sh, t)].teamsFormed);
+    }
+    sh->logCtl.slots                = LOGSLOTS;
+    sh->logCtl.items                = LOGITEMS;
+    sh->logCtl.lock                 = LOGLOCK;
+}
+
+/** \brief time interval from <tt>t0</tt> to <tt>t1</tt> (ns), in us */
+static double usSince (uint64_t t0, uint64_t t1)
+{
+    return (t1 > t0) ? (double) (t1 - t0) / 1e3 : 0.0;
+}
+
+/**
+ *  \brief Timing of the matches of a run.
+ *
+ *  Appends one line per match (pitch) to the metrics file, with comma separated values:
+ *     \li run and pitch
+ *     \li match latency: from the first arrival to the last player or goalie leaving the match (us)
+ *     \li team formation: from the first arrival to the teams of the match being formed (us)
+ *     \li start handshake: from the referee releasing the teams to every one of them playing (us)
+ *     \li end release: from the referee ending the match to the last one leaving it (us)
+ *     \li semaphore operations per match, of every process (or thread), including the generator.
+ *
+ *  \param fp metrics file
+ *  \param sh pointer to the shared region
+ *  \param run run of the batch
+ */
+static void saveMetrics (FILE *fp, SHARED_DATA *sh, int run)
+{
+    double ops = (double) (atomic_load (&sh->semOps) + semOpCount) / sh->fSt.nReferees;
+    uint64_t tArrive = atomic_load (&sh->tArrive);
+    int r;
+
+    for (r = 0; r < sh->fSt.nReferees; r++) {
+        PITCH *pt = &PITCHES (sh)[r];
+        uint64_t tLeft = atomic_load (&pt->tLeft);
+        fprintf (fp, "%d,%d,%.3f,%.3f,%.3f,%.3f,%.1f\n", run, r, usSince (tArrive, tLeft),
+                 usSince (tArrive, pt->tTeams), usSince (pt->tStart, pt->tPlaying), usSince (pt->tEnd, tLeft), ops);
+    }
+}
+
+/** \brief latency <tt>t0</tt> to <tt>t1</tt> (ns, monotonic clock) of a phase, added to its statistics */
+static void timePhase (PHASE_STAT *ph, uint64_t t0, uint64_t t1)
+{
+    uint64_t ns = (t1 > t0) ? t1 - t0 : 0, us;
+    unsigned int b;                                                                                /* histogram bin */
+
+    atomic_fetch_add_explicit (&ph->n, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit (&ph->sumNs, ns, memory_order_relaxed);
+    for (b = 0, us = ns / 1000; (us > 0) && (b < SEMSTATBINS - 1); us >>= 1) {
+        b++;
+    }
+    atomic_fetch_add_explicit (&ph->hist[b], 1, memory_order_relaxed);
+}
+
+/**
+ *  \brief Updating the monitoring page at the end of a run that was completed.
+ *
+ *  Adds the matches, the teams formed and the late arrivals of the run, and the latency of the phases of each match
+ *  (as in <tt>saveMetrics</tt>), to the counters of the batch.
+ *
+ *  \param sh pointer to the shared region
+ */
+static void saveMonitor (SHARED_DATA *sh)
+{
+    MONITOR *mon = &sh->mon;
+    uint64_t tArrive = atomic_load (&sh->tArrive);
+    unsigned long late = 0;
+    int e, r;
+
+    for (e = 0; e < sh->fSt.nPlayers + sh->fSt.nGoalies; e++) {               /* players, then goalies */
+        if (sh->fSt.st.stat[e] == LATE) {
+            late++;
+        }
+    }
+    for (r = 0; r < sh->fSt.nReferees; r++) {
+        PITCH *pt = &PITCHES (sh)[r];
+        uint64_t tLeft = atomic_load (&pt->tLeft);
+        timePhase (&mon->phase[PHASE_MATCH], tArrive, tLeft);
+        timePhase (&mon->phase[PHASE_TEAMS], tArrive, pt->tTeams);
+        timePhase (&mon->phase[PHASE_START], pt->tStart, pt->tPlaying);
+        timePhase (&mon->phase[PHASE_END], pt->tEnd, tLeft);
+    }
+    atomic_fetch_add (&mon->matches, (unsigned long) sh->fSt.nReferees);
+    atomic_fetch_add (&mon->teams, (unsigned long) (sh->fSt.teamId - 1));
+    atomic_fetch_add (&mon->late, late);
+}
+
+/** \brief name of semaphore <tt>s</tt> of the set */
+static void semName (char name[], unsigned int s)
+{
+    static const char *global[] = { "", "mutex", "logSlots", "logItems", "roundStart0", "roundStart1", "roundEnd",
+                                    "logLock" };
+    static const char *pitch[] = { "mutex", "playersWaitReferee", "playersWaitEnd", "playing", "teamsFormed" };
+
+    if (s < PITCHMUTEX (0)) {
+        strcpy (name, global[s]);
+    }
+    else sprintf (name, "pitch%02u.%s", (s - PITCHMUTEX (0)) / 5, pitch[(s - PITCHMUTEX (0)) % 5]);
+}
+
+#ifdef SEM_STATS
+
+/**
+ *  \brief Printing of the semaphore statistics.
+ *
+ *  One line per semaphore that was operated on: number of downs, of those that blocked (and their share), of
+ *  ups, total and mean time blocked, and the histogram of the time blocked as <tt>bound:count</tt> pairs, where
+ *  the bound is the power of two (us) that the waits counted stayed below.
+ *
+ *  \param fp output file
+ *  \param sh pointer to the shared region
+ */
+static void saveSemStats (FILE *fp, SHARED_DATA *sh)
+{
+    char name[40];                                                                             /* semaphore name */
+    unsigned int s, b;
+
+    fprintf (fp, "%-28s %10s %10s %6s %10s %12s %10s  %s\n", "semaphore", "downs", "blocked", "%", "ups",
+             "blocked_ms", "mean_us", "blocked_us_histogram");
+    for (s = 1; s <= (unsigned int) SEM_NU (sh->fSt.nReferees); s++) {
+        SEM_USAGE *st = &SEMSTATS (sh)[s];
+        unsigned long downs = atomic_load (&st->downs), blocked = atomic_load (&st->blocked);
+        double waitNs = (double) atomic_load (&st->waitNs);
+        if ((downs == 0) && (atomic_load (&st->ups) == 0)) {
+            continue;
+        }
+        semName (name, s);
+        fprintf (fp, "%-28s %10lu %10lu %6.1f %10lu %12.3f %10.3f ", name, downs, blocked,
+                 (downs > 0) ? 100.0 * blocked / downs : 0.0, atomic_load (&st->ups), waitNs / 1e6,
+                 (blocked > 0) ? waitNs / 1e3 / blocked : 0.0);
+        for (b = 0; b < SEMSTATBINS; b++) {
+            if (atomic_load (&st->hist[b]) > 0) {
+                fprintf (fp, " %lu:%lu", 1UL << b, atomic_load (&st->hist[b]));
+            }
+        }
+        fprintf (fp, "\n");
+    }
+}
+
+#endif
+
+/** \brief time without a state change after which a match is stalled (ms) - 0 disables the watchdog */
+static unsigned int watchMs = WATCHDOGMS;
+
+/** \brief the life cycles are run by a pool of workers, generated once for the whole batch (-k) */
+static bool usePool = false;
+
+/** \brief the entities of a tournament wait for the next round: the semaphore set is not reset (-o) */
+static bool entitiesWait = false;
+
+/** \brief period of the watchdog checks (ms) */
+#define  WATCHTICKMS      100
+
+/** \brief state changes of the match when the watchdog last saw them change */
+static unsigned int watchChanges;
+
+/** \brief when the watchdog last saw the state changes change (ms, monotonic clock) */
+static uint64_t watchSince;
+
+/** \brief arming the watchdog for a match */
+static void watchStart (SHARED_DATA *sh)
+{
+    watchChanges = atomic_load (&sh->fSt.changes);
+    watchSince = benchTime () / 1000000;
+}
+
+/** \brief watchdog check: true if the match made no progress for <tt>watchMs</tt> */
+static bool watchStalled (SHARED_DATA *sh)
+{
+    unsigned int changes = atomic_load (&sh->fSt.changes);
+    uint64_t now = benchTime () / 1000000;
+
+    if (changes != watchChanges) {
+        watchChanges = changes;
+        watchSince = now;
+        return false;
+    }
+    return (watchMs > 0) && (now - watchSince >= watchMs);
+}
+
+/**
+ *  \brief Reporting a stalled match on stderr.
+ *
+ *  Prints the present full state and the value of every semaphore of the set.
+ *
+ *  \param sh pointer to the shared region
+ *  \param semgid semaphore set access identifier
+ *  \param run run number (from 1)
+ */
+static void reportStall (SHARED_DATA *sh, int semgid, int run)
+{
+    char name[40];                                                                             /* semaphore name */
+    unsigned int s;
+
+    fprintf (stderr, "run %d stalled: no state change for %u ms\n", run, watchMs);
+    printState (stderr, &sh->fSt);
+    for (s = 1; s <= (unsigned int) SEM_NU (sh->fSt.nReferees); s++) {
+        semName (name, s);
+        fprintf (stderr, "%-28s %d\n", name, semValue (semgid, s));
+    }
+}
+
+#ifndef SOCCER_THREADS
+
+/** \brief the watchdog period only interrupts the wait for the intervening entities */
+static void watchTick (int sig)
+{
+    (void) sig;
+}
+
+/** \brief killing the processes that did not terminate yet, and collecting them */
+static void killStalled (int pids[], int nProc)
+{
+    int status, p;
+
+    for (p = 0; p < nProc; p++) {
+        if (waitpid (pids[p], &status, WNOHANG) == 0) {                          /* not a terminated child */
+            kill (pids[p], SIGKILL);
+            waitpid (pids[p], &status, 0);
+        }
+    }
+}
+
+/** \brief number of workers of the pool */
+static int nWorkers = 0;
+
+/** \brief workers process identifier array - NULL while there is no pool */
+static int *pidWK = NULL;
+
+/** \brief write end of the command pipe of each worker */
+static int *cmdWK = NULL;
+
+/** \brief read end of the pipe on which the workers answer */
+static int doneWK = -1;
+
+/**
+ *  \brief Generation of the worker pool.
+ *
+ *  Every worker reads its commands from a pipe of its own, on its standard input, and all of them answer on a
+ *  single pipe, on their standard output. Like the entities, the workers wait for the start of operations.
+ *
+ *  \param nFic name of the logging file
+ *  \param nWk number of workers
+ */
+static void startPool (char nFic[], int nWk)
+{
+    posix_spawn_file_actions_t acts;                                                   /* redirection of the pipes */
+    int done[2], cmd[2];                                                                        /* pipe descriptors */
+    char idstr[12];
+    char errorFilename[128];
+    char *args[] = { WORKER, idstr, nFic, errorFilename, NULL };
+    int w;
+
+    pidWK = malloc ((size_t) nWk * sizeof (int));
+    cmdWK = malloc ((size_t) nWk * sizeof (int));
+    if ((pidWK == NULL) || (cmdWK == NULL)) {
+        perror ("error on allocating the worker pool");
         exit (EXIT_FAILURE);
     }
-    if (semUp (semgid, sh->mutex) == -1) {                             /* enabling access to critical region */
-        perror ("error on executing the up operation for semaphore access");
+    if (pipe2 (done, O_CLOEXEC) == -1) {                            /* only the redirected ends are inherited */
+        perror ("error on creating the pipes of the worker pool");
         exit (EXIT_FAILURE);
     }
+    for (w = 0; w < nWk; w++) {
+        if (pipe2 (cmd, O_CLOEXEC) == -1) {
+            perror ("error on creating the pipes of the worker pool");
+            exit (EXIT_FAILURE);
+        }
+        sprintf (idstr, "%d", w);
+        sprintf (errorFilename, "error_WK%02d", w);
+        pinNext (w);                                                          /* worker w runs entity w */
+        if (((errno = posix_spawn_file_actions_init (&acts)) != 0) ||
+            ((errno = posix_spawn_file_actions_adddup2 (&acts, cmd[0], STDIN_FILENO)) != 0) ||
+            ((errno = posix_spawn_file_actions_adddup2 (&acts, done[1], STDOUT_FILENO)) != 0) ||
+            ((errno = posix_spawn (&pidWK[w], WORKER, &acts, NULL, args, environ)) != 0)) {
+            perror ("error on the generation of the worker");
+            exit (EXIT_FAILURE);
+        }
+        posix_spawn_file_actions_destroy (&acts);
+        close (cmd[0]);
+        cmdWK[w] = cmd[1];
+    }
+    pinDone ();
+    close (done[1]);                                                 /* the end of the answers is seen if they fail */
+    doneWK = done[0];
+    nWorkers = nWk;
+}
+
+/**
+ *  \brief Termination of the worker pool.
+ *
+ *  \param kill the workers are killed, instead of being told that there are no more commands
+ */
+static void stopPool (bool kill)
+{
+    int status, w;
+
+    if (kill) {
+        killStalled (pidWK, nWorkers);
+    }
+    for (w = 0; w < nWorkers; w++) {
+        close (cmdWK[w]);
+    }
+    close (doneWK);
+    if (!kill) {
+        for (w = 0; w < nWorkers; w++) {
+            if (waitpid (pidWK[w], &status, 0) == -1) {
+                perror ("error on waiting for a worker");
+                exit (EXIT_FAILURE);
+            }
+        }
+    }
+    free (pidWK);
+    free (cmdWK);
+    pidWK = cmdWK = NULL;
+    doneWK = -1;
+    nWorkers = 0;
+}
+
+/** \brief command to worker <tt>w</tt>: running the life cycle of entity <tt>id</tt> of kind <tt>kind</tt> */
+static void sendWork (int w, int kind, int id)
+{
+    WORK_CMD cmd = { .kind = kind, .id = id };
+
+    if (write (cmdWK[w], &cmd, sizeof (cmd)) != sizeof (cmd)) {
+        perror ("error on commanding a worker");
+        exit (EXIT_FAILURE);
+    }
+}
+
+/**
+ *  \brief Waiting for the answer of a worker, once its life cycle is over.
+ *
+ *  \return process identifier of the worker, upon success
+ *  \return -\c 1, when an error occurs or the wait is interrupted (the actual situation is reported in
+ *          <tt>errno</tt>)
+ */
+static int waitWork (void)
+{
+    int w;
+    ssize_t n;
+
+    if ((n = read (doneWK, &w, sizeof (w))) == sizeof (w)) {
+        return pidWK[w];
+    }
+    if (n >= 0) {                                                                  /* every worker terminated */
+        errno = EPIPE;
+    }
+    return -1;
+}
+
+/** \brief entities process identifier array of a tournament (players, then goalies, then referees) - NULL while
+    they are not running */
+static int *pidTN = NULL;
+
+/**
+ *  \brief Waiting for an entity of the tournament to end its round.
+ *
+ *  \param semgid semaphore set access identifier
+ *  \param sh pointer to the shared region
+ *  \param m number of entities that already ended it
+ *
+ *  \return process identifier of the m-th entity (the round of each one is merged as a whole), upon success
+ *  \return -\c 1, when an error occurs or the watchdog period expires (the actual situation is reported in
+ *          <tt>errno</tt>, EINTR for the watchdog)
+ */
+static int waitRound (int semgid, SHARED_DATA *sh, unsigned int m)
+{
+    if (((watchMs > 0) ? semDownTimed (semgid, sh->roundEnd, WATCHTICKMS) : semDown (semgid, sh->roundEnd)) == 0) {
+        return pidTN[m];
+    }
+    if (errno == EAGAIN) {                                                       /* checking the progress */
+        errno = EINTR;
+    }
+    return -1;
+}
+
+/**
+ *  \brief End of the tournament: the entities waiting for the next round are released to terminate.
+ *
+ *  \param semgid semaphore set access identifier
+ *  \param sh pointer to the shared region
+ *  \param nEnt number of entities
+ */
+static void stopTournament (int semgid, SHARED_DATA *sh, int nEnt)
+{
+    int status, e;
+
+    atomic_store (&sh->over, true);
+    if (semUpN (semgid, sh->roundStart[(sh->round + 1) % 2], (unsigned int) nEnt) == -1) {
+        perror ("error on the up operation for semaphore access of roundStart");
+        exit (EXIT_FAILURE);
+    }
+    for (e = 0; e < nEnt; e++) {
+        if (waitpid (pidTN[e], &status, 0) == -1) {
+            perror ("error on waiting for an intervening process");
+            exit (EXIT_FAILURE);
+        }
+    }
+    free (pidTN);
+    pidTN = NULL;
+    entitiesWait = false;
+}
+
+/**
+ *  \brief Running one match.
+ *
+ *  Generates the intervening entities processes (and the logger), waits for their termination and completes the
+ *  logging file. The shared region and the semaphore set must be initialized. With the worker pool, the life
+ *  cycles are handed to the workers instead (the pool is generated by the first match) and the match is over
+ *  once every one of them has answered.
+ *
+ *  If the match makes no progress for <tt>watchMs</tt>, it is reported, the processes (or the whole pool) are
+ *  killed and the log is completed with the records they left; the semaphore set must then be reset before it
+ *  is used again.
+ *
+ *  \param nFic name of the logging file
+ *  \param sh pointer to the shared region
+ *  \param semgid semaphore set access identifier
+ *  \param p_cfg population
+ *  \param first first match of the semaphore set: the start of operations is signaled
+ *  \param run run number (from 1)
+ *
+ *  \return \c true, if the match was completed
+ */
+static bool runMatch (char nFic[], SHARED_DATA *sh, int semgid, FULL_STAT *p_cfg, bool first, int run)
+{
+    unsigned int  m;                                                                             /* counting variables */
+    int w;
+    int *pidPL,                                                                    /* players process identifier array */
+        *pidGL,                                                                    /* goalies process identifier array */
+        *pidRF,                                                                  /* referees process identifier array */
+        pidLG = -1;                                                                       /* logger process identifier */
+    int status,                                                                                    /* execution status */
+        info;                                                                                               /* info id */
+    int *pidAll;                                                               /* terminated processes identifiers */
+    int logMode = sh->logCtl.mode;                                                                     /* logging mode */
+    int nEnt = p_cfg->nPlayers + p_cfg->nGoalies + p_cfg->nReferees;                        /* number of entities */
+    bool stalled = false;                                                              /* the watchdog went off */
+    struct sigaction sa;                                                                    /* watchdog period */
+    struct itimerval tick = { { 0, 0 }, { 0, 0 } };
+
+    /* allocating the identifier arrays of the intervening entities */
+    pidPL = malloc ((size_t) p_cfg->nPlayers * sizeof (int));
+    pidGL = malloc ((size_t) p_cfg->nGoalies * sizeof (int));
+    pidRF = malloc ((size_t) p_cfg->nReferees * sizeof (int));
+    pidAll = malloc ((size_t) (p_cfg->nPlayers + p_cfg->nGoalies + p_cfg->nReferees) * sizeof (int));
+    if ((pidPL == NULL) || (pidGL == NULL) || (pidRF == NULL) || (pidAll == NULL)) {
+        perror ("error on allocating the identifier arrays");
+        exit (EXIT_FAILURE);
+    }
+
+    /* handing the life cycles to the worker pool: worker w runs entity w (players, then goalies, then referees) */
+    if (usePool) {
+        if (pidWK == NULL) {
+            startPool (nFic, nEnt);
+        }
+        for (w = 0; w < p_cfg->nPlayers; w++) {
+            sendWork (w, LOG_PLAYER, w);
+        }
+        for (w = 0; w < p_cfg->nGoalies; w++) {
+            sendWork (p_cfg->nPlayers + w, LOG_GOALIE, w);
+        }
+        for (w = 0; w < p_cfg->nReferees; w++) {
+            sendWork (p_cfg->nPlayers + p_cfg->nGoalies + w, LOG_REFEREE, w);
+        }
+    }
+
+    /* next round of a tournament: the entities are released, with the shared region reset */
+    else if (entitiesWait) {
+        memcpy (pidPL, pidTN, (size_t) p_cfg->nPlayers * sizeof (int));
+        memcpy (pidGL, pidTN + p_cfg->nPlayers, (size_t) p_cfg->nGoalies * sizeof (int));
+        memcpy (pidRF, pidTN + p_cfg->nPlayers + p_cfg->nGoalies, (size_t) p_cfg->nReferees * sizeof (int));
+        entitiesWait = false;
+        if (semUpN (semgid, sh->roundStart[sh->round % 2], (unsigned int) nEnt) == -1) {
+            perror ("error on the up operation for semaphore access of roundStart");
+            exit (EXIT_FAILURE);
+        }
+    }
 
     /* generation of intervening entities processes */                            
-    /* player processes */
-    launch_processes(PLAYER, "PL", NUMPLAYERS, nFic, pidPL);
+    else {
+        /* player processes */
+        launch_processes(PLAYER, "PL", 0, p_cfg->nPlayers, nFic, pidPL);
 
-    /* goalie processes */
-    launch_processes(GOALIE, "GL", NUMGOALIES, nFic, pidGL);
+        /* goalie processes */
+        launch_processes(GOALIE, "GL", p_cfg->nPlayers, p_cfg->nGoalies, nFic, pidGL);
 
-    /* smoker processes */
-    launch_processes(REFEREE, "RF", 1, nFic, &pidRF);
+        /* referee processes */
+        launch_processes(REFEREE, "RF", p_cfg->nPlayers + p_cfg->nGoalies, p_cfg->nReferees, nFic, pidRF);
+
+        /* in a tournament they play every round */
+        if (sh->tournament) {
+            if ((pidTN = malloc ((size_t) nEnt * sizeof (int))) == NULL) {
+                perror ("error on allocating the identifier arrays");
+                exit (EXIT_FAILURE);
+            }
+            memcpy (pidTN, pidPL, (size_t) p_cfg->nPlayers * sizeof (int));
+            memcpy (pidTN + p_cfg->nPlayers, pidGL, (size_t) p_cfg->nGoalies * sizeof (int));
+            memcpy (pidTN + p_cfg->nPlayers + p_cfg->nGoalies, pidRF, (size_t) p_cfg->nReferees * sizeof (int));
+        }
+    }
+
+    /* logger process */
+    if (logMode == LOG_RING) {
+        launch_processes(LOGGER, "LG", nEnt, 1, nFic, &pidLG);
+    }
 
 
     /* signaling start of operations */
-    if (semSignal (semgid) == -1) {
+    if (first && (semSignal (semgid) == -1)) {
         perror ("error on signaling start of operations");
         exit (EXIT_FAILURE);
     }
 
-    /* waiting for the termination of the intervening entities processes */
+    /* waiting for the termination of the intervening entities processes, checking the progress periodically */
+    watchStart (sh);
+    if (watchMs > 0) {
+        sa.sa_handler = watchTick;
+        sigemptyset (&sa.sa_mask);
+        sa.sa_flags = 0;                                                          /* wait is interrupted, not restarted */
+        sigaction (SIGALRM, &sa, NULL);
+        tick.it_interval.tv_usec = tick.it_value.tv_usec = 1000 * ((watchMs < WATCHTICKMS) ? watchMs : WATCHTICKMS);
+        setitimer (ITIMER_REAL, &tick, NULL);
+    }
     m = 0;
     do {
-        info = wait (&status);
+        info = usePool ? waitWork () : sh->tournament ? waitRound (semgid, sh, m) : wait (&status);
+        if ((info == -1) && (errno == EINTR)) {
+            if (watchStalled (sh)) {
+                stalled = true;
+                break;
+            }
+            continue;
+        }
         if (info == -1) { 
             perror ("error on aiting for an intervening process");
             exit (EXIT_FAILURE);
         }
-        m += 1;
-    } while (m < 1 + NUMPLAYERS + NUMGOALIES);
+        if (info != pidLG) {
+            pidAll[m] = info;
+            m += 1;
+        }
+    } while (m < (unsigned int) (p_cfg->nReferees + p_cfg->nPlayers + p_cfg->nGoalies));
+    if (watchMs > 0) {
+        memset (&tick, 0, sizeof (tick));
+        setitimer (ITIMER_REAL, &tick, NULL);
+    }
+
+    /* a stalled match is reported and its processes are killed; the records they left are kept */
+    if (stalled) {
+        reportStall (sh, semgid, run);
+        if (logMode == LOG_RING) {
+            killStalled (&pidLG, 1);
+        }
+        if (usePool) {                                              /* a new pool is generated by the next match */
+            memcpy (pidAll, pidWK, (size_t) nEnt * sizeof (int));
+            stopPool (true);
+        }
+        else {
+            killStalled (pidPL, p_cfg->nPlayers);
+            killStalled (pidGL, p_cfg->nGoalies);
+            killStalled (pidRF, p_cfg->nReferees);
+            free (pidTN);                                     /* the next round of a tournament generates them again */
+            pidTN = NULL;
+            memcpy (pidAll, pidPL, (size_t) p_cfg->nPlayers * sizeof (int));
+            memcpy (pidAll + p_cfg->nPlayers, pidGL, (size_t) p_cfg->nGoalies * sizeof (int));
+            memcpy (pidAll + p_cfg->nPlayers + p_cfg->nGoalies, pidRF, (size_t) p_cfg->nReferees * sizeof (int));
+        }
+        m = (unsigned int) nEnt;
+    }
+
+    /* the entities of a tournament wait for the next round */
+    if (sh->tournament && !stalled) {
+        entitiesWait = true;
+    }
+
+    /* merging the private logs of the intervening entities */
+    if (logMode == LOG_BUFFERED) {
+        mergeLog (nFic, &sh->fSt, pidAll, m);
+    }
+
+    /* final drain of the shared log ring */
+    if ((logMode == LOG_RING) && !stalled) {
+        stopLog (&sh->logCtl, semgid);
+        if (waitpid (pidLG, &status, 0) == -1) {
+            perror ("error on waiting for the logger process");
+            exit (EXIT_FAILURE);
+        }
+    }
+
+    free (pidPL);
+    free (pidGL);
+    free (pidRF);
+    free (pidAll);
+
+    return !stalled;
+}
+
+#else
+
+/** \brief waiting for the termination of threads, unless the match stalls: then the simulation terminates */
+static void watch_threads(SHARED_DATA *sh, int semgid, int run, int nThr, pthread_t *tids)
+{
+    struct timespec until;                                                          /* end of the watchdog period */
+    int t;
+    for (t = 0; t < nThr; t++) {
+        while (true) {
+            clock_gettime (CLOCK_REALTIME, &until);
+            until.tv_nsec += WATCHTICKMS * 1000000L;
+            if (until.tv_nsec >= 1000000000L) {
+                until.tv_sec++;
+                until.tv_nsec -= 1000000000L;
+            }
+            if ((errno = pthread_timedjoin_np (tids[t], NULL, &until)) == 0) {
+                break;
+            }
+            if (errno != ETIMEDOUT) {
+                perror ("error on waiting for an intervening thread");
+                exit (EXIT_FAILURE);
+            }
+            if (watchStalled (sh)) {
+                reportStall (sh, semgid, run);
+                exit (EXIT_FAILURE);
+            }
+        }
+    }
+}
+
+/** \brief virtual time taken by the matches played so far (ns) */
+static uint64_t vTotal = 0;
+
+/**
+ *  \brief Running one match.
+ *
+ *  Generates the intervening entities threads (and the logger), waits for their termination and completes the
+ *  logging file. The shared region and the semaphore set must be initialized.
+ *
+ *  If the match makes no progress for <tt>watchMs</tt>, it is reported and the simulation terminates: the threads
+ *  of a stalled match cannot be taken back.
+ *
+ *  \param nFic name of the logging file
+ *  \param sh pointer to the shared region
+ *  \param semgid semaphore set access identifier
+ *  \param p_cfg population
+ *  \param first first match of the semaphore set: the start of operations is signaled
+ *  \param run run number (from 1)
+ *
+ *  \return \c true, as the match was completed
+ */
+static bool runMatch (char nFic[], SHARED_DATA *sh, int semgid, FULL_STAT *p_cfg, bool first, int run)
+{
+    pthread_t *tidPL,                                                              /* players thread identifier array */
+              *tidGL,                                                              /* goalies thread identifier array */
+              *tidRF,                                                              /* referees thread identifier array */
+              tidLG;                                                                      /* logger thread identifier */
+    LOGGER_ARG lg;                                                                   /* parameters of logger thread */
+    int pid = getpid ();                                                  /* owner of the private log, in buffered mode */
+    int logMode = sh->logCtl.mode;                                                                     /* logging mode */
+
+    /* allocating the identifier arrays of the intervening entities */
+    tidPL = malloc ((size_t) p_cfg->nPlayers * sizeof (pthread_t));
+    tidGL = malloc ((size_t) p_cfg->nGoalies * sizeof (pthread_t));
+    tidRF = malloc ((size_t) p_cfg->nReferees * sizeof (pthread_t));
+    if ((tidPL == NULL) || (tidGL == NULL) || (tidRF == NULL)) {
+        perror ("error on allocating the identifier arrays");
+        exit (EXIT_FAILURE);
+    }
+
+    /* signaling start of operations */
+    if (first && (semSignal (semgid) == -1)) {
+        perror ("error on signaling start of operations");
+        exit (EXIT_FAILURE);
+    }
+
+    /* generation of intervening entities threads */
+    playerBind (nFic, sh, semgid);
+    goalieBind (nFic, sh, semgid);
+    refereeBind (nFic, sh, semgid);
+
+    /* logger thread */
+    if (logMode == LOG_RING) {
+        lg.nFic = nFic;
+        lg.sh = sh;
+        lg.semgid = semgid;
+        pthread_attr_t attr, *p_attr = pinAttr (&attr, p_cfg->nPlayers + p_cfg->nGoalies + p_cfg->nReferees);
+        if ((errno = pthread_create (&tidLG, p_attr, loggerThread, &lg)) != 0) {
+            perror ("error on the creation of the logger thread");
+            exit (EXIT_FAILURE);
+        }
+        if (p_attr != NULL) {
+            pthread_attr_destroy (p_attr);
+        }
+    }
+
+    /* player, goalie and referee threads, that take turns in virtual time */
+    if (p_cfg->virtualTime) {
+        vclockStart (p_cfg->nPlayers + p_cfg->nGoalies + p_cfg->nReferees);
+    }
+    launch_threads(playerThread, 0, p_cfg->nPlayers, tidPL);
+    launch_threads(goalieThread, p_cfg->nPlayers, p_cfg->nGoalies, tidGL);
+    launch_threads(refereeThread, p_cfg->nPlayers + p_cfg->nGoalies, p_cfg->nReferees, tidRF);
+
+    /* waiting for the termination of the intervening entities threads, checking the progress periodically */
+    watchStart (sh);
+    watch_threads(sh, semgid, run, p_cfg->nPlayers, tidPL);
+    watch_threads(sh, semgid, run, p_cfg->nGoalies, tidGL);
+    watch_threads(sh, semgid, run, p_cfg->nReferees, tidRF);
+    if (p_cfg->virtualTime) {
+        vTotal += vclockStop ();
+    }
+
+    /* merging the private log of the process */
+    if (logMode == LOG_BUFFERED) {
+        logDetach ();
+        mergeLog (nFic, &sh->fSt, &pid, 1);
+    }
+
+    /* final drain of the shared log ring */
+    if (logMode == LOG_RING) {
+        stopLog (&sh->logCtl, semgid);
+        join_threads(1, &tidLG);
+    }
+
+    free (tidPL);
+    free (tidGL);
+    free (tidRF);
+
+    return true;
+}
+
+#endif
+
+/**
+ *  \brief Main program.
+ *
+ *  Its role is starting the simulation by generating the intervening entities processes (players, goalies and referee)
+ *  and waiting for their termination.
+ */
+int main (int argc, char *argv[])
+{
+    char nFic[51];                                                                              /*name of logging file */
+    int semgid;                                                                     /* semaphore set access identifier */
+    SHARED_DATA *sh;                                                                /* pointer to shared memory region */
+    int key;                                                           /*access key to shared memory and semaphore set */
+#ifndef SOCCER_THREADS
+    int shmid;                                                                      /* shared memory access identifier */
+    char keyStr[16];                                                            /* access key, as passed on */
+    unsigned int s;                                                                              /* counting variable */
+#endif
+    int logMode = LOG_DIRECT;                                                                          /* logging mode */
+    int logFormat = LOG_TEXT;                                                                /* logging file format */
+    bool logSplit = false;                                                           /* pitches are logged apart */
+    char pFic[64];                                                                    /* logging file of a pitch */
+    FILE *fpMet = NULL;                                                                            /* metrics file */
+    char tFic[TRACENAMESIZE] = "";                                                               /* trace file */
+    int opt;                                                                                       /* command option */
+    static struct option longOpts[] = { { "runs", required_argument, NULL, 'n' }, { "seed", required_argument, NULL, 'S' },
+                                        { "tournament", no_argument, NULL, 'o' }, { "affinity", required_argument, NULL, 'a' },
+                                        { "errors", no_argument, NULL, 'e' },
+                                        { NULL, 0, NULL, 0 } };
+    FULL_STAT cfg = { .nPlayers = NUMPLAYERS, .nGoalies = NUMGOALIES, .nReferees = NUMREFEREES,    /* population */
+                      .nTeams = NUMTEAMS, .teamPlayers = NUMTEAMPLAYERS, .teamGoalies = NUMTEAMGOALIES };
+    SHARED_DATA lay;                                                           /* layout of the variable size arrays */
+    size_t shSize, baseOff;                                            /* size of shared region, initial state offset */
+    int runs = 1, run;                                                          /* number of runs, current run */
+    bool tournament = false;                                        /* the runs are rounds played by the same entities */
+    bool collectErrors = false;                                  /* the diagnostics of the entities are collected */
+    int stalls = 0;                                                                    /* number of stalled runs */
+    unsigned int seed = (unsigned int) getpid ();                              /* seed of the first match (-S) */
+    struct timespec start, end;                                                          /* start and end of a run */
+    double elapsed, total = 0.0, minRun = 0.0, maxRun = 0.0;                                  /* run times (s) */
+    int r;
+
+    /* getting options */
+    while ((opt = getopt_long (argc, argv, "brMBsp:g:R:t:P:G:n:ozVS:w:kem:T:a:", longOpts, NULL)) != -1) {
+        switch (opt) {
+            case 'b':
+                logMode = LOG_BUFFERED;
+                break;
+            case 'r':
+                logMode = LOG_RING;
+                break;
+            case 'M':
+                logMode = LOG_MAPPED;
+                break;
+            case 'B':
+                logFormat = LOG_BINARY;
+                break;
+            case 's':
+                logSplit = true;
+                break;
+            case 'p':
+                cfg.nPlayers = numOption (argv[0], optarg, 1, MAXENTITIES);
+                break;
+            case 'g':
+                cfg.nGoalies = numOption (argv[0], optarg, 1, MAXENTITIES);
+                break;
+            case 'R':
+                cfg.nReferees = numOption (argv[0], optarg, 1, MAXENTITIES);
+                break;
+            case 't':
+                cfg.nTeams = numOption (argv[0], optarg, 1, MAXENTITIES);
+                break;
+            case 'P':
+                cfg.teamPlayers = numOption (argv[0], optarg, 1, MAXENTITIES);
+                break;
+            case 'G':
+                cfg.teamGoalies = numOption (argv[0], optarg, 1, MAXENTITIES);
+                break;
+            case 'n':
+                runs = numOption (argv[0], optarg, 1, INT_MAX);
+                break;
+            case 'o':
+                tournament = true;
+                break;
+            case 'z':
+                cfg.noDelay = true;
+                break;
+            case 'V':
+                cfg.virtualTime = true;
+                break;
+            case 'S':
+                seed = seedOption (argv[0], optarg);
+                break;
+            case 'w':
+                watchMs = (unsigned int) numOption (argv[0], optarg, 0, INT_MAX);
+                break;
+            case 'k':
+                usePool = true;
+                break;
+            case 'e':
+                collectErrors = true;
+                break;
+            case 'm':
+                if ((fpMet = fopen (optarg, "w")) == NULL) {
+                    perror ("error on opening the metrics file");
+                    exit (EXIT_FAILURE);
+                }
+                fprintf (fpMet, "run,pitch,match_us,teams_us,start_us,end_us,semops\n");
+                break;
+            case 'T':
+                if (strlen (optarg) >= sizeof (tFic) - 1) {
+                    usage (argv[0]);
+                }
+                strcpy (tFic, optarg);
+                break;
+            case 'a':
+                if (affinityInit (optarg) == -1) {
+                    if (errno == EINVAL) {
+                        fprintf (stderr, "Wrong placement (\"%s\"): compact, spread or a list of the processors the "
+                                 "generator may run on\n", optarg);
+                        exit (EXIT_FAILURE);
+                    }
+                    perror ("error on querying the processors");
+                    exit (EXIT_FAILURE);
+                }
+                break;
+            default:
+                usage (argv[0]);
+        }
+    }
+
+    /* validation of the population: every team must be formed */
+    if ((cfg.nPlayers < cfg.nReferees * cfg.nTeams * cfg.teamPlayers) ||
+        (cfg.nGoalies < cfg.nReferees * cfg.nTeams * cfg.teamGoalies)) {
+        fprintf (stderr, "%d players and %d goalies are not enough for %d teams of %d players and %d goalies\n",
+                 cfg.nPlayers, cfg.nGoalies, cfg.nReferees * cfg.nTeams, cfg.teamPlayers, cfg.teamGoalies);
+        exit (EXIT_FAILURE);
+    }
+    if (cfg.nPlayers + cfg.nGoalies > MAXENTITIES) {
+        fprintf (stderr, "At most %d players and goalies are supported\n", MAXENTITIES);
+        exit (EXIT_FAILURE);
+    }
+    if (cfg.virtualTime && (logMode == LOG_RING)) {                    /* the logger thread is not scheduled */
+        fprintf (stderr, "Virtual time is not supported with the logging ring\n");
+        exit (EXIT_FAILURE);
+    }
+#ifndef SOCCER_THREADS
+    if (cfg.virtualTime) {
+        fprintf (stderr, "Virtual time is only supported by the thread-based engine\n");
+        exit (EXIT_FAILURE);
+    }
+    if (usePool && tournament) {
+        fprintf (stderr, "The entities of a tournament are not run by the worker pool\n");
+        exit (EXIT_FAILURE);
+    }
+#else
+    if (usePool) {
+        fprintf (stderr, "The worker pool is only supported by the process-based engine\n");
+        exit (EXIT_FAILURE);
+    }
+    if (tournament) {
+        fprintf (stderr, "Tournaments are only supported by the process-based engine\n");
+        exit (EXIT_FAILURE);
+    }
+    if (collectErrors) {                                 /* the threads report on the stderr of the process */
+        fprintf (stderr, "Collected diagnostics are only supported by the process-based engine\n");
+        exit (EXIT_FAILURE);
+    }
+#endif
+    if (logSplit && (logMode != LOG_DIRECT)) {
+        fprintf (stderr, "Split logging files are only supported in direct logging\n");
+        exit (EXIT_FAILURE);
+    }
+
+    /* getting log file name */
+    if(optind < argc) {
+        strcpy(nFic, argv[optind]);
+    }
+    else strcpy(nFic, "");
+    if ((logMode == LOG_MAPPED) && (nFic[0] == '\0')) {                             /* stdout can not be mapped */
+        fprintf (stderr, "Mapped logging needs a logging file\n");
+        exit (EXIT_FAILURE);
+    }
+
+    /* reporting the placement, so that the timing can be told apart */
+    if (affinityOn ()) {
+        char desc[256];
+        affinityDescribe (desc, sizeof (desc));
+        fprintf (stderr, "%s\n", desc);
+    }
+
+#ifndef SOCCER_THREADS
+    /* collecting the diagnostics of the entities, before any other process or pipe is created */
+    if (collectErrors && (errorCollect (ERRORFILE) == -1)) {
+        perror ("error on starting the collection of the diagnostics");
+        exit (EXIT_FAILURE);
+    }
+#endif
+
+    /* creating the shared memory region and the semaphore set */
+    shSize = layoutSharedData (&cfg, &lay, &baseOff);
+#ifndef SOCCER_THREADS
+    ipcOwner = getpid ();                                  /* both are destroyed if the generator terminates early */
+    if (atexit (ipcCleanup) != 0) {
+        perror ("error on registering the cleanup of the IPC resources");
+        exit (EXIT_FAILURE);
+    }
+    for (s = 0; s < sizeof (fatalSig) / sizeof (fatalSig[0]); s++) {
+        signal (fatalSig[s], ipcFatal);
+    }
+    key = KEYBASE + (getpid () & KEYMASK);                             /* private key, unless it is already in use */
+    while (true) {
+        if ((shmid = shmemCreate (key, shSize)) != -1) {
+            if ((semgid = semCreate (key, SEM_NU (cfg.nReferees))) != -1) {
+                break;
+            }
+            shmemDestroy (shmid);
+        }
+        if (errno != EEXIST) {
+            perror ("error on creating the shared memory region and the semaphore set");
+            exit (EXIT_FAILURE);
+        }
+        key = KEYBASE + ((key + 1) & KEYMASK);
+    }
+    ipcShmid = shmid;
+    ipcSemgid = semgid;
+    sprintf (keyStr, "%#x", key);                                         /* the entities inherit the environment */
+    if (setenv (KEYENV, keyStr, 1) == -1) {
+        perror ("error on passing the key to the entities");
+        exit (EXIT_FAILURE);
+    }
+    if (shmemAttach (shmid, (void **) &sh) == -1) { 
+        perror ("error on mapping the shared region on the process address space");
+        exit (EXIT_FAILURE);
+    }
+    if (affinityOn () && (affinityBind (sh, shSize) == -1)) {              /* before the region is first written */
+        perror ("error on placing the shared region on the memory node");
+        exit (EXIT_FAILURE);
+    }
+    sh->owner = getpid ();                                        /* the entities do not outlive the generator */
+#else
+    key = getpid ();                                        /* the set is only known inside this process */
+    shSize = alignUp (shSize, _Alignof (SHARED_DATA));
+    if ((sh = aligned_alloc (_Alignof (SHARED_DATA), shSize)) == NULL) {   /* only this process' threads use it */
+        perror ("error on creating the shared region");
+        exit (EXIT_FAILURE);
+    }
+    if (affinityOn () && (affinityBind (sh, shSize) == -1)) {
+        perror ("error on placing the shared region on the memory node");
+        exit (EXIT_FAILURE);
+    }
+    memset (sh, 0, shSize);
+    if ((semgid = semCreate (key, SEM_NU (cfg.nReferees))) == -1) { 
+        perror ("error on creating the semaphore set");
+        exit (EXIT_FAILURE);
+    }
+#endif
+
+    sh->tournament           = tournament;
+    atomic_store (&sh->over, false);
+    sh->mon.runs             = (unsigned int) runs;                        /* the monitoring page, for soccertop */
+#ifdef SEM_STATS
+    sh->mon.semStats         = true;
+#endif
+    sh->logCtl.mode          = logMode;
+    sh->logCtl.format        = logFormat;
+    sh->logCtl.split         = logSplit;
+    strcpy (sh->logCtl.trace, tFic);
+    if (tFic[0] != '\0') {                                             /* the entities append their events */
+        traceCreate (tFic);
+    }
+
+    /* the semaphore statistics add up the whole batch, the generator operations included */
+    sh->semStatOff           = lay.semStatOff;
+    memset (SEMSTATS (sh), 0, (size_t) (SEM_NU (cfg.nReferees) + 1) * sizeof (SEM_USAGE));
+    semStatAttach (SEMSTATS (sh), SEM_NU (cfg.nReferees) + 1);
+
+    for (run = 1; run <= runs; run++) {
+        clock_gettime (CLOCK_MONOTONIC, &start);
+
+        /* initialize problem internal status, with the delays of the match */
+        cfg.seed = seed + (unsigned int) (run - 1) * (unsigned int) (cfg.nPlayers + cfg.nGoalies + cfg.nReferees);
+        initSharedData (sh, &cfg, &lay);
+        sh->round = (unsigned int) run;
+
+        /* create log file (on the first run) and separate the runs of a batch */
+        if (run == 1) {
+            createLog (nFic, &sh->fSt, &sh->logCtl);
+        }
+        if (runs > 1) {
+            separateLog (nFic, &sh->fSt, run);
+        }
+        logDelays (nFic, &sh->fSt, DELAYS (sh));
+        saveState(nFic,&sh->fSt);
+        if (logSplit) {                                                 /* and the log files of the pitches */
+            for (r = 0; r < cfg.nReferees; r++) {
+                pitchLogName (pFic, nFic, &sh->logCtl, r);
+                if (run == 1) {
+                    createLog (pFic, &sh->fSt, &sh->logCtl);
+                }
+                if (runs > 1) {
+                    separateLog (pFic, &sh->fSt, run);
+                }
+                logDelays (pFic, &sh->fSt, DELAYS (sh));
+                saveState (pFic, &sh->fSt);
+            }
+        }
+        if (logMode == LOG_MAPPED) {                              /* the records of the match follow in the window */
+            mapLog (nFic, &sh->fSt, &sh->logCtl);
+        }
+        sh->logCtl.baseOff       = baseOff - offsetof (SHARED_DATA, logCtl);
+        memcpy ((char *) sh + baseOff, &sh->fSt.st,                      /* the logger resumes from this state */
+                STATSIZE (cfg.nPlayers, cfg.nGoalies, cfg.nReferees));
+
+        /* initializing the semaphore set, that may still hold values of the previous run; after a round of a
+           tournament that was completed it is back to its initial values, with the entities blocked on it */
+        semOpCount = 0;                                              /* the generator operations count for the run */
+        if (!entitiesWait) {
+            if ((run > 1) && (semReset (semgid) == -1)) {
+                perror ("error on resetting the semaphore set");
+                exit (EXIT_FAILURE);
+            }
+            if (semUp (semgid, sh->mutex) == -1) {                         /* enabling access to critical region */
+                perror ("error on executing the up operation for semaphore access");
+                exit (EXIT_FAILURE);
+            }
+            if (semUp (semgid, sh->logCtl.lock) == -1) {                          /* enabling access to the log */
+                perror ("error on executing the up operation for semaphore access");
+                exit (EXIT_FAILURE);
+            }
+            for (r = 0; r < cfg.nReferees; r++) {                  /* enabling access to the pitches critical regions */
+                if (semUp (semgid, PITCHES (sh)[r].mutex) == -1) {
+                    perror ("error on executing the up operation for semaphore access");
+                    exit (EXIT_FAILURE);
+                }
+            }
+        }
+
+        if (!runMatch (nFic, sh, semgid, &cfg, run == 1, run)) {
+            stalls++;
+            atomic_fetch_add (&sh->mon.stalls, 1);
+        }
+        else {
+            saveMonitor (sh);
+            if (fpMet != NULL) {
+                saveMetrics (fpMet, sh, run);
+            }
+        }
+        atomic_fetch_add (&sh->mon.runsDone, 1);
+        if (logMode == LOG_MAPPED) {                                     /* every entity of the match is done */
+            trimLog (nFic, &sh->fSt, &sh->logCtl);
+        }
+
+        clock_gettime (CLOCK_MONOTONIC, &end);
+        elapsed = (double) (end.tv_sec - start.tv_sec) + (double) (end.tv_nsec - start.tv_nsec) / 1e9;
+        total += elapsed;
+        if ((run == 1) || (elapsed < minRun)) {
+            minRun = elapsed;
+        }
+        if ((run == 1) || (elapsed > maxRun)) {
+            maxRun = elapsed;
+        }
+    }
+
+#ifndef SOCCER_THREADS
+    if (pidWK != NULL) {                                                 /* the workers run out of commands */
+        stopPool (false);
+    }
+    if (entitiesWait) {                                                             /* the tournament is over */
+        stopTournament (semgid, sh, cfg.nPlayers + cfg.nGoalies + cfg.nReferees);
+    }
+#endif
+
+    /* aggregate timing of a batch */
+    if (runs > 1) {
+        fprintf (stderr, "%d runs in %.3f s: %.3f ms per run (min %.3f ms, max %.3f ms)\n",
+                 runs, total, 1e3 * total / runs, 1e3 * minRun, 1e3 * maxRun);
+    }
+    if (stalls > 0) {
+        fprintf (stderr, "%d of %d runs stalled\n", stalls, runs);
+    }
+#ifdef SOCCER_THREADS
+    if (cfg.virtualTime) {
+        fprintf (stderr, "virtual time: %.3f ms per run\n", (double) vTotal / 1e6 / runs);
+    }
+#endif
+#ifdef SEM_STATS
+    saveSemStats (stderr, sh);                                       /* every intervening entity has terminated */
+#endif
+    if (tFic[0] != '\0') {
+        traceExport (tFic, semName);
+    }
+    if ((fpMet != NULL) && (fclose (fpMet) == EOF)) {
+        perror ("error on closing the metrics file");
+        exit (EXIT_FAILURE);
+    }
+
 
     /* destruction of semaphore set and shared region */
     if (semDestroy (semgid) == -1) {
         perror ("error on destructing the semaphore set");
         exit (EXIT_FAILURE);
     }
+#ifndef SOCCER_THREADS
+    ipcSemgid = -1;
     if (shmemDettach (sh) == -1) { 
         perror ("error on unmapping the shared region off the process address space");
         exit (EXIT_FAILURE);
@@ -191,6 +1636,11 @@ int main (int argc, char *argv[])
         perror ("error on destructing the shared region");
         exit (EXIT_FAILURE);
     }
+    ipcShmid = -1;
+    errorCollectEnd ();                                          /* every entity has closed its end of the pipe */
+#else
+    free (sh);
+#endif
 
-    return EXIT_SUCCESS;
+    return (stalls > 0) ? EXIT_FAILURE : EXIT_SUCCESS;
 }
@@ -22,6 +22,7 @@
 #include <sys/types.h>
 #include <sys/ipc.h>
 #include <string.h>
+#include <stdint.h>
 #include <math.h>
 #include <assert.h>
 
@@ -30,13 +31,22 @@
 #include "logging.h"
 #include "sharedDataSync.h"
 #include "semaphore.h"
+#include "semStat.h"
+#include "trace.h"
+#include "vclock.h"
 #include "sharedMemory.h"
+#include "errorChannel.h"
+#include "barrier.h"
+#include "waitWord.h"
+#include "soccerThreads.h"
 
 /** \brief logging file name */
 static char nFic[51];
 
+#if !defined (SOCCER_THREADS) && !defined (SOCCER_WORKER)
 /** \brief shared memory block access identifier */
 static int shmid;
+#endif
 
 /** \brief semaphore set access identifier */
 static int semgid;
@@ -56,6 +66,46 @@ static void waitReferee(int id, int team);
 /** \brief goalie waits for referee to end match */
 static void playUntilEnd(int id, int team);
 
+#if !defined (SOCCER_THREADS) && !defined (SOCCER_WORKER)
+
+/**
+ *  \brief goalie waits for the next round of a tournament
+ *
+ *  Outside a tournament the goalie terminates after its match. In a tournament it detaches from the log, so that
+ *  its records of the round can be merged, tells the generator that its round is over and waits for the next one,
+ *  for which the generator resets the shared region; a late goalie thus takes part in the next match.
+ *
+ *  \param id goalie id
+ *
+ *  \return \c true, if there is a next round
+ */
+static bool nextRound (int id)
+{
+    unsigned int next;                                                                          /* next round */
+
+    if (!sh->tournament) {
+        return false;
+    }
+    next = sh->round + 1;                                  /* the generator only changes it once the round is over */
+    traceDetach ();
+    logDetach ();
+
+    if (semUp (semgid, sh->roundEnd) == -1) {                                                 /* the round is over */
+        perror ("error on the up operation for semaphore access of roundEnd (GL)");
+        exit (EXIT_FAILURE);
+    }
+    if (semDown (semgid, sh->roundStart[next % 2]) == -1) {                            /* wait for the next round */
+        perror ("error on the down operation for semaphore access of roundStart (GL)");
+        exit (EXIT_FAILURE);
+    }
+    if (atomic_load (&sh->over)) {
+        return false;
+    }
+
+    logAttach (nFic, &sh->logCtl, semgid, LOG_GOALIE, id);
+    return true;
+}
+
 /**
  *  \brief Main program.
  *
@@ -64,6 +114,7 @@ static void playUntilEnd(int id, int team);
 int main (int argc, char *argv[])
 {
     int key;            /*access key to shared memory and semaphore set */
+    char *keyStr;       /* access key, as passed by the generator */
     char *tinp;         /* numerical parameters test flag */
     int n, team;
 
@@ -76,7 +127,7 @@ int main (int argc, char *argv[])
     
     /* get goalie id - argv[1]*/
     n = (unsigned int) strtol (argv[1], &tinp, 0);
-    if ((*tinp != '\0') || (n >= NUMGOALIES )) { 
+    if (*tinp != '\0') { 
         fprintf (stderr, "Goalie process identification is wrong!\n");
         return EXIT_FAILURE;
     }
@@ -84,14 +135,18 @@ int main (int argc, char *argv[])
     /* get logfile name - argv[2]*/
     strcpy (nFic, argv[2]);
 
-    /* redirect stderr to error file  - argv[3]*/
-    freopen (argv[3], "w", stderr);
-    setbuf(stderr,NULL);
+    /* redirect stderr to error file, or to the channel of the generator - argv[3]*/
+    errorRedirect (argv[3]);
 
-    /* getting key value */
-    if ((key = ftok (".", 'a')) == -1) {
-        perror ("error on generating the key");
-        exit (EXIT_FAILURE);
+    /* getting key value - picked by the generator */
+    if ((keyStr = getenv (KEYENV)) == NULL) {
+        fprintf (stderr, "Key of the simulation is missing!\n");
+        return EXIT_FAILURE;
+    }
+    key = (int) strtol (keyStr, &tinp, 0);
+    if (*tinp != '\0') { 
+        fprintf (stderr, "Key of the simulation is wrong!\n");
+        return EXIT_FAILURE;
     }
 
     /* connection to the semaphore set and the shared memory region and mapping the shared region onto the
@@ -109,16 +164,37 @@ int main (int argc, char *argv[])
         return EXIT_FAILURE;
     }
 
-    /* initialize random generator */
-    srandom ((unsigned int) getpid ());              
+    /* the goalie does not outlive the generator */
+    if (!ownerAlive (sh)) {
+        fprintf (stderr, "The generator has terminated!\n");
+        return EXIT_FAILURE;
+    }
 
-    /* simulation of the life cycle of the goalie */
-    arrive(n);
-    if((team = goalieConstituteTeam(n))!=0) {
-        waitReferee(n, team);
-        playUntilEnd(n, team);
+    /* validation of goalie id against the population of the shared region */
+    if ((n < 0) || (n >= sh->fSt.nGoalies)) { 
+        fprintf (stderr, "Goalie process identification is wrong!\n");
+        return EXIT_FAILURE;
     }
 
+    /* recording the semaphore operations in the statistics block (instrumented build) */
+    semStatAttach (SEMSTATS (sh), SEM_NU (sh->fSt.nReferees) + 1);
+
+    /* attaching to the log */
+    logAttach (nFic, &sh->logCtl, semgid, LOG_GOALIE, n);
+
+    /* simulation of the life cycle of the goalie, once for every round of a tournament */
+    do {
+        arrive(n);
+        if((team = goalieConstituteTeam(n))!=0) {
+            waitReferee(n, team);
+            playUntilEnd(n, team);
+        }
+
+        /* reporting the synchronization cost */
+        atomic_fetch_add (&sh->semOps, semOpCount);
+        semOpCount = 0;
+    } while (nextRound (n));
+
     /* unmapping the shared region off the process address space */
     if (shmemDettach (sh) == -1) {
         perror ("error on unmapping the shared region off the process address space");
@@ -128,6 +204,56 @@ int main (int argc, char *argv[])
     return EXIT_SUCCESS;
 }
 
+#else
+
+/**
+ *  \brief Binding of the goalies to the logging file, the shared region and the semaphore set.
+ *
+ *  Must be called by the generator before any goalie thread is created (or by a worker of the pool, once, before
+ *  it runs any life cycle).
+ *
+ *  \param logName name of the logging file
+ *  \param p_sh pointer to the shared region
+ *  \param p_semgid semaphore set identifier
+ */
+void goalieBind (char logName[], SHARED_DATA *p_sh, int p_semgid)
+{
+    strcpy (nFic, logName);
+    sh = p_sh;
+    semgid = p_semgid;
+}
+
+/**
+ *  \brief Thread entry point.
+ *
+ *  Its role is to run the life cycle of one of intervening entities in the problem, the goalie, inside the
+ *  generator process (or inside a worker of the pool, see semSharedMemWorker.c).
+ */
+void *goalieThread (void *arg)
+{
+    int n = (int) (intptr_t) arg, team;
+
+    /* attaching to the log */
+    logAttach (nFic, &sh->logCtl, semgid, LOG_GOALIE, n);
+    vclockEnter ();                                               /* waits for its turn, in virtual time */
+
+    /* simulation of the life cycle of the goalie */
+    arrive(n);
+    if((team = goalieConstituteTeam(n))!=0) {
+        waitReferee(n, team);
+        playUntilEnd(n, team);
+    }
+
+    /* reporting the synchronization cost */
+    atomic_fetch_add (&sh->semOps, semOpCount);
+    traceDetach ();                                               /* a thread is not detached on exit */
+    vclockLeave ();
+
+    return NULL;
+}
+
+#endif
+
 /**
  *  \brief goalie takes some time to arrive
  *
@@ -137,12 +263,14 @@ int main (int argc, char *argv[])
  */
 static void arrive(int id)
 {    
+    benchFirst (&sh->tArrive);                                                  /* the first arrival starts the match */
+
     if (semDown (semgid, sh->mutex) == -1)  {                                                     	/* enter critical region */
         perror ("error on the down operation for semaphore access (GL)");
         exit (EXIT_FAILURE);
     }
 																									
-	sh->fSt.st.goalieStat[id] = ARRIVING;															// Change State
+	SETSTATE (&sh->fSt, GOALIESTAT(&sh->fSt.st, id), ARRIVING);															// Change State
 	saveState(nFic, &sh->fSt);
 	    
     if (semUp (semgid, sh->mutex) == -1) {                                                         	/* exit critical region */
@@ -150,66 +278,64 @@ static void arrive(int id)
         exit (EXIT_FAILURE);
     }
 
-    usleep((200.0*random())/(RAND_MAX+1.0)+60.0);
+    if (!sh->fSt.noDelay) {
+        vclockSleep(GOALIEDELAY(sh, id));
+    }
 }
 
 /**
  *  \brief goalie constitutes team
  *
- *  If goalie is late, it updates state and leaves.
- *  If there are enough free players to form a team, goalie forms team allowing team members to 
- *  proceed and waiting for them to acknowledge registration.
- *  Otherwise it updates state, waits for the forming teammate to "call" him, saves its team
- *  and acknowledges registration.
+ *  If goalie is late, it updates state and leaves; lateness is decided without entering the critical region.
+ *  If there are enough free players to form a team, goalie forms team: it reserves the team id, takes the team
+ *  members off the front of the queues of the waiting players and goalies, and hands the team id to each one, on
+ *  its wait word, once it has left the critical region.
+ *  Otherwise it updates state, joins the queue of the waiting goalies and waits on its own wait word for the
+ *  forming teammate to hand it the team id.
+ *  Every team member registers on its team barrier, outside the critical region; the last one to register
+ *  notifies the referee that the team is formed.
  *  The internal state should be saved.
  *
  *  \param id goalie id
  * 
- *  \return id of goalie team (0 for late goalies; 1 for team 1; 2 for team 2)
+ *  \return id of goalie team (0 for late goalies; 1 .. nReferees * nTeams for the team)
  *
  */
 static int goalieConstituteTeam (int id)
 {
     int ret = 0;
+    int player_type = 2;																			// Flag to determine out of critical region actions; 0-LATE, 1-Forming, 2- Waiting
+    int playersFrom = 0, goaliesFrom = 0;															// Queue positions of the team members taken by a forming goalie
+
+    if(atomic_fetch_add(&sh->fSt.goaliesArrived, 1) >= sh->fSt.nReferees*sh->fSt.nTeams*sh->fSt.teamGoalies) {	// Goalie is late: no need for the critical region to know it
+    	player_type = 0;
+    }
 
     if (semDown (semgid, sh->mutex) == -1)  {       												/* enter critical region */
         perror ("error on the up operation for semaphore access (GL)");
         exit (EXIT_FAILURE);
     }
-
-    int player_type = 0;																			// Flag to determine out of critical region actions;
-    if(++sh->fSt.goaliesArrived >2){ 																// Goalie is late so it only changes
-    	sh->fSt.st.goalieStat[id]= LATE;
+    if(player_type == 0){ 																			// Goalie is late so it only changes
+    	SETSTATE (&sh->fSt, GOALIESTAT(&sh->fSt.st, id), LATE);
     	saveState(nFic, &sh->fSt);
     }
-    else if(sh->fSt.playersFree >=4){																// Goalie forms team
-    	sh->fSt.playersFree -= 4;
-    	sh->fSt.st.goalieStat[id] = FORMING_TEAM;													// Change State
+    else if(sh->fSt.playerQueueIn - sh->fSt.playerQueueOut >= sh->fSt.teamPlayers &&
+            sh->fSt.goalieQueueIn - sh->fSt.goalieQueueOut >= sh->fSt.teamGoalies-1){				// Goalie forms team
+    	playersFrom = sh->fSt.playerQueueOut;														// Take the first players and goalies
+    	goaliesFrom = sh->fSt.goalieQueueOut;														// that joined the queues
+    	sh->fSt.playerQueueOut += sh->fSt.teamPlayers;
+    	sh->fSt.goalieQueueOut += sh->fSt.teamGoalies-1;
+    	SETSTATE (&sh->fSt, GOALIESTAT(&sh->fSt.st, id), FORMING_TEAM);													// Change State
     	saveState(nFic, &sh->fSt);
-    	int count = 0;
-    	do {
-	    	if(semUp(semgid,sh->playersWaitTeam) == -1){											// Notify waiting player
-	    		perror ("error on the up operation for semaphore access of playersWaitTeam (GL)");
-				exit (EXIT_FAILURE);
-	    	}
-			if(semDown(semgid,sh->playerRegistered) == -1){											// Wait to be notified that he registered
-    			perror ("error on the down operation for semaphore access of playerRegistered (GL)");
-				exit (EXIT_FAILURE);
-			}
-			count++;
-		} while(count != NUMTEAMPLAYERS);															// For every player in the team
-
-		ret = sh->fSt.teamId++;																		// Return value assigned to team id and increment i
-		player_type=1;																				// Return value assigned to team id and increment it
-        
+		ret = sh->fSt.teamId++;																		// Return value assigned to team id and increment it
+	    barrierArm(TEAM(sh,ret), sh->fSt.teamPlayers+sh->fSt.teamGoalies);							// Every team member registers
+		player_type=1;
     }																								
 	else{																							// Goalie arrived on time but not enough teammates
-		sh->fSt.goaliesFree++;
-    	sh->fSt.st.goalieStat[id] = WAITING_TEAMS;
+		GOALIEQUEUE(sh)[sh->fSt.goalieQueueIn++] = id;
+    	SETSTATE (&sh->fSt, GOALIESTAT(&sh->fSt.st, id), WAITING_TEAMS);
     	saveState(nFic, &sh->fSt);
-    	player_type = 2;																			// We still dont know the return value here since the team isnt formed yet
     }
-    
     if (semUp (semgid, sh->mutex) == -1) {                                                          /* exit critical region */
         perror ("error on the down operation for semaphore access (GL)");
         exit (EXIT_FAILURE);
@@ -217,32 +343,39 @@ static int goalieConstituteTeam (int id)
 
     switch(player_type){
     	case 0:
-    		break;
+    		return ret;
     		
     	case 1:
-    		if (semUp (semgid, sh->refereeWaitTeams) == -1) {									    // Notify referee that a team was formed
-    			perror ("error on the up operation for semaphore access of refereeWaitTeams (GL)");
-    			exit (EXIT_FAILURE);
-    		}
+	    	for(int k = 0; k < sh->fSt.teamPlayers; k++) {												// Hand the team id to every player in the team
+	    		if(wordPost(PLAYERWORD(sh, PLAYERQUEUE(sh)[playersFrom+k]), ret) == -1){
+	    			perror ("error on handing the team id to a player (GL)");
+	    			exit (EXIT_FAILURE);
+	    		}
+	    	}
+	    	for(int k = 0; k < sh->fSt.teamGoalies-1; k++) {											// and to the other goalies
+	    		if(wordPost(GOALIEWORD(sh, GOALIEQUEUE(sh)[goaliesFrom+k]), ret) == -1){
+	    			perror ("error on handing the team id to a goalie (GL)");
+	    			exit (EXIT_FAILURE);
+	    		}
+	    	}
     		break;
     		
     	case 2:
-    		if(semDown(semgid,sh->goaliesWaitTeam) == -1){											// Wait for a player to form a team
-    		    perror ("error on the down operation for semaphore access of goaliesWaitTeam (GL)");
+    		if(wordWait(GOALIEWORD(sh, id), &ret) == -1){												// Wait for a player to form a team
+    		    perror ("error on waiting for the team id (GL)");												// and take the team id it handed
     		 	exit (EXIT_FAILURE);
 			}
-    		   	
-    		ret = sh->fSt.teamId;																	// Get team ID of forming team
-    		if(semUp(semgid,sh->playerRegistered) == -1){											// Register as a player of that team
-    			perror ("error on the up operation for semaphore access of playerRegistered (GL)");
-    		   	exit (EXIT_FAILURE);
-    		}
     		break;
     		
     	default:
     		perror("Invalid player type was assigned");
     		break;
     }
+
+	if(barrierArrive(semgid,TEAM(sh,ret)) == -1){												// Register as a member of that team
+		perror ("error on the up operation for semaphore access of teamsFormed (GL)");
+		exit (EXIT_FAILURE);
+	}
     
     return ret;
 }
@@ -258,20 +391,25 @@ static int goalieConstituteTeam (int id)
  */
 static void waitReferee (int id, int team)
 {
-    if (semDown (semgid, sh->mutex) == -1)  {                                                     	/* enter critical region */
+    PITCH *pt = &PITCHES(sh)[TEAMPITCH(sh, team)];                                         /* pitch of the match */
+    char pFic[64];                                                                    /* logging file of the pitch */
+
+    pitchLogName (pFic, nFic, &sh->logCtl, TEAMPITCH(sh, team));
+
+    if (semDown (semgid, pt->mutex) == -1)  {                                                     	/* enter pitch critical region */
         perror ("error on the up operation for semaphore access (GL)");
         exit (EXIT_FAILURE);
     }
 
-	sh->fSt.st.goalieStat[id] = (team == 1) ? WAITING_START_1 : WAITING_START_2;					// Determine right state and save it
-	saveState(nFic, &sh->fSt);
+	SETSTATE (&sh->fSt, GOALIESTAT(&sh->fSt.st, id), TEAMONE(sh, team) ? WAITING_START_1 : WAITING_START_2);					// Determine right state and save it
+	saveState(pFic, &sh->fSt);
 	
-    if (semUp (semgid, sh->mutex) == -1) {                                                         	/* exit critical region */
+    if (semUp (semgid, pt->mutex) == -1) {                                                         	/* exit pitch critical region */
         perror ("error on the down operation for semaphore access (GL)");
         exit (EXIT_FAILURE);
     }
 
-	if (semDown (semgid, sh->playersWaitReferee) == -1)  {                          				//Wait for referee to be ready
+	if (barrierWait (semgid, &pt->start) == -1)  {                                  				//Wait for referee to be ready
         perror ("error on the up operation for semaphore access of playersWaitReferee (GL)");
         exit (EXIT_FAILURE);
     }
@@ -289,26 +427,33 @@ static void waitReferee (int id, int team)
  */
 static void playUntilEnd (int id, int team)
 {
-    if (semDown (semgid, sh->mutex) == -1)  {                                                     	/* enter critical region */
+    PITCH *pt = &PITCHES(sh)[TEAMPITCH(sh, team)];                                         /* pitch of the match */
+    char pFic[64];                                                                    /* logging file of the pitch */
+
+    pitchLogName (pFic, nFic, &sh->logCtl, TEAMPITCH(sh, team));
+
+    if (semDown (semgid, pt->mutex) == -1)  {                                                     	/* enter pitch critical region */
         perror ("error on the up operation for semaphore access (GL)");
         exit (EXIT_FAILURE);
     }
 
-    sh->fSt.st.goalieStat[id] = (team == 1) ? PLAYING_1 : PLAYING_2;
-    saveState(nFic, &sh->fSt);
-    if (semUp (semgid, sh->playing) == -1) {                                                        // Notify that player is playing
-        perror ("error on the down operation for semaphore access (GL)");
-    	exit (EXIT_FAILURE);
-	}
+    SETSTATE (&sh->fSt, GOALIESTAT(&sh->fSt.st, id), TEAMONE(sh, team) ? PLAYING_1 : PLAYING_2);
+    saveState(pFic, &sh->fSt);
 
-    if (semUp (semgid, sh->mutex) == -1) {                                                         	/* exit critical region */
+    if (semUp (semgid, pt->mutex) == -1) {                                                         	/* exit pitch critical region */
         perror ("error on the down operation for semaphore access (GL)");
         exit (EXIT_FAILURE);
     }
 
-    if (semDown (semgid, sh->playersWaitEnd) == -1) {                                               // Wait for match to end
+    if (barrierArrive (semgid, &pt->start) == -1) {                                                 // Notify that player is playing
+        perror ("error on the up operation for semaphore access of playing (GL)");
+    	exit (EXIT_FAILURE);
+	}
+
+    if (barrierWait (semgid, &pt->end) == -1) {                                                     // Wait for match to end
 		perror ("error on the down operation for semaphore access (GL)");
         exit (EXIT_FAILURE);
 	}
+    benchLast (&pt->tLeft);                                                          /* the last one ends the match */
 }
 
@@ -0,0 +1,118 @@
+/**
+ *  \file semSharedMemLogger.c (implementation file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  Synchronization based on semaphores and shared memory.
+ *  Implementation with SVIPC.
+ *
+ *  Definition of the operations carried out by the logger:
+ *     \li drainLog
+ *
+ *  The logger only exists in <tt>LOG_RING</tt> mode. It formats the state change records that the intervening
+ *  entities append to the shared log ring, so that no text formatting or file access takes place inside the
+ *  critical region.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/ipc.h>
+#include <string.h>
+
+#include "probConst.h"
+#include "probDataStruct.h"
+#include "logging.h"
+#include "sharedDataSync.h"
+#include "semaphore.h"
+#include "semStat.h"
+#include "sharedMemory.h"
+#include "errorChannel.h"
+
+/** \brief logging file name */
+static char nFic[51];
+
+/** \brief shared memory block access identifier */
+static int shmid;
+
+/** \brief semaphore set access identifier */
+static int semgid;
+
+/** \brief pointer to shared memory region */
+static SHARED_DATA *sh;
+
+/**
+ *  \brief Main program.
+ *
+ *  Its role is to drain the shared log ring into the logging file until the generator stops it.
+ */
+int main (int argc, char *argv[])
+{
+    int key;                                          /*access key to shared memory and semaphore set */
+    char *keyStr;                                                 /* access key, as passed by the generator */
+    char *tinp;                                                             /* numerical parameters test flag */
+
+    /* validation of command line parameters */
+    if (argc != 4) {
+        freopen ("error_LG", "a", stderr);
+        fprintf (stderr, "Number of parameters is incorrect!\n");
+        return EXIT_FAILURE;
+    }
+
+    /* argv[1] may be ignored as there is only one logger - id=0 */
+
+    /* get logfile name - argv[2]*/
+    strcpy (nFic, argv[2]);
+
+    /* redirect stderr to error file, or to the channel of the generator - argv[3]*/
+    errorRedirect (argv[3]);
+
+    /* getting key value - picked by the generator */
+    if ((keyStr = getenv (KEYENV)) == NULL) {
+        fprintf (stderr, "Key of the simulation is missing!\n");
+        return EXIT_FAILURE;
+    }
+    key = (int) strtol (keyStr, &tinp, 0);
+    if (*tinp != '\0') { 
+        fprintf (stderr, "Key of the simulation is wrong!\n");
+        return EXIT_FAILURE;
+    }
+
+    /* connection to the semaphore set and the shared memory region and mapping the shared region onto the
+       process address space */
+    if ((semgid = semConnect (key)) == -1) {
+        perror ("error on connecting to the semaphore set");
+        return EXIT_FAILURE;
+    }
+    if ((shmid = shmemConnect (key)) == -1) {
+        perror ("error on connecting to the shared memory region");
+        return EXIT_FAILURE;
+    }
+    if (shmemAttach (shmid, (void **) &sh) == -1) {
+        perror ("error on mapping the shared region on the process address space");
+        return EXIT_FAILURE;
+    }
+
+    /* the logger does not outlive the generator */
+    if (!ownerAlive (sh)) {
+        fprintf (stderr, "The generator has terminated!\n");
+        return EXIT_FAILURE;
+    }
+
+    /* recording the semaphore operations in the statistics block (instrumented build) */
+    semStatAttach (SEMSTATS (sh), SEM_NU (sh->fSt.nReferees) + 1);
+
+    /* formatting the records until the end of log marker */
+    drainLog (nFic, &sh->fSt, &sh->logCtl, semgid);
+    atomic_fetch_add (&sh->semOps, semOpCount);                                 /* reporting the synchronization cost */
+
+    /* unmapping the shared region off the process address space */
+    if (shmemDettach (sh) == -1) {
+        perror ("error on unmapping the shared region off the process address space");
+        return EXIT_FAILURE;;
+    }
+
+    return EXIT_SUCCESS;
+}
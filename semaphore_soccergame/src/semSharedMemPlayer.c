@@ -22,6 +22,7 @@
 #include <sys/types.h>
 #include <sys/ipc.h>
 #include <string.h>
+#include <stdint.h>
 #include <math.h>
 
 #include "probConst.h"
@@ -29,13 +30,22 @@
 #include "logging.h"
 #include "sharedDataSync.h"
 #include "semaphore.h"
+#include "semStat.h"
+#include "trace.h"
+#include "vclock.h"
 #include "sharedMemory.h"
+#include "errorChannel.h"
+#include "barrier.h"
+#include "waitWord.h"
+#include "soccerThreads.h"
 
 /** \brief logging file name */
 static char nFic[51];
 
+#if !defined (SOCCER_THREADS) && !defined (SOCCER_WORKER)
 /** \brief shared memory block access identifier */
 static int shmid;
+#endif
 
 /** \brief semaphore set access identifier */
 static int semgid;
@@ -55,6 +65,46 @@ static void waitReferee(int id, int team);
 /** \brief player waits for referee to end match */
 static void playUntilEnd(int id, int team);
 
+#if !defined (SOCCER_THREADS) && !defined (SOCCER_WORKER)
+
+/**
+ *  \brief player waits for the next round of a tournament
+ *
+ *  Outside a tournament the player terminates after its match. In a tournament it detaches from the log, so that
+ *  its records of the round can be merged, tells the generator that its round is over and waits for the next one,
+ *  for which the generator resets the shared region; a late player thus takes part in the next match.
+ *
+ *  \param id player id
+ *
+ *  \return \c true, if there is a next round
+ */
+static bool nextRound (int id)
+{
+    unsigned int next;                                                                          /* next round */
+
+    if (!sh->tournament) {
+        return false;
+    }
+    next = sh->round + 1;                                  /* the generator only changes it once the round is over */
+    traceDetach ();
+    logDetach ();
+
+    if (semUp (semgid, sh->roundEnd) == -1) {                                                 /* the round is over */
+        perror ("error on the up operation for semaphore access of roundEnd (PL)");
+        exit (EXIT_FAILURE);
+    }
+    if (semDown (semgid, sh->roundStart[next % 2]) == -1) {                            /* wait for the next round */
+        perror ("error on the down operation for semaphore access of roundStart (PL)");
+        exit (EXIT_FAILURE);
+    }
+    if (atomic_load (&sh->over)) {
+        return false;
+    }
+
+    logAttach (nFic, &sh->logCtl, semgid, LOG_PLAYER, id);
+    return true;
+}
+
 /**
  *  \brief Main program.
  *
@@ -63,6 +113,7 @@ static void playUntilEnd(int id, int team);
 int main (int argc, char *argv[])
 {
     int key;                                            /*access key to shared memory and semaphore set */
+    char *keyStr;                                       /* access key, as passed by the generator */
     char *tinp;                                                       /* numerical parameters test flag */
     int n, team;
 
@@ -76,7 +127,7 @@ int main (int argc, char *argv[])
 
     /* get goalie id - argv[1]*/
     n = (unsigned int) strtol (argv[1], &tinp, 0);
-    if ((*tinp != '\0') || (n >= NUMPLAYERS )) { 
+    if (*tinp != '\0') { 
         fprintf (stderr, "Player process identification is wrong!\n");
         return EXIT_FAILURE;
     }
@@ -84,15 +135,19 @@ int main (int argc, char *argv[])
     /* get logfile name - argv[2]*/
     strcpy (nFic, argv[2]);
 
-    /* redirect stderr to error file  - argv[3]*/
-    freopen (argv[3], "w", stderr);
-    setbuf(stderr,NULL);
+    /* redirect stderr to error file, or to the channel of the generator - argv[3]*/
+    errorRedirect (argv[3]);
 
 
-    /* getting key value */
-    if ((key = ftok (".", 'a')) == -1) {
-        perror ("error on generating the key");
-        exit (EXIT_FAILURE);
+    /* getting key value - picked by the generator */
+    if ((keyStr = getenv (KEYENV)) == NULL) {
+        fprintf (stderr, "Key of the simulation is missing!\n");
+        return EXIT_FAILURE;
+    }
+    key = (int) strtol (keyStr, &tinp, 0);
+    if (*tinp != '\0') { 
+        fprintf (stderr, "Key of the simulation is wrong!\n");
+        return EXIT_FAILURE;
     }
 
     /* connection to the semaphore set and the shared memory region and mapping the shared region onto the
@@ -110,17 +165,37 @@ int main (int argc, char *argv[])
         return EXIT_FAILURE;
     }
 
-    /* initialize random generator */
-    srandom ((unsigned int) getpid ());                                                 
-
+    /* the player does not outlive the generator */
+    if (!ownerAlive (sh)) {
+        fprintf (stderr, "The generator has terminated!\n");
+        return EXIT_FAILURE;
+    }
 
-    /* simulation of the life cycle of the player */
-    arrive(n);
-    if((team = playerConstituteTeam(n))!=0) {
-        waitReferee(n, team);
-        playUntilEnd(n, team);
+    /* validation of player id against the population of the shared region */
+    if ((n < 0) || (n >= sh->fSt.nPlayers)) { 
+        fprintf (stderr, "Player process identification is wrong!\n");
+        return EXIT_FAILURE;
     }
 
+    /* recording the semaphore operations in the statistics block (instrumented build) */
+    semStatAttach (SEMSTATS (sh), SEM_NU (sh->fSt.nReferees) + 1);
+
+    /* attaching to the log */
+    logAttach (nFic, &sh->logCtl, semgid, LOG_PLAYER, n);
+
+    /* simulation of the life cycle of the player, once for every round of a tournament */
+    do {
+        arrive(n);
+        if((team = playerConstituteTeam(n))!=0) {
+            waitReferee(n, team);
+            playUntilEnd(n, team);
+        }
+
+        /* reporting the synchronization cost */
+        atomic_fetch_add (&sh->semOps, semOpCount);
+        semOpCount = 0;
+    } while (nextRound (n));
+
     /* unmapping the shared region off the process address space */
     if (shmemDettach (sh) == -1) {
         perror ("error on unmapping the shared region off the process address space");
@@ -130,6 +205,56 @@ int main (int argc, char *argv[])
     return EXIT_SUCCESS;
 }
 
+#else
+
+/**
+ *  \brief Binding of the players to the logging file, the shared region and the semaphore set.
+ *
+ *  Must be called by the generator before any player thread is created (or by a worker of the pool, once, before
+ *  it runs any life cycle).
+ *
+ *  \param logName name of the logging file
+ *  \param p_sh pointer to the shared region
+ *  \param p_semgid semaphore set identifier
+ */
+void playerBind (char logName[], SHARED_DATA *p_sh, int p_semgid)
+{
+    strcpy (nFic, logName);
+    sh = p_sh;
+    semgid = p_semgid;
+}
+
+/**
+ *  \brief Thread entry point.
+ *
+ *  Its role is to run the life cycle of one of intervening entities in the problem, the player, inside the
+ *  generator process (or inside a worker of the pool, see semSharedMemWorker.c).
+ */
+void *playerThread (void *arg)
+{
+    int n = (int) (intptr_t) arg, team;
+
+    /* attaching to the log */
+    logAttach (nFic, &sh->logCtl, semgid, LOG_PLAYER, n);
+    vclockEnter ();                                               /* waits for its turn, in virtual time */
+
+    /* simulation of the life cycle of the player */
+    arrive(n);
+    if((team = playerConstituteTeam(n))!=0) {
+        waitReferee(n, team);
+        playUntilEnd(n, team);
+    }
+
+    /* reporting the synchronization cost */
+    atomic_fetch_add (&sh->semOps, semOpCount);
+    traceDetach ();                                               /* a thread is not detached on exit */
+    vclockLeave ();
+
+    return NULL;
+}
+
+#endif
+
 /**
  *  \brief player takes some time to arrive
  *
@@ -139,12 +264,14 @@ int main (int argc, char *argv[])
  */
 static void arrive(int id)
 {    
+    benchFirst (&sh->tArrive);                                                  /* the first arrival starts the match */
+
     if (semDown (semgid, sh->mutex) == -1)  {                                       				/* enter critical region */
         perror ("error on the down operation for semaphore access (PL)");
         exit (EXIT_FAILURE);
     }
 
-    sh->fSt.st.playerStat[id] = ARRIVING;															// Change State
+    SETSTATE (&sh->fSt, PLAYERSTAT(&sh->fSt.st, id), ARRIVING);															// Change State
   	saveState(nFic, &sh->fSt);
     
     if (semUp (semgid, sh->mutex) == -1) {                                          				/* exit critical region */
@@ -152,103 +279,101 @@ static void arrive(int id)
         exit (EXIT_FAILURE);
     }
 
-    usleep((200.0*random())/(RAND_MAX+1.0)+50.0);
+    if (!sh->fSt.noDelay) {
+        vclockSleep(PLAYERDELAY(sh, id));
+    }
 }
 
 /**
  *  \brief player constitutes team
  *
- *  If player is late, it updates state and leaves.
- *  If there are enough free players and free goalies to form a team, player forms team allowing 
- *  team members to proceed and waiting for them to acknowledge registration.
- *  Otherwise it updates state, waits for the forming teammate to "call" him, saves its team
- *  and acknowledges registration.
+ *  If player is late, it updates state and leaves; lateness is decided without entering the critical region.
+ *  If there are enough free players and free goalies to form a team, player forms team: it reserves the team
+ *  id, takes the team members off the front of the queues of the waiting players and goalies, and hands the team
+ *  id to each one, on its wait word, once it has left the critical region.
+ *  Otherwise it updates state, joins the queue of the waiting players and waits on its own wait word for the
+ *  forming teammate to hand it the team id.
+ *  Every team member registers on its team barrier, outside the critical region; the last one to register
+ *  notifies the referee that the team is formed.
  *  The internal state should be saved.
  *
  *  \param id player id
  * 
- *  \return id of player team (0 for late goalies; 1 for team 1; 2 for team 2)
+ *  \return id of player team (0 for late players; 1 .. nReferees * nTeams for the team)
  *
  */
 static int playerConstituteTeam (int id)
 {
     int ret = 0;
+	int player_type = 2;																			// Flag to determine out of critical region actions; 0-LATE, 1-Forming, 2- Waiting
+	int playersFrom = 0, goaliesFrom = 0;															// Queue positions of the team members taken by a forming player
+
+    if(atomic_fetch_add(&sh->fSt.playersArrived, 1) >= sh->fSt.nReferees*sh->fSt.nTeams*sh->fSt.teamPlayers) {	// Player is late: no need for the critical region to know it
+    	player_type = 0;
+    }
 
     if (semDown (semgid, sh->mutex) == -1)  {                                       				/* enter critical region */
         perror ("error on the down operation for semaphore access (PL)");
         exit (EXIT_FAILURE);
     }
-	int player_type = 0;																			// Flag to determine out of critical region actions; 0-LATE, 1-Forming, 2- Waiting
-    if(++sh->fSt.playersArrived >8){ 																// Player is late so it only changes its state
-    	sh->fSt.st.playerStat[id]= LATE;
+    if(player_type == 0){ 																			// Player is late so it only changes its state
+    	SETSTATE (&sh->fSt, PLAYERSTAT(&sh->fSt.st, id), LATE);
         saveState(nFic, &sh->fSt);
 	}
-	else if(sh->fSt.playersFree >= 3 && sh->fSt.goaliesFree) {										// Player forms team
-		sh->fSt.playersFree -= 3;
-		sh->fSt.goaliesFree--;
-	    sh->fSt.st.playerStat[id] = FORMING_TEAM; 													// Change State
+	else if(sh->fSt.playerQueueIn - sh->fSt.playerQueueOut >= sh->fSt.teamPlayers-1 &&
+	        sh->fSt.goalieQueueIn - sh->fSt.goalieQueueOut >= sh->fSt.teamGoalies) {				// Player forms team
+		playersFrom = sh->fSt.playerQueueOut;														// Take the first players and goalies
+		goaliesFrom = sh->fSt.goalieQueueOut;														// that joined the queues
+		sh->fSt.playerQueueOut += sh->fSt.teamPlayers-1;
+		sh->fSt.goalieQueueOut += sh->fSt.teamGoalies;
+	    SETSTATE (&sh->fSt, PLAYERSTAT(&sh->fSt.st, id), FORMING_TEAM); 													// Change State
 	    saveState(nFic, &sh->fSt);
-	    int count = 0;
-	    do {
-			if(semUp(semgid,sh->playersWaitTeam) == -1){											// Notify waiting player
-		    	perror ("error on the up operation for semaphore access of playersWaitTeam (PL)");
-				exit (EXIT_FAILURE);
-			}
-			if(semDown(semgid,sh->playerRegistered) == -1){											// Wait to be notified that he registered
-	    		perror ("error on the down operation for semaphore access of playerRegistered (PL)");
-				exit (EXIT_FAILURE);
-			}
-			count++;
-		} while(count != NUMTEAMPLAYERS-1); 														// For every other player in the team
-		if(semUp(semgid,sh->goaliesWaitTeam) == -1){												// Then do the same for the goalie
-			perror ("error on the up operation for semaphore access of goaliesWaitTeam (PL)");
-			exit (EXIT_FAILURE);
-		}
-		if(semDown(semgid,sh->playerRegistered) == -1){
-			perror ("error on the down operation for semaphore access of playerRegistered (PL)");
-			exit (EXIT_FAILURE);
-		}			
-		
-		ret = sh->fSt.teamId++;																		// Return value assigned to team id and increment i
-		player_type=1;																				// Return value assigned to team id and increment it
-
+		ret = sh->fSt.teamId++;																		// Return value assigned to team id and increment it
+	    barrierArm(TEAM(sh,ret), sh->fSt.teamPlayers+sh->fSt.teamGoalies);							// Every team member registers
+		player_type=1;
 	}													
 	else {
-		sh->fSt.playersFree++;																		// Player arrived on time but not enough teammates
-		sh->fSt.st.playerStat[id] = WAITING_TEAMS;
+		PLAYERQUEUE(sh)[sh->fSt.playerQueueIn++] = id;												// Player arrived on time but not enough teammates
+		SETSTATE (&sh->fSt, PLAYERSTAT(&sh->fSt.st, id), WAITING_TEAMS);
 		saveState(nFic, &sh->fSt);
-		player_type = 2;																			// We still dont know the return value here since the team isnt formed yet
 	}
-	
     if (semUp (semgid, sh->mutex) == -1) {                                          				/* exit critical region */
         perror ("error on the down operation for semaphore access (PL)");
         exit (EXIT_FAILURE);
     }
+
 	switch(player_type){
 		case 0:
-			break;
+			return ret;
 		case 1:
-			if (semUp (semgid, sh->refereeWaitTeams) == -1) {										// Notify referee that a team was formed
-				perror ("error on the up operation for semaphore access of refereeWaitTeams (PL)");
-				exit (EXIT_FAILURE);
-			}
+		    for(int k = 0; k < sh->fSt.teamPlayers-1; k++) {											// Hand the team id to every other player
+		    	if(wordPost(PLAYERWORD(sh, PLAYERQUEUE(sh)[playersFrom+k]), ret) == -1){				// in the team
+		    		perror ("error on handing the team id to a player (PL)");
+		    		exit (EXIT_FAILURE);
+		    	}
+		    }
+		    for(int k = 0; k < sh->fSt.teamGoalies; k++) {												// and to the goalies
+		    	if(wordPost(GOALIEWORD(sh, GOALIEQUEUE(sh)[goaliesFrom+k]), ret) == -1){
+		    		perror ("error on handing the team id to a goalie (PL)");
+		    		exit (EXIT_FAILURE);
+		    	}
+		    }
 			break;
 		case 2:
-			if(semDown(semgid,sh->playersWaitTeam) == -1){											// Wait for a player to form a team
-		        perror ("error on the down operation for semaphore access of goaliesWaitTeam (GL)");
+			if(wordWait(PLAYERWORD(sh, id), &ret) == -1){												// Wait for a player to form a team
+		        perror ("error on waiting for the team id (PL)");												// and take the team id it handed
 		    	exit (EXIT_FAILURE);
 			}
-		
-			ret = sh->fSt.teamId;																	// Get team ID of forming team
-			if(semUp(semgid,sh->playerRegistered) == -1){											// Register as a player of that team
-				perror ("error on the up operation for semaphore access of playerRegistered (GL)");
-				exit (EXIT_FAILURE);
-			}
 			break;
 		default:
 			perror("Invalid player type was assigned");
-	}    
-	
+	}
+
+	if(barrierArrive(semgid,TEAM(sh,ret)) == -1){												// Register as a member of that team
+		perror ("error on the up operation for semaphore access of teamsFormed (PL)");
+		exit (EXIT_FAILURE);
+	}
+
 	return ret;
 }
 
@@ -263,20 +388,25 @@ static int playerConstituteTeam (int id)
  */
 static void waitReferee (int id, int team)
 {
-    if (semDown (semgid, sh->mutex) == -1)  {                                       				/* enter critical region */
+    PITCH *pt = &PITCHES(sh)[TEAMPITCH(sh, team)];                                         /* pitch of the match */
+    char pFic[64];                                                                    /* logging file of the pitch */
+
+    pitchLogName (pFic, nFic, &sh->logCtl, TEAMPITCH(sh, team));
+
+    if (semDown (semgid, pt->mutex) == -1)  {                                       				/* enter pitch critical region */
         perror ("error on the down operation for semaphore access (PL)");
         exit (EXIT_FAILURE);
     }
 
-	sh->fSt.st.playerStat[id] = (team == 1) ? WAITING_START_1 : WAITING_START_2; 					// Determine right state and save it
-	saveState(nFic, &sh->fSt);
+	SETSTATE (&sh->fSt, PLAYERSTAT(&sh->fSt.st, id), TEAMONE(sh, team) ? WAITING_START_1 : WAITING_START_2); 					// Determine right state and save it
+	saveState(pFic, &sh->fSt);
 	
-    if (semUp (semgid, sh->mutex) == -1) {                                          				/* exit critical region */
+    if (semUp (semgid, pt->mutex) == -1) {                                          				/* exit pitch critical region */
         perror ("error on the down operation for semaphore access (PL)");
         exit (EXIT_FAILURE);
     }
 
-	if (semDown (semgid, sh->playersWaitReferee) == -1)  {											//Wait for referee to be ready to start match
+	if (barrierWait (semgid, &pt->start) == -1)  {													//Wait for referee to be ready to start match
 		perror ("error on the up operation for semaphore access of playersWaitReferee (PL)");
 	    exit (EXIT_FAILURE);
 	}
@@ -294,28 +424,34 @@ static void waitReferee (int id, int team)
  */
 static void playUntilEnd (int id, int team)
 {
-    if (semDown (semgid, sh->mutex) == -1)  {                                       				/* enter critical region */
+    PITCH *pt = &PITCHES(sh)[TEAMPITCH(sh, team)];                                         /* pitch of the match */
+    char pFic[64];                                                                    /* logging file of the pitch */
+
+    pitchLogName (pFic, nFic, &sh->logCtl, TEAMPITCH(sh, team));
+
+    if (semDown (semgid, pt->mutex) == -1)  {                                       				/* enter pitch critical region */
         perror ("error on the up operation for semaphore access (PL)");
         exit (EXIT_FAILURE);
     }
 
-    sh->fSt.st.playerStat[id] = (team == 1) ? PLAYING_1 : PLAYING_2;
-    saveState(nFic, &sh->fSt);
+    SETSTATE (&sh->fSt, PLAYERSTAT(&sh->fSt.st, id), TEAMONE(sh, team) ? PLAYING_1 : PLAYING_2);
+    saveState(pFic, &sh->fSt);
     
-    if (semUp (semgid, sh->playing) == -1) {                                        				// Notify that player is playing
-    	perror ("error on the down operation for semaphore access of playing (PL)");
+    if (semUp (semgid, pt->mutex) == -1) {                                          				/* exit pitch critical region */
+        perror ("error on the up operation for semaphore access (PL)");
         exit (EXIT_FAILURE);
     }
 
-    if (semUp (semgid, sh->mutex) == -1) {                                          				/* exit critical region */
-        perror ("error on the up operation for semaphore access (PL)");
+    if (barrierArrive (semgid, &pt->start) == -1) {                                 				// Notify that player is playing
+    	perror ("error on the up operation for semaphore access of playing (PL)");
         exit (EXIT_FAILURE);
     }
 
-    if (semDown (semgid, sh->playersWaitEnd) == -1) {                               				// Wait for match to end
+    if (barrierWait (semgid, &pt->end) == -1) {                                     				// Wait for match to end
     	perror ("error on the down operation for semaphore access of playersWaitEnd (PL)");
     	exit (EXIT_FAILURE);
 	}
+    benchLast (&pt->tLeft);                                                          /* the last one ends the match */
 
 }
 
@@ -23,6 +23,7 @@
 #include <sys/types.h>
 #include <sys/ipc.h>
 #include <string.h>
+#include <stdint.h>
 #include <math.h>
 #include <signal.h>
 #include <sys/time.h>
@@ -33,14 +34,22 @@
 #include "logging.h"
 #include "sharedDataSync.h"
 #include "semaphore.h"
+#include "semStat.h"
+#include "trace.h"
+#include "vclock.h"
 #include "sharedMemory.h"
+#include "errorChannel.h"
+#include "barrier.h"
+#include "soccerThreads.h"
 
 
 /** \brief logging file name */
 static char nFic[51];
 
+#if !defined (SOCCER_THREADS) && !defined (SOCCER_WORKER)
 /** \brief shared memory block access identifier */
 static int shmid;
+#endif
 
 /** \brief semaphore set access identifier */
 static int semgid;
@@ -49,19 +58,59 @@ static int semgid;
 static SHARED_DATA *sh;
 
 /** \brief referee takes some time to arrive */
-static void arrive ();
+static void arrive (int id);
 
 /** \brief referee waits for teams to be formed */
-static void waitForTeams ();
+static int waitForTeams (int id);
 
 /** \brief referee starts game */
-static void startGame ();
+static void startGame (int id, int pitch);
 
 /** \brief referee takes some time to allow game to finish */
-static void play ();
+static void play (int id, int pitch);
 
 /** \brief referee ends game */
-static void endGame ();
+static void endGame (int id, int pitch);
+
+#if !defined (SOCCER_THREADS) && !defined (SOCCER_WORKER)
+
+/**
+ *  \brief referee waits for the next round of a tournament
+ *
+ *  Outside a tournament the referee terminates after its match. In a tournament it detaches from the log, so that
+ *  its records of the round can be merged, tells the generator that its round is over and waits for the next one,
+ *  for which the generator resets the shared region; a late referee thus takes part in the next match.
+ *
+ *  \param id referee id
+ *
+ *  \return \c true, if there is a next round
+ */
+static bool nextRound (int id)
+{
+    unsigned int next;                                                                          /* next round */
+
+    if (!sh->tournament) {
+        return false;
+    }
+    next = sh->round + 1;                                  /* the generator only changes it once the round is over */
+    traceDetach ();
+    logDetach ();
+
+    if (semUp (semgid, sh->roundEnd) == -1) {                                                 /* the round is over */
+        perror ("error on the up operation for semaphore access of roundEnd (RF)");
+        exit (EXIT_FAILURE);
+    }
+    if (semDown (semgid, sh->roundStart[next % 2]) == -1) {                            /* wait for the next round */
+        perror ("error on the down operation for semaphore access of roundStart (RF)");
+        exit (EXIT_FAILURE);
+    }
+    if (atomic_load (&sh->over)) {
+        return false;
+    }
+
+    logAttach (nFic, &sh->logCtl, semgid, LOG_REFEREE, id);
+    return true;
+}
 
 /**
  *  \brief Main program.
@@ -71,6 +120,9 @@ static void endGame ();
 int main (int argc, char *argv[])
 {
     int key;                                          /*access key to shared memory and semaphore set */
+    char *keyStr;                                       /* access key, as passed by the generator */
+    char *tinp;                                                       /* numerical parameters test flag */
+    int n, pitch;
 
     /* validation of command line parameters */
     if (argc != 4) { 
@@ -79,19 +131,28 @@ int main (int argc, char *argv[])
         return EXIT_FAILURE;
     }
 
-    /* argv[1] may be ignored as there is only one referee - id=0 */
+    /* get referee id - argv[1]*/
+    n = (unsigned int) strtol (argv[1], &tinp, 0);
+    if (*tinp != '\0') { 
+        fprintf (stderr, "Referee process identification is wrong!\n");
+        return EXIT_FAILURE;
+    }
 
     /* get logfile name - argv[2]*/
     strcpy (nFic, argv[2]);
 
-    /* redirect stderr to error file  - argv[3]*/
-    freopen (argv[3], "w", stderr);
-    setbuf(stderr,NULL);
+    /* redirect stderr to error file, or to the channel of the generator - argv[3]*/
+    errorRedirect (argv[3]);
 
-    /* getting key value */
-    if ((key = ftok (".", 'a')) == -1) {
-        perror ("error on generating the key");
-        exit (EXIT_FAILURE);
+    /* getting key value - picked by the generator */
+    if ((keyStr = getenv (KEYENV)) == NULL) {
+        fprintf (stderr, "Key of the simulation is missing!\n");
+        return EXIT_FAILURE;
+    }
+    key = (int) strtol (keyStr, &tinp, 0);
+    if (*tinp != '\0') { 
+        fprintf (stderr, "Key of the simulation is wrong!\n");
+        return EXIT_FAILURE;
     }
 
     /* connection to the semaphore set and the shared memory region and mapping the shared region onto the
@@ -109,15 +170,36 @@ int main (int argc, char *argv[])
         return EXIT_FAILURE;
     }
 
-    /* initialize random generator */
-    srandom ((unsigned int) getpid ());                                      
+    /* the referee does not outlive the generator */
+    if (!ownerAlive (sh)) {
+        fprintf (stderr, "The generator has terminated!\n");
+        return EXIT_FAILURE;
+    }
 
-    /* simulation of the life cycle of the referee */
-    arrive();
-    waitForTeams();
-    startGame();
-    play();
-    endGame();
+    /* validation of referee id against the population of the shared region */
+    if ((n < 0) || (n >= sh->fSt.nReferees)) { 
+        fprintf (stderr, "Referee process identification is wrong!\n");
+        return EXIT_FAILURE;
+    }
+
+    /* recording the semaphore operations in the statistics block (instrumented build) */
+    semStatAttach (SEMSTATS (sh), SEM_NU (sh->fSt.nReferees) + 1);
+
+    /* attaching to the log */
+    logAttach (nFic, &sh->logCtl, semgid, LOG_REFEREE, n);
+
+    /* simulation of the life cycle of the referee, once for every round of a tournament */
+    do {
+        arrive(n);
+        pitch = waitForTeams(n);
+        startGame(n, pitch);
+        play(n, pitch);
+        endGame(n, pitch);
+
+        /* reporting the synchronization cost */
+        atomic_fetch_add (&sh->semOps, semOpCount);
+        semOpCount = 0;
+    } while (nextRound (n));
 
     /* unmapping the shared region off the process address space */
     if (shmemDettach (sh) == -1) { 
@@ -128,21 +210,72 @@ int main (int argc, char *argv[])
     return EXIT_SUCCESS;
 }
 
+#else
+
+/**
+ *  \brief Binding of the referees to the logging file, the shared region and the semaphore set.
+ *
+ *  Must be called by the generator before any referee thread is created (or by a worker of the pool, once, before
+ *  it runs any life cycle).
+ *
+ *  \param logName name of the logging file
+ *  \param p_sh pointer to the shared region
+ *  \param p_semgid semaphore set identifier
+ */
+void refereeBind (char logName[], SHARED_DATA *p_sh, int p_semgid)
+{
+    strcpy (nFic, logName);
+    sh = p_sh;
+    semgid = p_semgid;
+}
+
+/**
+ *  \brief Thread entry point.
+ *
+ *  Its role is to run the life cycle of one of intervening entities in the problem, the referee, inside the
+ *  generator process (or inside a worker of the pool, see semSharedMemWorker.c).
+ */
+void *refereeThread (void *arg)
+{
+    int n = (int) (intptr_t) arg, pitch;
+
+    /* attaching to the log */
+    logAttach (nFic, &sh->logCtl, semgid, LOG_REFEREE, n);
+    vclockEnter ();                                               /* waits for its turn, in virtual time */
+
+    /* simulation of the life cycle of the referee */
+    arrive(n);
+    pitch = waitForTeams(n);
+    startGame(n, pitch);
+    play(n, pitch);
+    endGame(n, pitch);
+
+    /* reporting the synchronization cost */
+    atomic_fetch_add (&sh->semOps, semOpCount);
+    traceDetach ();                                               /* a thread is not detached on exit */
+    vclockLeave ();
+
+    return NULL;
+}
+
+#endif
+
 /**
  *  \brief referee takes some time to arrive
  *
  *  Referee updates state and takes some time to arrive
  *  The internal state should be saved.
  *
+ *  \param id referee id
  */
-static void arrive ()
+static void arrive (int id)
 {
     if (semDown (semgid, sh->mutex) == -1) {                                                      	/* enter critical region */
         perror ("error on the down operation for semaphore access (RF)");
         exit (EXIT_FAILURE);
     }
 
-    sh->fSt.st.refereeStat = ARRIVINGR; 																// They should all be in this state already
+    SETSTATE (&sh->fSt, REFEREESTAT(&sh->fSt.st, id), ARRIVINGR); 															// They should all be in this state already
     saveState(nFic, &sh->fSt);
 
     if (semUp (semgid, sh->mutex) == -1) {                                                        	/* leave critical region */
@@ -150,25 +283,33 @@ static void arrive ()
         exit (EXIT_FAILURE);
     }
     
-    usleep((100.0*random())/(RAND_MAX+1.0)+10.0);
+    if (!sh->fSt.noDelay) {
+        vclockSleep(REFEREEDELAY(sh, id));
+    }
    
 }
 
 /**
  *  \brief referee waits for teams to be formed
  *
- *  Referee updates state and waits for the 2 teams to be completely formed
+ *  Referee updates state, takes the next pitch and waits for the teams of its match to be completely formed;
+ *  the teams are formed in order, so the pitches are taken in order by whichever referees are free.
  *  The internal state should be saved.
  *
+ *  \param id referee id
+ *
+ *  \return pitch of the match (0 .. nReferees-1)
  */
-static void waitForTeams ()
+static int waitForTeams (int id)
 {
+    int pitch;
+
     if (semDown (semgid, sh->mutex) == -1) {                                                      	/* enter critical region */
         perror ("error on the down operation for semaphore access (RF)");
         exit (EXIT_FAILURE);
     }
 
-    sh->fSt.st.refereeStat = WAITING_TEAMS;                											// Change state
+    SETSTATE (&sh->fSt, REFEREESTAT(&sh->fSt.st, id), WAITING_TEAMS);                										// Change state
     saveState(nFic, &sh->fSt);   
 
     if (semUp (semgid, sh->mutex) == -1) {                                                        	/* leave critical region */
@@ -176,13 +317,16 @@ static void waitForTeams ()
         exit (EXIT_FAILURE);
     }
     
-    for(int i = 0;i<(NUMPLAYERS/(NUMTEAMPLAYERS+NUMTEAMGOALIES));i++){								// For all teams
-	    if (semDown (semgid, sh->refereeWaitTeams) == -1) {                                     	// Wait until a team is formed
-	        perror ("error on the down operation for semaphore access of refereeWaitTeams (RF)");
-	        exit (EXIT_FAILURE);
-	    }
+    /* The match of the next pitch is ours: its teams are the next ones to be formed */
+    pitch = atomic_fetch_add(&sh->fSt.nextPitch, 1);
+    if (semDownN (semgid, PITCHES(sh)[pitch].teamsFormed, sh->fSt.nTeams) == -1) {	// Wait until the teams of the match are formed
+        perror ("error on the down operation for semaphore access of teamsFormed (RF)");
+        exit (EXIT_FAILURE);
     }
-    /* Upon leaving the loop the referee has waited for the formation of all teams */
+    atomic_store(&PITCHES(sh)[pitch].referee, id);
+    PITCHES(sh)[pitch].tTeams = benchTime ();
+
+    return pitch;
 }
 
 /**
@@ -191,34 +335,39 @@ static void waitForTeams ()
  *  Referee updates state and notifies players and goalies to start match
  *  The internal state should be saved.
  *
+ *  \param id    referee id
+ *  \param pitch pitch of the match
  */
-static void startGame ()
+static void startGame (int id, int pitch)
 {
-    if (semDown (semgid, sh->mutex) == -1) {                                                      	/* enter critical region */
+    PITCH *pt = &PITCHES(sh)[pitch];
+    char pFic[64];                                                                    /* logging file of the pitch */
+
+    pitchLogName (pFic, nFic, &sh->logCtl, pitch);
+
+    if (semDown (semgid, pt->mutex) == -1) {                                                      	/* enter pitch critical region */
         perror ("error on the down operation for semaphore access (RF)");
         exit (EXIT_FAILURE);
     }
 
-    sh->fSt.st.refereeStat = STARTING_GAME; 														// Change State
-    saveState(nFic, &sh->fSt);   
+    SETSTATE (&sh->fSt, REFEREESTAT(&sh->fSt.st, id), STARTING_GAME); 														// Change State
+    saveState(pFic, &sh->fSt);   
 
-    if (semUp (semgid, sh->mutex) == -1) {                                                        	/* leave critical region */
+    if (semUp (semgid, pt->mutex) == -1) {                                                        	/* leave pitch critical region */
         perror ("error on the up operation for semaphore access (RF)");
         exit (EXIT_FAILURE);
     }
 
-    int count=0;
-    while(count<NUMPLAYERS){
-	    if (semUp(semgid, sh->playersWaitReferee) == -1) { 											// Notify players that referee is ready */
-	    	perror("error on the up operation for semaphore access of playersWaitReferee (RF)");
-	    	exit(EXIT_FAILURE);
-	    }
-	    if (semDown(semgid, sh->playing) == -1) { 													// Get notified by players 
-	        perror("error on the down operation for semaphore access of playing (RF)");
-	   		exit(EXIT_FAILURE);
-	    }
-	    count++;
+    pt->tStart = benchTime ();
+    if (barrierRelease(semgid, &pt->start, sh->fSt.nTeams*(sh->fSt.teamPlayers+sh->fSt.teamGoalies)) == -1) { 									// Notify all players that referee is ready
+    	perror("error on the up operation for semaphore access of playersWaitReferee (RF)");
+    	exit(EXIT_FAILURE);
+    }
+    if (barrierCollect(semgid, &pt->start) == -1) { 												// Get notified by the last player to play
+        perror("error on the down operation for semaphore access of playing (RF)");
+   		exit(EXIT_FAILURE);
     }
+    pt->tPlaying = benchTime ();
 }
 
 /**
@@ -227,23 +376,32 @@ static void startGame ()
  *  Referee updates state and takes some time to finish the game 
  *  The internal state should be saved.
  *
+ *  \param id    referee id
+ *  \param pitch pitch of the match
  */
-static void play ()
+static void play (int id, int pitch)
 {
-    if (semDown (semgid, sh->mutex) == -1) {                                                      	/* enter critical region */
+    PITCH *pt = &PITCHES(sh)[pitch];
+    char pFic[64];                                                                    /* logging file of the pitch */
+
+    pitchLogName (pFic, nFic, &sh->logCtl, pitch);
+
+    if (semDown (semgid, pt->mutex) == -1) {                                                      	/* enter pitch critical region */
         perror ("error on the down operation for semaphore access (RF)");
         exit (EXIT_FAILURE);
     }
 
-    sh->fSt.st.refereeStat = REFEREEING; 															// Change State
-    saveState(nFic, &sh->fSt);
+    SETSTATE (&sh->fSt, REFEREESTAT(&sh->fSt.st, id), REFEREEING); 															// Change State
+    saveState(pFic, &sh->fSt);
 
-    if (semUp (semgid, sh->mutex) == -1) {                                                        	/* leave critical region */
+    if (semUp (semgid, pt->mutex) == -1) {                                                        	/* leave pitch critical region */
         perror ("error on the up operation for semaphore access (RF)");
         exit (EXIT_FAILURE);
     }
 
-    usleep((100.0*random())/(RAND_MAX+1.0)+900.0);
+    if (!sh->fSt.noDelay) {
+        vclockSleep(PLAYDELAY(sh, id));
+    }
 }
 
 /**
@@ -252,28 +410,32 @@ static void play ()
  *  Referee updates state and notifies players and goalies to end match
  *  The internal state should be saved.
  *
+ *  \param id    referee id
+ *  \param pitch pitch of the match
  */
-static void endGame ()
+static void endGame (int id, int pitch)
 {
-    if (semDown (semgid, sh->mutex) == -1) {                                                      	/* enter critical region */
+    PITCH *pt = &PITCHES(sh)[pitch];
+    char pFic[64];                                                                    /* logging file of the pitch */
+
+    pitchLogName (pFic, nFic, &sh->logCtl, pitch);
+
+    if (semDown (semgid, pt->mutex) == -1) {                                                      	/* enter pitch critical region */
         perror ("error on the down operation for semaphore access (RF)");
         exit (EXIT_FAILURE);
     }
 
-    sh->fSt.st.refereeStat = ENDING_GAME; 															// Change State
-    saveState(nFic, &sh->fSt);
+    SETSTATE (&sh->fSt, REFEREESTAT(&sh->fSt.st, id), ENDING_GAME); 															// Change State
+    saveState(pFic, &sh->fSt);
 
-    if (semUp (semgid, sh->mutex) == -1) {                                                        	/* leave critical region */
+    if (semUp (semgid, pt->mutex) == -1) {                                                        	/* leave pitch critical region */
         perror ("error on the up operation for semaphore access (RF)");
         exit (EXIT_FAILURE);
     }
 
-	int count=0;
-	while(count<NUMPLAYERS){
-		if (semUp(semgid, sh->playersWaitEnd) == -1) {												// Notify players of match end
-			perror("error on the up operation for playersWaitEnd (RF)");
-		  	exit(EXIT_FAILURE);
-		}
-		count++;
+    pt->tEnd = benchTime ();
+	if (barrierRelease(semgid, &pt->end, sh->fSt.nTeams*(sh->fSt.teamPlayers+sh->fSt.teamGoalies)) == -1) {										// Notify all players of match end
+		perror("error on the up operation for playersWaitEnd (RF)");
+	  	exit(EXIT_FAILURE);
 	}
 }
@@ -0,0 +1,165 @@
+/**
+ *  \file semSharedMemWorker.c (implementation file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  Synchronization based on semaphores and shared memory.
+ *  Implementation with SVIPC.
+ *
+ *  Worker of the pool of the generator (option <tt>-k</tt>).
+ *
+ *  A worker is generated once for the whole batch: it connects to the semaphore set and the shared region and
+ *  binds the players, goalies and referees to them, so that each match only costs the generator a command on the
+ *  standard input of the worker, instead of the generation of a process. For every command, the worker runs the
+ *  life cycle of the entity it names (see soccerThreads.h), detaches it from the log and answers with its index on
+ *  the standard output. It terminates at the end of its standard input.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/ipc.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "probConst.h"
+#include "probDataStruct.h"
+#include "logging.h"
+#include "sharedDataSync.h"
+#include "semaphore.h"
+#include "semStat.h"
+#include "sharedMemory.h"
+#include "errorChannel.h"
+#include "soccerThreads.h"
+
+/** \brief logging file name */
+static char nFic[51];
+
+/** \brief shared memory block access identifier */
+static int shmid;
+
+/** \brief semaphore set access identifier */
+static int semgid;
+
+/** \brief pointer to shared memory region */
+static SHARED_DATA *sh;
+
+/**
+ *  \brief Main program.
+ *
+ *  Its role is to run the life cycles of the intervening entities that the generator asks for, one per match.
+ */
+int main (int argc, char *argv[])
+{
+    int key;                                          /*access key to shared memory and semaphore set */
+    char *keyStr;                                                 /* access key, as passed by the generator */
+    char *tinp;                                                             /* numerical parameters test flag */
+    int w;                                                                                  /* worker index */
+    WORK_CMD cmd;                                                                      /* command of the generator */
+
+    /* validation of command line parameters */
+    if (argc != 4) {
+        freopen ("error_WK", "a", stderr);
+        fprintf (stderr, "Number of parameters is incorrect!\n");
+        return EXIT_FAILURE;
+    }
+
+    /* get worker index - argv[1]*/
+    w = (int) strtol (argv[1], &tinp, 0);
+    if (*tinp != '\0') {
+        fprintf (stderr, "Worker process identification is wrong!\n");
+        return EXIT_FAILURE;
+    }
+
+    /* get logfile name - argv[2]*/
+    strcpy (nFic, argv[2]);
+
+    /* redirect stderr to error file, or to the channel of the generator - argv[3]*/
+    errorRedirect (argv[3]);
+
+    /* getting key value - picked by the generator */
+    if ((keyStr = getenv (KEYENV)) == NULL) {
+        fprintf (stderr, "Key of the simulation is missing!\n");
+        return EXIT_FAILURE;
+    }
+    key = (int) strtol (keyStr, &tinp, 0);
+    if (*tinp != '\0') {
+        fprintf (stderr, "Key of the simulation is wrong!\n");
+        return EXIT_FAILURE;
+    }
+
+    /* connection to the semaphore set and the shared memory region and mapping the shared region onto the
+       process address space */
+    if ((semgid = semConnect (key)) == -1) {
+        perror ("error on connecting to the semaphore set");
+        return EXIT_FAILURE;
+    }
+    if ((shmid = shmemConnect (key)) == -1) {
+        perror ("error on connecting to the shared memory region");
+        return EXIT_FAILURE;
+    }
+    if (shmemAttach (shmid, (void **) &sh) == -1) {
+        perror ("error on mapping the shared region on the process address space");
+        return EXIT_FAILURE;
+    }
+
+    /* the worker does not outlive the generator */
+    if (!ownerAlive (sh)) {
+        fprintf (stderr, "The generator has terminated!\n");
+        return EXIT_FAILURE;
+    }
+
+    /* recording the semaphore operations in the statistics block (instrumented build) */
+    semStatAttach (SEMSTATS (sh), SEM_NU (sh->fSt.nReferees) + 1);
+
+    /* binding the intervening entities, once for the whole batch */
+    playerBind (nFic, sh, semgid);
+    goalieBind (nFic, sh, semgid);
+    refereeBind (nFic, sh, semgid);
+
+    /* running a life cycle per command, until the generator closes the pool */
+    while (read (STDIN_FILENO, &cmd, sizeof (cmd)) == sizeof (cmd)) {
+        semOpCount = 0;                                                       /* reported by the life cycle */
+        switch (cmd.kind) {
+            case LOG_PLAYER:
+                if ((cmd.id < 0) || (cmd.id >= sh->fSt.nPlayers)) {
+                    fprintf (stderr, "Player process identification is wrong!\n");
+                    return EXIT_FAILURE;
+                }
+                playerThread ((void *) (intptr_t) cmd.id);
+                break;
+            case LOG_GOALIE:
+                if ((cmd.id < 0) || (cmd.id >= sh->fSt.nGoalies)) {
+                    fprintf (stderr, "Goalie process identification is wrong!\n");
+                    return EXIT_FAILURE;
+                }
+                goalieThread ((void *) (intptr_t) cmd.id);
+                break;
+            case LOG_REFEREE:
+                if ((cmd.id < 0) || (cmd.id >= sh->fSt.nReferees)) {
+                    fprintf (stderr, "Referee process identification is wrong!\n");
+                    return EXIT_FAILURE;
+                }
+                refereeThread ((void *) (intptr_t) cmd.id);
+                break;
+            default:
+                fprintf (stderr, "Worker command is wrong!\n");
+                return EXIT_FAILURE;
+        }
+        logDetach ();                                               /* the private log is merged after the match */
+        if (write (STDOUT_FILENO, &w, sizeof (w)) != sizeof (w)) {
+            perror ("error on answering the generator");
+            return EXIT_FAILURE;
+        }
+    }
+
+    /* unmapping the shared region off the process address space */
+    if (shmemDettach (sh) == -1) {
+        perror ("error on unmapping the shared region off the process address space");
+        return EXIT_FAILURE;;
+    }
+
+    return EXIT_SUCCESS;
+}
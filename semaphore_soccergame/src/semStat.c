@@ -0,0 +1,113 @@
+/**
+ *  \file semStat.c (implementation file)
+ *
+ *  \brief Semaphore usage statistics.
+ *
+ *  Operations defined on statistics:
+ *     \li attachment of the calling process to a statistics block
+ *     \li registration of an observer of the blocked operations
+ *     \li querying whether the calling process records its operations
+ *     \li current time
+ *     \li recording of an operation.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#include "semStat.h"
+
+/** \brief statistics block of the process - NULL while it is not attached */
+static SEM_USAGE *stats = NULL;
+
+/** \brief number of entries of the statistics block */
+static unsigned int nStats = 0;
+
+/** \brief observer of the blocked operations of the process - NULL if there is none */
+static void (*waitObserver) (unsigned int sindex, uint64_t t0, uint64_t waitNs) = NULL;
+
+/**
+ *  \brief Attachment of the calling process to a statistics block.
+ *
+ *  \param stat statistics block, one entry per semaphore (entry 0 is not used)
+ *  \param snum number of entries
+ */
+void semStatAttach (SEM_USAGE stat[], unsigned int snum)
+{
+#ifdef SEM_STATS
+  nStats = snum;
+  stats = stat;
+#else
+  (void) stat;
+  (void) snum;
+#endif
+}
+
+/**
+ *  \brief Registration of an observer of the blocked operations of the calling process.
+ *
+ *  \param observer function called with the semaphore location, the start of the operation (ns, monotonic
+ *                  clock) and the time spent blocked (ns)
+ */
+void semStatObserve (void (*observer) (unsigned int sindex, uint64_t t0, uint64_t waitNs))
+{
+  waitObserver = observer;
+}
+
+/**
+ *  \brief Querying whether the calling process records its operations.
+ *
+ *  \return \c true, if it is attached to a statistics block or it registered an observer
+ */
+bool semStatOn (void)
+{
+  return (stats != NULL) || (waitObserver != NULL);
+}
+
+/**
+ *  \brief Current time, for the measurement of the time spent blocked.
+ *
+ *  \return time (ns, monotonic clock)
+ */
+uint64_t semStatClock (void)
+{
+  struct timespec now;
+
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  return (uint64_t) now.tv_sec * 1000000000 + (uint64_t) now.tv_nsec;
+}
+
+/**
+ *  \brief Recording of an operation.
+ *
+ *  \param sindex semaphore location in the set
+ *  \param n operation: n > 0 is an up, n < 0 is a down
+ *  \param blocked the down operation had to block
+ *  \param t0 start of the operation (ns, monotonic clock), if it had to block
+ *  \param waitNs time spent blocked (ns)
+ */
+void semStatRecord (unsigned int sindex, int n, bool blocked, uint64_t t0, uint64_t waitNs)
+{
+  SEM_USAGE *st;
+  uint64_t us;                                                                            /* time spent blocked (us) */
+  unsigned int b;                                                                                /* histogram bin */
+
+  if (blocked && (n < 0) && (waitObserver != NULL))
+     waitObserver (sindex, t0, waitNs);
+  if ((stats == NULL) || (sindex >= nStats))
+     return;
+  st = &stats[sindex];
+  if (n > 0)
+     { atomic_fetch_add_explicit (&st->ups, 1, memory_order_relaxed);
+       return;
+     }
+  atomic_fetch_add_explicit (&st->downs, 1, memory_order_relaxed);
+  if (!blocked)
+     return;
+  atomic_fetch_add_explicit (&st->blocked, 1, memory_order_relaxed);
+  atomic_fetch_add_explicit (&st->waitNs, waitNs, memory_order_relaxed);
+  for (b = 0, us = waitNs / 1000; (us > 0) && (b < SEMSTATBINS - 1); us >>= 1)
+    b++;
+  atomic_fetch_add_explicit (&st->hist[b], 1, memory_order_relaxed);
+}
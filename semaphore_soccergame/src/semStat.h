@@ -0,0 +1,103 @@
+/**
+ *  \file semStat.h (interface file)
+ *
+ *  \brief Semaphore usage statistics.
+ *
+ *  In an instrumented build (<tt>make STATS=1</tt>, which defines <tt>SEM_STATS</tt>), the semaphore backends
+ *  record every operation of the processes (or threads) that attached to a statistics block, one entry per
+ *  semaphore of the set. The block usually lives in shared memory: its counters are only updated with atomic
+ *  operations, so that no lock is needed, and it accumulates the operations of every process attached to it.
+ *
+ *  For each semaphore, the entry counts the <em>down</em> and <em>up</em> operations, the <em>down</em> operations
+ *  that had to block and the time spent blocked, whose distribution is kept in a log2 histogram.
+ *
+ *  Independently of the build, a process may also register an observer, that is told about every <em>down</em>
+ *  operation that had to block, when it started and for how long (see trace.h).
+ *
+ *  Operations defined on statistics:
+ *     \li attachment of the calling process to a statistics block
+ *     \li registration of an observer of the blocked operations
+ *     \li querying whether the calling process records its operations
+ *     \li current time
+ *     \li recording of an operation.
+ */
+
+#ifndef SEMSTAT_H_
+#define SEMSTAT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+/** \brief number of bins of the blocked time histogram: bin b counts the waits of less than 2^b us (bin 0, less
+           than 1 us) */
+#define  SEMSTATBINS    32
+
+/**
+ *  \brief Definition of <em>semaphore usage statistics</em> data type.
+ */
+typedef struct
+        { /** \brief number of <em>down</em> operations (a down by n counts once) */
+          atomic_ulong downs;
+          /** \brief number of those that blocked */
+          atomic_ulong blocked;
+          /** \brief number of <em>up</em> operations (an up by n counts once) */
+          atomic_ulong ups;
+          /** \brief total time spent blocked (ns) */
+          atomic_ulong waitNs;
+          /** \brief histogram of the time spent blocked */
+          atomic_ulong hist[SEMSTATBINS];
+        } SEM_USAGE;
+
+/**
+ *  \brief Attachment of the calling process to a statistics block.
+ *
+ *  From then on, the operations of the process on semaphores 1 .. snum-1 of its sets are recorded in the
+ *  block, provided that it was built with <tt>SEM_STATS</tt> defined.
+ *
+ *  \param stat statistics block, one entry per semaphore (entry 0 is not used)
+ *  \param snum number of entries
+ */
+
+extern void semStatAttach (SEM_USAGE stat[], unsigned int snum);
+
+/**
+ *  \brief Registration of an observer of the blocked operations of the calling process.
+ *
+ *  \param observer function called with the semaphore location, the start of the operation (ns, monotonic
+ *                  clock) and the time spent blocked (ns)
+ */
+
+extern void semStatObserve (void (*observer) (unsigned int sindex, uint64_t t0, uint64_t waitNs));
+
+/**
+ *  \brief Querying whether the calling process records its operations.
+ *
+ *  \return \c true, if it is attached to a statistics block or it registered an observer
+ */
+
+extern bool semStatOn (void);
+
+/**
+ *  \brief Current time, for the measurement of the time spent blocked.
+ *
+ *  \return time (ns, monotonic clock)
+ */
+
+extern uint64_t semStatClock (void);
+
+/**
+ *  \brief Recording of an operation.
+ *
+ *  Operations on semaphores beyond the statistics block are not recorded in it.
+ *
+ *  \param sindex semaphore location in the set
+ *  \param n operation: n > 0 is an up, n < 0 is a down
+ *  \param blocked the down operation had to block
+ *  \param t0 start of the operation (ns, monotonic clock), if it had to block
+ *  \param waitNs time spent blocked (ns)
+ */
+
+extern void semStatRecord (unsigned int sindex, int n, bool blocked, uint64_t t0, uint64_t waitNs);
+
+#endif /* SEMSTAT_H_ */
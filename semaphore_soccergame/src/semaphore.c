@@ -8,21 +8,78 @@
  *     \li connection to a previously created set of semaphores
  *     \li destruction of a previously created set of semaphores
  *     \li signalling start of operations
+ *     \li resetting of a set of semaphores
  *     \li <em>down</em> of a semaphore within the set
- *     \li <em>up</em> of a semaphore within the set.
+ *     \li <em>up</em> of a semaphore within the set
+ *     \li <em>down</em> of a semaphore within the set, with a bound on the time spent blocked
+ *     \li <em>down</em> by n of a semaphore within the set
+ *     \li <em>up</em> by n of a semaphore within the set
+ *     \li value of a semaphore within the set.
  *
  *  \author António Rui Borges - October 1995
  */
 
+#define _GNU_SOURCE                                                             /* semtimedop */
+
 #include <stdio.h>
+#include <time.h>
 #include <sys/types.h>
 #include <sys/ipc.h>
 #include <sys/sem.h>
 #include <assert.h>
+#include <limits.h>
+#include <errno.h>
+#include <stdint.h>
+
+#include "semaphore.h"
+#include "semStat.h"
 
 /** \brief access permission: user r-w */
 #define  MASK           0600
 
+/** \brief number of operations carried out by the calling thread */
+_Thread_local unsigned long semOpCount = 0;
+
+/**
+ *  \brief Operations on semaphores within the set, recorded in the statistics block (or told to its observer).
+ *
+ *  The operations are first tried without blocking, so that those that must block are told apart, and timed.
+ *
+ *  \param semgid set identifier
+ *  \param sops SysV operations
+ *  \param nops number of operations
+ *  \param timeout bound on the time spent blocked - NULL if there is none
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+static int statOp (int semgid, struct sembuf sops[], unsigned int nops, const struct timespec *timeout)
+{
+  bool blocked = false;                                                           /* the operations had to block */
+  uint64_t t0 = 0, waitNs = 0;                                                                  /* time spent blocked */
+  unsigned int i;
+  int ret;
+
+  for (i = 0; i < nops; i++)
+    sops[i].sem_flg |= IPC_NOWAIT;
+  if (((ret = semop (semgid, sops, nops)) == -1) && (errno == EAGAIN))
+     { for (i = 0; i < nops; i++)
+         sops[i].sem_flg &= ~IPC_NOWAIT;
+       blocked = true;
+       t0 = semStatClock ();
+       ret = semtimedop (semgid, sops, nops, timeout);
+       waitNs = semStatClock () - t0;
+     }
+  if (ret == 0)
+     for (i = 0; i < nops; i++)
+       semStatRecord (sops[i].sem_num, sops[i].sem_op, blocked, t0, waitNs);
+  return ret;
+}
+
+/** \brief operations are carried out through statOp when the process records them; a null timeout never expires */
+#define  SEMOP(semgid,sops,nops,timeout)  (semStatOn () ? statOp ((semgid), (sops), (nops), (timeout)) \
+                                                     : semtimedop ((semgid), (sops), (nops), (timeout)))
+
 /**
  *  \brief Creation of a set of semaphores.
  *
@@ -94,6 +151,34 @@ int semSignal (int semgid)
   return semop (semgid, &up, 1);
 }
 
+/**
+ *  \brief Resetting of a set of semaphores.
+ *
+ *  All semaphores in the set, except the start of operations one, are set to <em>red state</em>, so that the set
+ *  may be reused for a new simulation. Must only be called when no process is using the set.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+int semReset (int semgid)
+{
+  struct semid_ds ds;                                                                    /* semaphore set status */
+  union semun { int val; struct semid_ds *buf; unsigned short *array; } arg;        /* must be defined by the caller */
+  unsigned short s;
+
+  arg.buf = &ds;
+  if (semctl (semgid, 0, IPC_STAT, arg) == -1)
+     return -1;
+  arg.val = 0;
+  for (s = 1; s < ds.sem_nsems; s++)
+    if (semctl (semgid, s, SETVAL, arg) == -1)
+       return -1;
+  return 0;
+}
+
 /**
  *  \brief <em>Down</em> of a semaphore within the set.
  *
@@ -109,9 +194,10 @@ int semDown (int semgid, unsigned int sindex)
 {
   struct sembuf down = { 0, -1, 0 };  /* specific down operation */
 
+  semOpCount++;
   assert(sindex>0);
   down.sem_num = (unsigned short) sindex;
-  return semop (semgid, &down, 1);
+  return SEMOP (semgid, &down, 1, NULL);
 }
 
 /**
@@ -129,7 +215,98 @@ int semUp (int semgid, unsigned int sindex)
 {
   struct sembuf up = { 0, 1, 0 };                                                           /* specific up operation */
 
+  semOpCount++;
   assert(sindex>0);
   up.sem_num = (unsigned short) sindex;
-  return semop (semgid, &up, 1);
+  return SEMOP (semgid, &up, 1, NULL);
+}
+
+/**
+ *  \brief <em>Down</em> of a semaphore within the set, with a bound on the time spent blocked.
+ *
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>, and with
+ *  <tt>errno</tt> set to <tt>EAGAIN</tt> if the semaphore is still red when the bound expires.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *  \param ms bound on the time spent blocked (ms)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+int semDownTimed (int semgid, unsigned int sindex, unsigned int ms)
+{
+  struct sembuf down = { 0, -1, 0 };                                                    /* specific down operation */
+  struct timespec timeout = { ms / 1000, (long) (ms % 1000) * 1000000 };                    /* bound on the wait */
+
+  semOpCount++;
+  assert(sindex>0);
+  down.sem_num = (unsigned short) sindex;
+  return SEMOP (semgid, &down, 1, &timeout);
+}
+
+/**
+ *  \brief <em>Down</em> by n of a semaphore within the set.
+ *
+ *  The caller blocks until the semaphore value is at least <tt>n</tt>, which is then subtracted at once.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *  \param n decrement (>= 1)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+int semDownN (int semgid, unsigned int sindex, unsigned int n)
+{
+  struct sembuf down = { 0, 0, 0 };                                                       /* specific down operation */
+
+  semOpCount++;
+  assert((sindex>0) && (n>0) && (n<=SHRT_MAX));
+  down.sem_num = (unsigned short) sindex;
+  down.sem_op = (short) -n;
+  return SEMOP (semgid, &down, 1, NULL);
+}
+
+/**
+ *  \brief <em>Up</em> by n of a semaphore within the set.
+ *
+ *  Equivalent to <tt>n</tt> <em>up</em> operations, in a single call.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *  \param n increment (>= 1)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+int semUpN (int semgid, unsigned int sindex, unsigned int n)
+{
+  struct sembuf up = { 0, 0, 0 };                                                           /* specific up operation */
+
+  semOpCount++;
+  assert((sindex>0) && (n>0) && (n<=SHRT_MAX));
+  up.sem_num = (unsigned short) sindex;
+  up.sem_op = (short) n;
+  return SEMOP (semgid, &up, 1, NULL);
+}
+
+/**
+ *  \brief Value of a semaphore within the set.
+ *
+ *  The value may change at any time, unless no process is using the set: it is meant for diagnostics.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *
+ *  \return semaphore value, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+int semValue (int semgid, unsigned int sindex)
+{
+  assert(sindex>0);
+  return semctl (semgid, (int) sindex, GETVAL);
 }
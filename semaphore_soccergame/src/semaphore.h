@@ -8,8 +8,13 @@
  *     \li connection to a previously created set of semaphores
  *     \li destruction of a previously created set of semaphores
  *     \li signalling start of operations
+ *     \li resetting of a set of semaphores
  *     \li <em>down</em> of a semaphore within the set
- *     \li <em>up</em> of a semaphore within the set.
+ *     \li <em>up</em> of a semaphore within the set
+ *     \li <em>down</em> of a semaphore within the set, with a bound on the time spent blocked
+ *     \li <em>down</em> by n of a semaphore within the set
+ *     \li <em>up</em> by n of a semaphore within the set
+ *     \li value of a semaphore within the set.
  *
  *  \author António Rui Borges - October 1995
  */
@@ -71,6 +76,30 @@ extern int semDestroy (int semgid);
 
 extern int semSignal (int semgid);
 
+/**
+ *  \brief Resetting of a set of semaphores.
+ *
+ *  All semaphores in the set, except the start of operations one, are set to <em>red state</em>, so that the set
+ *  may be reused for a new simulation. Must only be called when no process is using the set.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int semReset (int semgid);
+
+/**
+ *  \brief Number of operations carried out by the calling thread.
+ *
+ *  Counts the calls of <em>down</em>, <em>up</em> and group operations, whatever the backend, so that the
+ *  intervening entities can report the synchronization cost of a match.
+ */
+
+extern _Thread_local unsigned long semOpCount;
+
 /**
  *  \brief <em>Down</em> of a semaphore within the set.
  *
@@ -99,4 +128,67 @@ extern int semDown (int semgid, unsigned int sindex);
 
 extern int semUp (int semgid, unsigned int sindex);
 
+/**
+ *  \brief <em>Down</em> of a semaphore within the set, with a bound on the time spent blocked.
+ *
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>, and with
+ *  <tt>errno</tt> set to <tt>EAGAIN</tt> if the semaphore is still red when the bound expires.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *  \param ms bound on the time spent blocked (ms)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int semDownTimed (int semgid, unsigned int sindex, unsigned int ms);
+
+/**
+ *  \brief <em>Down</em> by n of a semaphore within the set.
+ *
+ *  The caller blocks until the semaphore value is at least <tt>n</tt>, which is then subtracted at once.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *  \param n decrement (>= 1)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int semDownN (int semgid, unsigned int sindex, unsigned int n);
+
+/**
+ *  \brief <em>Up</em> by n of a semaphore within the set.
+ *
+ *  Equivalent to <tt>n</tt> <em>up</em> operations, in a single call.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *  \param n increment (>= 1)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int semUpN (int semgid, unsigned int sindex, unsigned int n);
+
+/**
+ *  \brief Value of a semaphore within the set.
+ *
+ *  The value may change at any time, unless no process is using the set: it is meant for diagnostics.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *
+ *  \return semaphore value, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int semValue (int semgid, unsigned int sindex);
+
 #endif /* SEMAPHORE_H_ */
@@ -0,0 +1,572 @@
+/**
+ *  \file semaphoreFutex.c (implementation file)
+ *
+ *  \brief Semaphore management.
+ *
+ *  Alternative implementation of the interface in semaphore.h, selected at build time with <tt>make SEM=futex</tt>.
+ *  The semaphore values are kept as atomic counters in a POSIX shared memory block associated to the creation key,
+ *  so that <em>down</em> and <em>up</em> operations only enter the kernel (futex wait/wake) when a process must
+ *  block or a blocked process must be woken up.
+ *
+ *  When built with <tt>SOCCER_THREADS</tt> defined, the sets are process-private instead: they are allocated in
+ *  the heap, connection looks the key up in the local table and the futex operations are private ones, which
+ *  spares the kernel the shared mapping lookup. Only threads of the creating process may use them. The operations
+ *  of the threads scheduled in virtual time are then carried out by the scheduler (see vclock.h).
+ *
+ *  Operations defined on semaphores:
+ *     \li creation of a set of semaphores
+ *     \li connection to a previously created set of semaphores
+ *     \li destruction of a previously created set of semaphores
+ *     \li signalling start of operations
+ *     \li resetting of a set of semaphores
+ *     \li <em>down</em> of a semaphore within the set
+ *     \li <em>up</em> of a semaphore within the set
+ *     \li <em>down</em> of a semaphore within the set, with a bound on the time spent blocked
+ *     \li <em>down</em> by n of a semaphore within the set
+ *     \li <em>up</em> by n of a semaphore within the set
+ *     \li value of a semaphore within the set.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <assert.h>
+#include <limits.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "semaphore.h"
+#include "semStat.h"
+#include "vclock.h"
+#include "cacheLine.h"
+
+/** \brief access permission: user r-w */
+#define  MASK           0600
+
+/** \brief maximum number of semaphore sets a process may be connected to */
+#define  MAXSETS        8
+
+/**
+ *  \brief Definition of <em>semaphore</em> data type.
+ */
+typedef struct
+        { /** \brief semaphore value (each semaphore takes a cache line of its own in the padded layout) */
+          LINEALIGNED atomic_int val;
+          /** \brief number of processes blocked (or about to block) on the semaphore */
+          atomic_int waiters;
+          /** \brief number of those processes waiting for a decrement larger than 1 */
+          atomic_int bigWaiters;
+        } SEM;
+
+/**
+ *  \brief Definition of <em>semaphore set</em> data type, as stored in shared memory.
+ */
+typedef struct
+        { /** \brief number of semaphores in the set, including the start of operations one */
+          unsigned int snum;
+          /** \brief semaphores - index 0 signals start of operations */
+          SEM sem[];
+        } SEMSET;
+
+/** \brief semaphore sets the process is connected to */
+static struct
+        { /** \brief local address of the set - NULL if the entry is free */
+          SEMSET *set;
+          /** \brief size of the mapping */
+          size_t size;
+          /** \brief creation key */
+          int key;
+        } sets[MAXSETS];
+
+/** \brief number of operations carried out by the calling thread */
+_Thread_local unsigned long semOpCount = 0;
+
+#ifndef SOCCER_THREADS
+/** \brief name of the shared memory block associated to a creation key */
+static void setName (char name[], int key)
+{
+  sprintf (name, "/soccergame.sem.%x", (unsigned int) key);
+}
+#endif
+
+/** \brief semaphore set associated to an identifier */
+static SEMSET *getSet (int semgid)
+{
+  if ((semgid < 0) || (semgid >= MAXSETS) || (sets[semgid].set == NULL))
+     { errno = EINVAL;
+       return NULL;
+     }
+  return sets[semgid].set;
+}
+
+/** \brief free entry of the local table */
+static int freeEntry (void)
+{
+  int semgid;                                                                            /* semaphore set identifier */
+
+  for (semgid = 0; semgid < MAXSETS; semgid++)
+    if (sets[semgid].set == NULL) return semgid;
+  errno = EMFILE;
+  return -1;
+}
+
+#ifndef SOCCER_THREADS
+
+/** \brief mapping of a semaphore set and registration in the local table */
+static int mapSet (int fd, size_t size, int key)
+{
+  int semgid;                                                                            /* semaphore set identifier */
+  void *add;                                                                                    /* temporary pointer */
+
+  if ((semgid = freeEntry ()) == -1)
+     return -1;
+  if ((add = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED)
+     return -1;
+  sets[semgid].set = (SEMSET *) add;
+  sets[semgid].size = size;
+  sets[semgid].key = key;
+  return semgid;
+}
+
+/** \brief futex operation codes */
+#define  FUTEXWAIT      FUTEX_WAIT
+#define  FUTEXWAKE      FUTEX_WAKE
+
+#else
+
+/** \brief futex operation codes: the sets are never shared with other processes */
+#define  FUTEXWAIT      FUTEX_WAIT_PRIVATE
+#define  FUTEXWAKE      FUTEX_WAKE_PRIVATE
+
+#endif
+
+static int futexWait (atomic_int *addr, int val, const struct timespec *timeout)
+{
+  return (int) syscall (SYS_futex, addr, FUTEXWAIT, val, timeout, NULL, 0);
+}
+
+static int futexWake (atomic_int *addr, int n)
+{
+  return (int) syscall (SYS_futex, addr, FUTEXWAKE, n, NULL, NULL, 0);
+}
+
+/** \brief non-blocking decrement by n of a semaphore: true if it succeeded, otherwise the observed value is kept */
+static bool tryDown (SEM *s, int n, int *p_v)
+{
+  *p_v = atomic_load (&s->val);
+  while (*p_v >= n)
+    if (atomic_compare_exchange_weak (&s->val, p_v, *p_v - n)) return true;
+  return false;
+}
+
+/** \brief time left until an absolute deadline of the monotonic clock: false if it has already expired */
+static bool timeLeft (const struct timespec *deadline, struct timespec *left)
+{
+  struct timespec now;
+
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  left->tv_sec = deadline->tv_sec - now.tv_sec;
+  left->tv_nsec = deadline->tv_nsec - now.tv_nsec;
+  if (left->tv_nsec < 0)
+     { left->tv_sec--;
+       left->tv_nsec += 1000000000;
+     }
+  return (left->tv_sec > 0) || ((left->tv_sec == 0) && (left->tv_nsec > 0));
+}
+
+/** \brief blocking decrement by n of a semaphore, that fails with EAGAIN at the deadline, if there is one */
+static int down (SEM *s, int n, const struct timespec *deadline)
+{
+  int v;                                                                                         /* observed value */
+  int ret;                                                                                     /* futex wait status */
+  struct timespec left;                                                              /* time left until the deadline */
+
+#ifdef SOCCER_THREADS
+  if (vclockOn ())
+     return vclockDown (&s->val, n);
+#endif
+  while (1)
+  { if (tryDown (s, n, &v)) return 0;                                          /* fast path: no kernel entry */
+    if ((deadline != NULL) && !timeLeft (deadline, &left))
+       { errno = EAGAIN;
+         return -1;
+       }
+    atomic_fetch_add (&s->waiters, 1);
+    if (n > 1) atomic_fetch_add (&s->bigWaiters, 1);
+    ret = futexWait (&s->val, v, (deadline != NULL) ? &left : NULL);  /* sleeps only if the value is still v */
+    if (n > 1) atomic_fetch_sub (&s->bigWaiters, 1);
+    atomic_fetch_sub (&s->waiters, 1);
+    if ((ret == -1) && (errno != EAGAIN) && (errno != EINTR) && (errno != ETIMEDOUT))
+       return -1;
+  }
+}
+
+/** \brief increment by n of a semaphore, waking up blocked processes if there are any */
+static int up (SEM *s, int n)
+{
+#ifdef SOCCER_THREADS
+  if (vclockOn ())
+     return vclockUp (&s->val, n);
+#endif
+  atomic_fetch_add (&s->val, n);
+  if (atomic_load (&s->waiters) > 0)
+     { /* a waiter for a large decrement may not be able to use the increment: wake everybody to re-check */
+       if (futexWake (&s->val, (atomic_load (&s->bigWaiters) > 0) ? INT_MAX : n) == -1)
+          return -1;
+     }
+  return 0;
+}
+
+/** \brief blocking decrement by n of a semaphore, recorded in the statistics block with the time spent blocked */
+static int statDown (SEM *s, unsigned int sindex, int n, const struct timespec *deadline)
+{
+  uint64_t t0;
+  int v, ret;
+
+  if (tryDown (s, n, &v))
+     { semStatRecord (sindex, -n, false, 0, 0);
+       return 0;
+     }
+  t0 = semStatClock ();
+  if ((ret = down (s, n, deadline)) == 0)
+     semStatRecord (sindex, -n, true, t0, semStatClock () - t0);
+  return ret;
+}
+
+/** \brief increment by n of a semaphore, recorded in the statistics block */
+static int statUp (SEM *s, unsigned int sindex, int n)
+{
+  semStatRecord (sindex, n, false, 0, 0);
+  return up (s, n);
+}
+
+/** \brief operations are carried out through statDown and statUp when the process records them */
+#define  DOWN(set,sindex,n,deadline)  (semStatOn () ? statDown (&(set)->sem[(sindex)], (sindex), (n), (deadline)) \
+                                                    : down (&(set)->sem[(sindex)], (n), (deadline)))
+#define  UP(set,sindex,n)    (semStatOn () ? statUp (&(set)->sem[(sindex)], (sindex), (n)) \
+                                           : up (&(set)->sem[(sindex)], (n)))
+
+/**
+ *  \brief Creation of a set of semaphores.
+ *
+ *  All semaphores in the set will be in set to <em>red state</em> upon creation.
+ *  The function fails if there is already a semaphore set with a creation key equal to <tt>key</tt>.
+ *
+ *  \param key creation key
+ *  \param snum number of semaphores in the set (>= 1)
+ *
+ *  \return set identifier, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+int semCreate (int key, unsigned int snum)
+{
+  size_t size = sizeof (SEMSET) + (snum + 1) * sizeof (SEM);                                  /* shared block size */
+  int semgid;
+#ifndef SOCCER_THREADS
+  char name[64];                                                                          /* shared memory block name */
+  int fd;
+
+  setName (name, key);
+  if ((fd = shm_open (name, O_RDWR | O_CREAT | O_EXCL, MASK)) == -1)
+     return -1;
+  if ((ftruncate (fd, (off_t) size) == -1) || ((semgid = mapSet (fd, size, key)) == -1))
+     { close (fd);
+       shm_unlink (name);
+       return -1;
+     }
+  close (fd);
+#else
+  int i;
+
+  for (i = 0; i < MAXSETS; i++)
+    if ((sets[i].set != NULL) && (sets[i].key == key))
+       { errno = EEXIST;
+         return -1;
+       }
+  if ((semgid = freeEntry ()) == -1)
+     return -1;
+  if ((sets[semgid].set = (SEMSET *) calloc (1, size)) == NULL)
+     return -1;
+  sets[semgid].size = size;
+  sets[semgid].key = key;
+#endif
+  sets[semgid].set->snum = snum + 1;                           /* block is zero filled: all semaphores are red */
+  return semgid;
+}
+
+/**
+ *  \brief Connection to a previously created set of semaphores.
+ *
+ *  The function fails if there is no semaphore set with a creation key equal to <tt>key</tt>.
+ *
+ *  \param key creation key
+ *
+ *  \return set identifier, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+int semConnect (int key)
+{
+  int semgid;                                                                            /* semaphore set identifier */
+#ifndef SOCCER_THREADS
+  char name[64];                                                                          /* shared memory block name */
+  struct stat st;                                                                          /* shared block status */
+  int fd;
+
+  setName (name, key);
+  if ((fd = shm_open (name, O_RDWR, MASK)) == -1)
+     return -1;
+  if ((fstat (fd, &st) == -1) || ((semgid = mapSet (fd, (size_t) st.st_size, key)) == -1))
+     { close (fd);
+       return -1;
+     }
+  close (fd);
+#else
+  for (semgid = 0; semgid < MAXSETS; semgid++)
+    if ((sets[semgid].set != NULL) && (sets[semgid].key == key)) break;
+  if (semgid == MAXSETS)
+     { errno = ENOENT;
+       return -1;
+     }
+#endif
+  if ((down (&sets[semgid].set->sem[0], 1, NULL) == -1) || (up (&sets[semgid].set->sem[0], 1) == -1))
+     return -1;                                                       /* wait for the start of operations */
+  return semgid;
+}
+
+/**
+ *  \brief Destruction of a previously created set of semaphores.
+ *
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+int semDestroy (int semgid)
+{
+#ifndef SOCCER_THREADS
+  char name[64];                                                                          /* shared memory block name */
+
+  if (getSet (semgid) == NULL)
+     return -1;
+  setName (name, sets[semgid].key);
+  munmap (sets[semgid].set, sets[semgid].size);
+  sets[semgid].set = NULL;
+  return shm_unlink (name);
+#else
+  if (getSet (semgid) == NULL)
+     return -1;
+  free (sets[semgid].set);
+  sets[semgid].set = NULL;
+  return 0;
+#endif
+}
+
+/**
+ *  \brief Signalling start of operations upon initialization of shared data structures.
+ *
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+int semSignal (int semgid)
+{
+  SEMSET *set;                                                                                 /* semaphore set */
+
+  if ((set = getSet (semgid)) == NULL)
+     return -1;
+  return up (&set->sem[0], 1);
+}
+
+/**
+ *  \brief Resetting of a set of semaphores.
+ *
+ *  All semaphores in the set, except the start of operations one, are set to <em>red state</em>, so that the set
+ *  may be reused for a new simulation. Must only be called when no process is using the set.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+int semReset (int semgid)
+{
+  SEMSET *set;                                                                                 /* semaphore set */
+  unsigned int s;
+
+  if ((set = getSet (semgid)) == NULL)
+     return -1;
+  for (s = 1; s < set->snum; s++)
+  { atomic_store (&set->sem[s].val, 0);
+    atomic_store (&set->sem[s].waiters, 0);                   /* processes killed while blocked are not counted */
+    atomic_store (&set->sem[s].bigWaiters, 0);
+  }
+  return 0;
+}
+
+/**
+ *  \brief <em>Down</em> of a semaphore within the set.
+ *
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+int semDown (int semgid, unsigned int sindex)
+{
+  SEMSET *set;                                                                                 /* semaphore set */
+
+  semOpCount++;
+  assert(sindex>0);
+  if ((set = getSet (semgid)) == NULL)
+     return -1;
+  assert(sindex<set->snum);
+  return DOWN (set, sindex, 1, NULL);
+}
+
+/**
+ *  \brief <em>Up</em> of a semaphore within the set.
+ *
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+int semUp (int semgid, unsigned int sindex)
+{
+  SEMSET *set;                                                                                 /* semaphore set */
+
+  semOpCount++;
+  assert(sindex>0);
+  if ((set = getSet (semgid)) == NULL)
+     return -1;
+  assert(sindex<set->snum);
+  return UP (set, sindex, 1);
+}
+
+/**
+ *  \brief <em>Down</em> of a semaphore within the set, with a bound on the time spent blocked.
+ *
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>, and with
+ *  <tt>errno</tt> set to <tt>EAGAIN</tt> if the semaphore is still red when the bound expires.
+ *  The operations of the threads scheduled in virtual time are not bounded.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *  \param ms bound on the time spent blocked (ms)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+int semDownTimed (int semgid, unsigned int sindex, unsigned int ms)
+{
+  SEMSET *set;                                                                                 /* semaphore set */
+  struct timespec deadline;                                                    /* end of the bound, monotonic clock */
+
+  semOpCount++;
+  assert(sindex>0);
+  if ((set = getSet (semgid)) == NULL)
+     return -1;
+  assert(sindex<set->snum);
+  clock_gettime (CLOCK_MONOTONIC, &deadline);
+  deadline.tv_sec += ms / 1000;
+  deadline.tv_nsec += (long) (ms % 1000) * 1000000;
+  if (deadline.tv_nsec >= 1000000000)
+     { deadline.tv_sec++;
+       deadline.tv_nsec -= 1000000000;
+     }
+  return DOWN (set, sindex, 1, &deadline);
+}
+
+/**
+ *  \brief <em>Down</em> by n of a semaphore within the set.
+ *
+ *  The caller blocks until the semaphore value is at least <tt>n</tt>, which is then subtracted at once.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *  \param n decrement (>= 1)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+int semDownN (int semgid, unsigned int sindex, unsigned int n)
+{
+  SEMSET *set;                                                                                 /* semaphore set */
+
+  semOpCount++;
+  assert((sindex>0) && (n>0) && (n<=INT_MAX));
+  if ((set = getSet (semgid)) == NULL)
+     return -1;
+  assert(sindex<set->snum);
+  return DOWN (set, sindex, (int) n, NULL);
+}
+
+/**
+ *  \brief <em>Up</em> by n of a semaphore within the set.
+ *
+ *  Equivalent to <tt>n</tt> <em>up</em> operations, in a single call.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *  \param n increment (>= 1)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+int semUpN (int semgid, unsigned int sindex, unsigned int n)
+{
+  SEMSET *set;                                                                                 /* semaphore set */
+
+  semOpCount++;
+  assert((sindex>0) && (n>0) && (n<=INT_MAX));
+  if ((set = getSet (semgid)) == NULL)
+     return -1;
+  assert(sindex<set->snum);
+  return UP (set, sindex, (int) n);
+}
+
+/**
+ *  \brief Value of a semaphore within the set.
+ *
+ *  The value may change at any time, unless no process is using the set: it is meant for diagnostics.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *
+ *  \return semaphore value, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+int semValue (int semgid, unsigned int sindex)
+{
+  SEMSET *set;                                                                                 /* semaphore set */
+
+  assert(sindex>0);
+  if ((set = getSet (semgid)) == NULL)
+     return -1;
+  assert(sindex<set->snum);
+  return atomic_load (&set->sem[sindex].val);
+}
@@ -17,46 +17,300 @@
 #ifndef SHAREDDATASYNC_H_
 #define SHAREDDATASYNC_H_
 
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/prctl.h>
+
 #include "probConst.h"
 #include "probDataStruct.h"
+#include "barrier.h"
+#include "cacheLine.h"
+#include "semStat.h"
+#include "waitWord.h"
 
 /**
- *  \brief Definition of <em>shared information</em> data type.
+ *  \brief Definition of <em>pitch</em> data type.
+ *
+ *  Each referee takes the teams of one match to a pitch of its own. The match is then synchronized on the
+ *  semaphores and barriers of that pitch only, so that matches on different pitches never contend with each other,
+ *  nor with team formation, on the critical region of the shared region.
  */
 typedef struct
-        { /** \brief full state of the problem */
-          FULL_STAT fSt;
-
-          /* semaphores ids */
-          /** \brief identification of critical region protection semaphore – val = 1 */
-          unsigned int mutex;
-          /** \brief identification of semaphore used by players to wait for forming team teammate - val = 0 */
-          unsigned int playersWaitTeam;
-          /** \brief identification of semaphore used by goalies to wait for forming team teammate - val = 0 */
-          unsigned int goaliesWaitTeam;
+        { /** \brief identification of the pitch critical region protection semaphore – val = 1 */
+          LINEALIGNED unsigned int mutex;
           /** \brief identification of semaphore used by players and goalies to wait for the match to start - val = 0 */
           unsigned int playersWaitReferee;
           /** \brief identification of semaphore used by players and goalies to wait for the match to end - val = 0 */
           unsigned int playersWaitEnd;
-          /** \brief identification of semaphore used by referee to wait for teams to be formed – val = 0  */
-          unsigned int refereeWaitTeams;
-          /** \brief identification of semaphore used by players and goalies to acknowledge team registration – val = 0  */
-          unsigned int playerRegistered;
           /** \brief identification of semaphore used by referee to wait for players and goalies to start – val = 0  */
           unsigned int playing;
+          /** \brief identification of semaphore used by the referee of the pitch to wait for the teams of its match
+                      to be formed – val = 0 */
+          unsigned int teamsFormed;
+
+          /** \brief match start: players and goalies are released on playersWaitReferee, the last to play
+                      notifies playing */
+          BARRIER start;
+          /** \brief match end: players and goalies are released on playersWaitEnd */
+          BARRIER end;
+
+          /** \brief id of the referee of the match - -1 while the pitch is free */
+          LINEALIGNED atomic_int referee;
+
+          /* timing of the match (ns, monotonic clock), reported by the benchmark */
+          /** \brief the teams of the match are formed */
+          uint64_t tTeams;
+          /** \brief the referee releases the players and goalies to start the match */
+          uint64_t tStart;
+          /** \brief every player and goalie is playing */
+          uint64_t tPlaying;
+          /** \brief the referee releases the players and goalies to end the match */
+          uint64_t tEnd;
+          /** \brief the last player or goalie leaves the match */
+          LINEALIGNED atomic_uint_least64_t tLeft;
+
+        } PITCH;
+
+/** \brief phases of a match timed by the monitoring page: latency of the match, team formation, start handshake and
+           end release (see <tt>saveMetrics</tt> of the generator) */
+#define  PHASE_MATCH    0
+#define  PHASE_TEAMS    1
+#define  PHASE_START    2
+#define  PHASE_END      3
+#define  NPHASES        4
+
+/**
+ *  \brief Definition of <em>phase latency</em> data type.
+ */
+typedef struct
+        { /** \brief number of matches timed */
+          atomic_ulong n;
+          /** \brief total latency (ns) */
+          atomic_ulong sumNs;
+          /** \brief histogram of the latency: bin b counts the latencies of less than 2^b us (see semStat.h) */
+          atomic_ulong hist[SEMSTATBINS];
+        } PHASE_STAT;
+
+/**
+ *  \brief Definition of <em>monitoring page</em> data type.
+ *
+ *  Counters of the whole batch, updated by the generator at the end of every run and watched by
+ *  <tt>soccertop</tt>, which attaches read-only to the shared region; the counters of the run under way are taken
+ *  by the monitor from the state of the entities.
+ */
+typedef struct
+        { /** \brief number of runs of the batch */
+          unsigned int runs;
+          /** \brief the semaphore statistics are recorded (instrumented build) */
+          bool semStats;
+          /** \brief number of runs that were completed */
+          atomic_uint runsDone;
+          /** \brief number of runs that stalled */
+          atomic_uint stalls;
+          /** \brief number of matches completed */
+          atomic_ulong matches;
+          /** \brief number of teams formed */
+          atomic_ulong teams;
+          /** \brief number of late arrivals of players and goalies */
+          atomic_ulong late;
+          /** \brief latency of the phases of the matches completed */
+          PHASE_STAT phase[NPHASES];
+        } MONITOR;
+
+/**
+ *  \brief Definition of <em>shared information</em> data type.
+ *
+ *  Its size depends on the population, that is set by the generator when the region is created. The state of
+ *  the intervening entities ends the fixed part and is followed by the variable size arrays, which are located
+ *  by their offsets from the start of the region:
+ *     \li queue of the players waiting for a team (<tt>nPlayers</tt> entries)
+ *     \li queue of the goalies waiting for a team (<tt>nGoalies</tt> entries)
+ *     \li wait words of the players and of the goalies (<tt>nPlayers + nGoalies</tt> entries)
+ *     \li team registration barriers (<tt>nReferees * nTeams</tt> entries)
+ *     \li pitches (<tt>nReferees</tt> entries)
+ *     \li semaphore statistics (<tt>SEM_NU (nReferees) + 1</tt> entries, one per semaphore of the set)
+ *     \li state of the intervening entities when the log was created.
+ *
+ *  Teams are formed in order and the teams of each match are consecutive: team <tt>t</tt> plays on pitch
+ *  <tt>(t - 1) / nTeams</tt>. The critical region of the shared region protects arrival and team formation; the
+ *  state of the entities of a match is only changed inside the critical region of its pitch.
+ *
+ *  The players and goalies that arrive on time and can not form a team join the queue of their kind, in the order
+ *  of arrival, and block on their own wait word. The forming teammate takes the team members off the front of the
+ *  queues and hands the team id to each one through its wait word, so that the first to arrive are the first to
+ *  play and waking a team member costs no more, whatever the population. Each entity joins its queue at most once
+ *  per match, so that the queues never wrap.
+ *
+ *  In the padded layout (see cacheLine.h) the semaphore ids and the offsets, that are read-mostly, the logging
+ *  control counters, the timing counters, the monitoring page, every barrier, every wait word and every pitch
+ *  start cache lines of their own.
+ */
+typedef struct
+        { /* semaphores ids */
+          /** \brief identification of critical region protection semaphore – val = 1 */
+          unsigned int mutex;
+          /** \brief identification of the semaphores used by the entities of a tournament to wait for the next
+                      round, in turns: an entity that is soon done with round r waits on the semaphore of round r + 1,
+                      so that it can not take the place of one that has not yet started round r - val = 0 */
+          unsigned int roundStart[2];
+          /** \brief identification of semaphore used by the generator to wait for the end of a round of a
+                      tournament - val = 0 */
+          unsigned int roundEnd;
+
+          /** \brief logging control */
+          LOG_CTL logCtl;
+
+          /** \brief generator process, that owns the region: the processes attached to it do not outlive it */
+          pid_t owner;
+          /** \brief the matches of the batch are the rounds of a tournament, played by the same entities */
+          bool tournament;
+          /** \brief the tournament is over: the entities released for the next round terminate */
+          atomic_bool over;
+          /** \brief round of the tournament (the run of the batch, from 1) */
+          unsigned int round;
+
+          /** \brief the first player or goalie arrives (ns, monotonic clock) */
+          LINEALIGNED atomic_uint_least64_t tArrive;
+          /** \brief semaphore operations of the match, added by each intervening entity when it terminates */
+          LINEALIGNED atomic_ulong semOps;
+
+          /** \brief monitoring page, kept for the whole batch */
+          LINEALIGNED MONITOR mon;
+
+          /* variable size arrays */
+          /** \brief offset of the queue of the ids of the players waiting for a team */
+          LINEALIGNED size_t playerQueueOff;
+          /** \brief offset of the queue of the ids of the goalies waiting for a team */
+          size_t goalieQueueOff;
+          /** \brief offset of the wait words, one per player and per goalie, where they wait for the team id handed
+                      by the forming teammate */
+          size_t wordOff;
+          /** \brief offset of the team registration barriers, one per team: the last to register notifies
+                      teamsFormed of the pitch of the team */
+          size_t teamOff;
+          /** \brief offset of the pitches, one per referee */
+          size_t pitchOff;
+          /** \brief offset of the delays of the intervening entities, drawn by the generator from their random
+                      streams */
+          size_t delayOff;
+          /** \brief offset of the semaphore statistics, one per semaphore of the set, updated by the processes
+                      of an instrumented build */
+          size_t semStatOff;
+
+          /** \brief full state of the problem - variable size, must be the last field */
+          FULL_STAT fSt;
 
         } SHARED_DATA;
 
-/** \brief number of semaphores in the set */
-#define SEM_NU                   8 
+/** \brief queue of the players waiting for a team, in the shared region pointed by <tt>p_sh</tt> */
+#define PLAYERQUEUE(p_sh)       ((int *) ((char *) (p_sh) + (p_sh)->playerQueueOff))
+
+/** \brief queue of the goalies waiting for a team, in the shared region pointed by <tt>p_sh</tt> */
+#define GOALIEQUEUE(p_sh)       ((int *) ((char *) (p_sh) + (p_sh)->goalieQueueOff))
+
+/** \brief wait word of player <tt>p</tt>, in the shared region pointed by <tt>p_sh</tt> */
+#define PLAYERWORD(p_sh,p)      ((WAIT_WORD *) ((char *) (p_sh) + (p_sh)->wordOff) + (p))
+
+/** \brief wait word of goalie <tt>g</tt>, in the shared region pointed by <tt>p_sh</tt> */
+#define GOALIEWORD(p_sh,g)      ((WAIT_WORD *) ((char *) (p_sh) + (p_sh)->wordOff) + (p_sh)->fSt.nPlayers + (g))
+
+/** \brief registration barrier of team <tt>t</tt> (1 .. nReferees * nTeams), in the shared region pointed by
+           <tt>p_sh</tt> */
+#define TEAM(p_sh,t)            ((BARRIER *) ((char *) (p_sh) + (p_sh)->teamOff) + (t) - 1)
+
+/** \brief pitches (0 .. nReferees - 1), in the shared region pointed by <tt>p_sh</tt> */
+#define PITCHES(p_sh)           ((PITCH *) ((char *) (p_sh) + (p_sh)->pitchOff))
+
+/** \brief semaphore statistics (index 1 .. SEM_NU (nReferees)), in the shared region pointed by <tt>p_sh</tt> */
+#define SEMSTATS(p_sh)          ((SEM_USAGE *) ((char *) (p_sh) + (p_sh)->semStatOff))
+
+/** \brief delays (us): the arrival of the players, the goalies and the referees, then the matches of the referees,
+           in the shared region pointed by <tt>p_sh</tt> */
+#define DELAYS(p_sh)            ((unsigned int *) ((char *) (p_sh) + (p_sh)->delayOff))
+
+/** \brief time player <tt>p</tt> takes to arrive (us), in the shared region pointed by <tt>p_sh</tt> */
+#define PLAYERDELAY(p_sh,p)     (DELAYS (p_sh)[(p)])
+
+/** \brief time goalie <tt>g</tt> takes to arrive (us), in the shared region pointed by <tt>p_sh</tt> */
+#define GOALIEDELAY(p_sh,g)     (DELAYS (p_sh)[(p_sh)->fSt.nPlayers + (g)])
+
+/** \brief time referee <tt>r</tt> takes to arrive (us), in the shared region pointed by <tt>p_sh</tt> */
+#define REFEREEDELAY(p_sh,r)    (DELAYS (p_sh)[(p_sh)->fSt.nPlayers + (p_sh)->fSt.nGoalies + (r)])
+
+/** \brief time the match of referee <tt>r</tt> takes (us), in the shared region pointed by <tt>p_sh</tt> */
+#define PLAYDELAY(p_sh,r)       (DELAYS (p_sh)[(p_sh)->fSt.nPlayers + (p_sh)->fSt.nGoalies + (p_sh)->fSt.nReferees + (r)])
+
+/** \brief pitch where team <tt>t</tt> plays, in the shared region pointed by <tt>p_sh</tt> */
+#define TEAMPITCH(p_sh,t)       (((t) - 1) / (p_sh)->fSt.nTeams)
+
+/** \brief team <tt>t</tt> takes the states of team 1 (otherwise those of team 2), in the shared region pointed by
+           <tt>p_sh</tt> */
+#define TEAMONE(p_sh,t)         (((t) - 1) % (p_sh)->fSt.nTeams % 2 == 0)
+
+/** \brief the calling process is killed when the owner of the region pointed by <tt>p_sh</tt> terminates: false if
+           it already did */
+static inline bool ownerAlive (SHARED_DATA *p_sh)
+{
+    prctl (PR_SET_PDEATHSIG, SIGKILL);
+    return getppid () == p_sh->owner;                   /* the owner may have terminated before the signal was set */
+}
+
+/** \brief current time (ns, monotonic clock), for the timing of the matches */
+static inline uint64_t benchTime (void)
+{
+    struct timespec now;
+
+    clock_gettime (CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000 + (uint64_t) now.tv_nsec;
+}
+
+/** \brief time <tt>*p_t</tt> is set to the current time, unless it is already set */
+static inline void benchFirst (atomic_uint_least64_t *p_t)
+{
+    uint_least64_t unset = 0;
+
+    if (atomic_load (p_t) == 0) {
+        atomic_compare_exchange_strong (p_t, &unset, benchTime ());
+    }
+}
+
+/** \brief time <tt>*p_t</tt> is set to the current time, if it is later */
+static inline void benchLast (atomic_uint_least64_t *p_t)
+{
+    uint_least64_t now = benchTime (), t = atomic_load (p_t);
+
+    while ((t < now) && !atomic_compare_exchange_weak (p_t, &t, now))
+        ;
+}
+
+/** \brief environment variable through which the generator passes the key of the simulation to the entities */
+#define KEYENV                   "SOCCERGAME_KEY"
+
+/** \brief keys of the simulations: each generator picks a private one, from its pid, in this range */
+#define KEYBASE                  0x5c000000
+#define KEYMASK                  0x00ffffff
+
+/** \brief number of semaphores in the set, for <tt>nPitches</tt> pitches: it does not depend on the number of
+           players and goalies, that wait for their teams on wait words */
+#define SEM_NU(nPitches)         (7 + 5 * (nPitches))
 
 #define MUTEX                    1
-#define PLAYERSWAITTEAM          2
-#define GOALIESWAITTEAM          3
-#define PLAYERSWAITREFEREE       4
-#define PLAYERSWAITEND           5
-#define REFEREEWAITTEAMS         6
-#define PLAYERREGISTERED         7
-#define PLAYING                  8
+#define LOGSLOTS                 2
+#define LOGITEMS                 3
+#define ROUNDSTART(r)            (4 + (r) % 2)
+#define ROUNDEND                 6
+#define LOGLOCK                  7
+
+/* semaphores of pitch p (0 .. nPitches - 1) */
+#define PITCHMUTEX(p)            (8 + 5 * (p))
+#define PLAYERSWAITREFEREE(p)    (9 + 5 * (p))
+#define PLAYERSWAITEND(p)        (10 + 5 * (p))
+#define PLAYING(p)               (11 + 5 * (p))
+#define TEAMSFORMED(p)           (12 + 5 * (p))
 
 #endif /* SHAREDDATASYNC_H_ */
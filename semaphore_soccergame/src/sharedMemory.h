@@ -3,11 +3,15 @@
  *
  *  \brief Shared memory management.
  *
+ *  It is implemented on SysV shared memory (sharedMemory.c) or, when built with <tt>make SHM=posix</tt>, on POSIX
+ *  shared memory objects with prefaulted mappings (sharedMemoryPosix.c).
+ *
  *   Operations defined on shared memory:
  *      \li creation of a new block
  *      \li connection to a previously created block
  *      \li destruction of a previously created block
  *      \li mapping of the block previously created on the process address space
+ *      \li read-only mapping of the block previously created on the process address space
  *      \li unmapping of the block off the process address space.
  *
  *  \author António Rui Borges - October 1995
@@ -70,6 +74,21 @@ extern int shmemDestroy (int shmid);
 
 extern int shmemAttach (int shmid, void **pAttAdd);
 
+/**
+ *  \brief Read-only mapping of the block previously created on the process address space.
+ *
+ *  The function fails if there is no block with an identifier equal to <tt>shmid</tt>. Meant for observers, that
+ *  must not change the block.
+ *
+ *  \param shmid block identifier
+ *  \param pAttAdd pointer to the location where the local address of the attached block is stored
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int shmemAttachRead (int shmid, void **pAttAdd);
+
 /**
  *  \brief Unmapping of the block off the process address space.
  *
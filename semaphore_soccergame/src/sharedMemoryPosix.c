@@ -0,0 +1,266 @@
+/**
+ *  \file sharedMemoryPosix.c (implementation file)
+ *
+ *  \brief Shared memory management.
+ *
+ *  Alternative implementation of the interface in sharedMemory.h, selected at build time with
+ *  <tt>make SHM=posix</tt>. The block is a POSIX shared memory object named after the creation key, that is mapped
+ *  with <tt>mmap</tt>; the block identifier is the creation key itself, so that connection takes no resources of
+ *  the process. Every mapping is prefaulted (<tt>MAP_POPULATE</tt>), so that the processes do not take page faults
+ *  on the first touch of the block during a match.
+ *
+ *  When built with <tt>SOCCER_HUGEPAGES</tt> defined (<tt>make SHM=posix HUGEPAGES=1</tt>), the block is sized in
+ *  whole huge pages and its mappings are advised to be backed by them (transparent huge pages of shared memory, as
+ *  permitted by <tt>/sys/kernel/mm/transparent_hugepage/shmem_enabled</tt>).
+ *
+ *  The blocks that the process created and did not destroy are unlinked when it exits, so that they do not outlive
+ *  it; only a process that is killed leaves its blocks behind (see <tt>run/clean.sh</tt>).
+ *
+ *   Operations defined on shared memory:
+ *      \li creation of a new block
+ *      \li connection to a previously created block
+ *      \li destruction of a previously created block
+ *      \li mapping of the block previously created on the process address space
+ *      \li read-only mapping of the block previously created on the process address space
+ *      \li unmapping of the block off the process address space.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "sharedMemory.h"
+
+/** \brief access permission: user r-w */
+#define  MASK           0600
+
+/** \brief maximum number of blocks a process may create, and of mappings it may hold */
+#define  MAXBLOCKS      8
+
+#ifdef SOCCER_HUGEPAGES
+/** \brief size of a huge page (bytes): the block is sized in whole ones */
+#define  HUGESIZE       (2UL << 20)
+#endif
+
+/** \brief mappings of the process */
+static struct
+        { /** \brief local address of the mapping - NULL if the entry is free */
+          void *add;
+          /** \brief size of the mapping */
+          size_t size;
+        } maps[MAXBLOCKS];
+
+/** \brief creation keys of the blocks created by the process and not yet destroyed - -1 if the entry is free */
+static int created[MAXBLOCKS] = { -1, -1, -1, -1, -1, -1, -1, -1 };
+
+/** \brief process that created the blocks: the processes it generates do not unlink them */
+static pid_t creator = -1;
+
+/** \brief name of the shared memory object associated to a creation key */
+static void blockName (char name[], int key)
+{
+  sprintf (name, "/soccergame.shm.%x", (unsigned int) key);
+}
+
+/** \brief unlinking of the blocks the process created and did not destroy, when it exits */
+static void unlinkCreated (void)
+{
+  char name[64];                                                                        /* shared memory object name */
+  int b;
+
+  if (getpid () != creator) return;
+  for (b = 0; b < MAXBLOCKS; b++)
+    if (created[b] != -1)
+       { blockName (name, created[b]);
+         shm_unlink (name);
+         created[b] = -1;
+       }
+}
+
+/** \brief mapping of a block, prefaulted, and registration in the local table */
+static int mapBlock (int shmid, int prot, int flags, void **pAttAdd)
+{
+  char name[64];                                                                        /* shared memory object name */
+  struct stat st;                                                                              /* block status */
+  void *add;                                                                                    /* temporary pointer */
+  int fd, m;
+
+  for (m = 0; m < MAXBLOCKS; m++)
+    if (maps[m].add == NULL) break;
+  if (m == MAXBLOCKS)
+     { errno = EMFILE;
+       return -1;
+     }
+  blockName (name, shmid);
+  if ((fd = shm_open (name, flags, MASK)) == -1)
+     return -1;
+  if (fstat (fd, &st) == -1)
+     { close (fd);
+       return -1;
+     }
+  add = mmap (NULL, (size_t) st.st_size, prot, MAP_SHARED | MAP_POPULATE, fd, 0);
+  close (fd);
+  if (add == MAP_FAILED)
+     return -1;
+#ifdef SOCCER_HUGEPAGES
+  madvise (add, (size_t) st.st_size, MADV_HUGEPAGE);           /* only a hint: it fails where THP is not built */
+#endif
+  maps[m].add = add;
+  maps[m].size = (size_t) st.st_size;
+  *pAttAdd = add;
+  return 0;
+}
+
+/**
+ *  \brief Creation of a new block.
+ *
+ *  The function fails if there is already a block of shared memory with a creation key equal to <tt>key</tt>.
+ *
+ *  \param key creation key
+ *  \param size block size (in bytes)
+ *
+ *  \return block identifier, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int shmemCreate (int key, unsigned int size)
+{
+  char name[64];                                                                        /* shared memory object name */
+  size_t len = size;                                                                               /* block size */
+  int fd, b;
+
+#ifdef SOCCER_HUGEPAGES
+  len = (len + HUGESIZE - 1) / HUGESIZE * HUGESIZE;
+#endif
+  for (b = 0; b < MAXBLOCKS; b++)
+    if (created[b] == -1) break;
+  if (b == MAXBLOCKS)
+     { errno = EMFILE;
+       return -1;
+     }
+  blockName (name, key);
+  if ((fd = shm_open (name, O_RDWR | O_CREAT | O_EXCL, MASK)) == -1)
+     return -1;
+  if (ftruncate (fd, (off_t) len) == -1)                                          /* the block is zero filled */
+     { close (fd);
+       shm_unlink (name);
+       return -1;
+     }
+  close (fd);
+  if (creator != getpid ())
+     { creator = getpid ();
+       atexit (unlinkCreated);
+     }
+  created[b] = key;
+  return key;
+}
+
+/**
+ *  \brief Connection to a previously created block.
+ *
+ *  The function fails if there is no block with a creation key equal to <tt>key</tt>.
+ *
+ *  \param key creation key
+ *
+ *  \return block identifier, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int shmemConnect (int key)
+{
+  char name[64];                                                                        /* shared memory object name */
+  int fd;
+
+  blockName (name, key);
+  if ((fd = shm_open (name, O_RDONLY, 0)) == -1)                   /* the block is opened again when it is mapped */
+     return -1;
+  close (fd);
+  return key;
+}
+
+/**
+ *  \brief Destruction of a previously created block.
+ *
+ *  The function fails if there is no block with an identifier equal to <tt>shmid</tt>. The mappings of the block
+ *  stay valid until they are unmapped.
+ *
+ *  \param shmid block identifier
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int shmemDestroy (int shmid)
+{
+  char name[64];                                                                        /* shared memory object name */
+  int b;
+
+  for (b = 0; b < MAXBLOCKS; b++)
+    if (created[b] == shmid) created[b] = -1;
+  blockName (name, shmid);
+  return shm_unlink (name);
+}
+
+/**
+ *  \brief Mapping of the block previously created on the process address space.
+ *
+ *  The function fails if there is no block with an identifier equal to <tt>shmid</tt>.
+ *
+ *  \param shmid block identifier
+ *  \param pAttAdd pointer to the location where the local address of the attached block is stored
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int shmemAttach (int shmid, void **pAttAdd)
+{
+  return mapBlock (shmid, PROT_READ | PROT_WRITE, O_RDWR, pAttAdd);
+}
+
+/**
+ *  \brief Read-only mapping of the block previously created on the process address space.
+ *
+ *  The function fails if there is no block with an identifier equal to <tt>shmid</tt>.
+ *
+ *  \param shmid block identifier
+ *  \param pAttAdd pointer to the location where the local address of the attached block is stored
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int shmemAttachRead (int shmid, void **pAttAdd)
+{
+  return mapBlock (shmid, PROT_READ, O_RDONLY, pAttAdd);
+}
+
+/**
+ *  \brief Unmapping of the block off the process address space.
+ *
+ *  The function fails if the pointer does not locate a region of the address space
+ *  where a mapping took previously place.
+ *
+ *  \param attAdd local address of the attached block
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int shmemDettach (void *attAdd)
+{
+  int m;
+
+  for (m = 0; m < MAXBLOCKS; m++)
+    if ((attAdd != NULL) && (maps[m].add == attAdd))
+       { maps[m].add = NULL;
+         return munmap (attAdd, maps[m].size);
+       }
+  errno = EINVAL;
+  return -1;
+}
@@ -0,0 +1,89 @@
+/**
+ *  \file soccerThreads.h (interface file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  Entry points of the intervening entities in the thread-based engine and in the worker pool.
+ *
+ *  When built with <tt>SOCCER_THREADS</tt> defined (<tt>make threads</tt>), players, goalies and referees are not
+ *  separate programs: their life cycles run as threads of the generator, that owns a process-private shared
+ *  region and semaphore set. Each entity is bound once to them, before any of its threads is created.
+ *
+ *  When built with <tt>SOCCER_WORKER</tt> defined, the same entry points are linked into the worker program
+ *  instead: a worker of the pool (option <tt>-k</tt> of the generator) binds every entity once and then runs,
+ *  in its own process, the life cycle that each command of the generator asks for.
+ */
+
+#ifndef SOCCERTHREADS_H_
+#define SOCCERTHREADS_H_
+
+#include "sharedDataSync.h"
+
+/**
+ *  \brief Definition of <em>worker command</em> data type.
+ *
+ *  Sent by the generator on the standard input of a worker, one per match; the worker answers on its standard
+ *  output with its index, once the life cycle is over.
+ */
+typedef struct
+{   /** \brief entity kind (<tt>LOG_PLAYER</tt>, <tt>LOG_GOALIE</tt> or <tt>LOG_REFEREE</tt>) */
+    int kind;
+    /** \brief entity id */
+    int id;
+} WORK_CMD;
+
+/**
+ *  \brief Binding of the players to the logging file, the shared region and the semaphore set.
+ *
+ *  \param logName name of the logging file
+ *  \param p_sh pointer to the shared region
+ *  \param p_semgid semaphore set identifier
+ */
+extern void playerBind (char logName[], SHARED_DATA *p_sh, int p_semgid);
+
+/**
+ *  \brief Life cycle of a player, as a thread.
+ *
+ *  \param arg player id, cast to a pointer
+ *
+ *  \return NULL
+ */
+extern void *playerThread (void *arg);
+
+/**
+ *  \brief Binding of the goalies to the logging file, the shared region and the semaphore set.
+ *
+ *  \param logName name of the logging file
+ *  \param p_sh pointer to the shared region
+ *  \param p_semgid semaphore set identifier
+ */
+extern void goalieBind (char logName[], SHARED_DATA *p_sh, int p_semgid);
+
+/**
+ *  \brief Life cycle of a goalie, as a thread.
+ *
+ *  \param arg goalie id, cast to a pointer
+ *
+ *  \return NULL
+ */
+extern void *goalieThread (void *arg);
+
+/**
+ *  \brief Binding of the referees to the logging file, the shared region and the semaphore set.
+ *
+ *  \param logName name of the logging file
+ *  \param p_sh pointer to the shared region
+ *  \param p_semgid semaphore set identifier
+ */
+extern void refereeBind (char logName[], SHARED_DATA *p_sh, int p_semgid);
+
+/**
+ *  \brief Life cycle of a referee, as a thread.
+ *
+ *  \param arg referee id, cast to a pointer
+ *
+ *  \return NULL
+ */
+extern void *refereeThread (void *arg);
+
+#endif /* SOCCERTHREADS_H_ */
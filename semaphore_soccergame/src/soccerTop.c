@@ -0,0 +1,263 @@
+/**
+ *  \file soccerTop.c (implementation file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  Live monitor of a simulation.
+ *
+ *  The monitor attaches read-only to the shared region of a running generator (process-based engine) and refreshes,
+ *  several times per second, a view of the state of every intervening entity and of the counters of the batch: the
+ *  runs, the matches completed, the teams formed, the late arrivals, the semaphore waits (instrumented build) and
+ *  the mean and p99 latency of the phases of the matches (see the monitoring page in sharedDataSync.h).
+ *
+ *  It takes no lock and does not operate on the semaphores: the state is read through <tt>snapshotState</tt> and
+ *  the counters are atomic, so that watching a run does not perturb its timing. The counters of the run under way
+ *  are taken from the state of the entities; those of the batch only cover the runs that were completed.
+ *
+ *  Upon execution, one parameter is requested:
+ *    \li process id of the generator.
+ *
+ *  Options:
+ *    \li <tt>-i ms</tt>: refresh period (default <tt>REFRESHMS</tt>)
+ *    \li <tt>-k key</tt>: key of the simulation, as passed to the entities in <tt>KEYENV</tt> (default: the key
+ *        picked by the generator from its process id)
+ *    \li <tt>-1</tt>: a single view, that does not clear the screen.
+ *
+ *  The monitor terminates with the generator.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/types.h>
+
+#include "probConst.h"
+#include "probDataStruct.h"
+#include "logging.h"
+#include "sharedDataSync.h"
+#include "semStat.h"
+#include "sharedMemory.h"
+
+/** \brief refresh period (ms) */
+#define  REFRESHMS      200
+
+/** \brief number of keys tried from the one of the process id, as the generator does when a key is in use */
+#define  KEYTRIES       64
+
+/** \brief number of refresh periods the monitor waits for the region of a generator that is starting */
+#define  ATTACHTRIES    10
+
+/** \brief names of the phases of a match, as in the metrics file of the generator */
+static const char *phaseName[NPHASES] = { "match", "team formation", "start handshake", "end release" };
+
+static void usage (char *prog)
+{
+    fprintf (stderr, "Usage: %s [-i ms] [-k key] [-1] generatorPid\n", prog);
+    exit (EXIT_FAILURE);
+}
+
+/** \brief the process <tt>pid</tt> has not terminated */
+static bool alive (pid_t pid)
+{
+    return (kill (pid, 0) == 0) || (errno == EPERM);
+}
+
+/**
+ *  \brief Attaching read-only to the shared region of the generator.
+ *
+ *  \param key key of the simulation, or -1 to try those picked from the process id of the generator
+ *  \param pid process id of the generator, that owns the region
+ *
+ *  \return pointer to the shared region, or \c NULL if it was not found
+ */
+static SHARED_DATA *attachRegion (int key, pid_t pid)
+{
+    SHARED_DATA *sh;
+    int shmid, k;
+
+    for (k = 0; k < ((key == -1) ? KEYTRIES : 1); k++) {
+        int tryKey = (key == -1) ? KEYBASE + ((pid + k) & KEYMASK) : key;
+        if (((shmid = shmemConnect (tryKey)) == -1) || (shmemAttachRead (shmid, (void **) &sh) == -1)) {
+            continue;
+        }
+        if ((key != -1) || (sh->owner == pid)) {
+            return sh;
+        }
+        shmemDettach (sh);
+    }
+    return NULL;
+}
+
+/** \brief upper bound (us) of the bin of the log2 histogram <tt>hist</tt> where the count reaches the share
+           <tt>q</tt> of the <tt>n</tt> values */
+static unsigned long quantile (atomic_ulong hist[], unsigned long n, double q)
+{
+    unsigned long seen = 0;
+    unsigned int b;
+
+    for (b = 0; b < SEMSTATBINS - 1; b++) {
+        if ((seen += atomic_load_explicit (&hist[b], memory_order_relaxed)) >= q * n) {
+            break;
+        }
+    }
+    return 1UL << b;
+}
+
+/**
+ *  \brief Printing a view of the simulation.
+ *
+ *  \param sh pointer to the shared region
+ *  \param pid process id of the generator
+ */
+static void showView (SHARED_DATA *sh, pid_t pid)
+{
+    FULL_STAT *p_fSt = &sh->fSt;
+    MONITOR *mon = &sh->mon;
+    _Alignas (STAT) char snapBuf[STATSIZE (p_fSt->nPlayers, p_fSt->nGoalies, p_fSt->nReferees)];
+    STAT *snap = (STAT *) snapBuf;                                        /* consistent copy of the entity states */
+    unsigned long late = 0, ended = 0;                                   /* late arrivals, matches of the run */
+    int e, n = p_fSt->nPlayers + p_fSt->nGoalies + p_fSt->nReferees;
+    int w = logColWidth (p_fSt->nPlayers, p_fSt->nGoalies, p_fSt->nReferees);               /* column width */
+    unsigned int s, ph;
+
+    snapshotState (p_fSt, snap);
+
+    printf ("soccertop - generator %d: run %u of %u%s, %u completed, %u stalled\n\n", (int) pid, sh->round,
+            mon->runs, sh->tournament ? " (tournament)" : "", atomic_load (&mon->runsDone), atomic_load (&mon->stalls));
+
+    for (e = 0; e < n; e++) {                                                /* state of every entity, as logged */
+        if ((e == p_fSt->nPlayers) || (e == p_fSt->nPlayers + p_fSt->nGoalies)) {
+            printf (" ");
+        }
+        if (e < p_fSt->nPlayers) {
+            printf (" P%0*d", w - 2, e);
+        }
+        else if (e < p_fSt->nPlayers + p_fSt->nGoalies) {
+            printf (" G%0*d", w - 2, e - p_fSt->nPlayers);
+        }
+        else printf (" R%0*d", w - 2, e - p_fSt->nPlayers - p_fSt->nGoalies + 1);
+    }
+    printf ("\n");
+    for (e = 0; e < n; e++) {
+        if ((e == p_fSt->nPlayers) || (e == p_fSt->nPlayers + p_fSt->nGoalies)) {
+            printf (" ");
+        }
+        printf ("%*c", w, (char) snap->stat[e]);
+        if ((e < p_fSt->nPlayers + p_fSt->nGoalies) && (snap->stat[e] == LATE)) {
+            late++;
+        }
+        else if ((e >= p_fSt->nPlayers + p_fSt->nGoalies) && (snap->stat[e] == ENDING_GAME)) {
+            ended++;
+        }
+    }
+    printf ("\n\n");
+
+    printf ("%-20s %12s %12s\n", "", "this run", "batch");
+    printf ("%-20s %12lu %12lu\n", "matches completed", ended, atomic_load (&mon->matches));
+    printf ("%-20s %12d %12lu\n", "teams formed", p_fSt->teamId - 1, atomic_load (&mon->teams));
+    printf ("%-20s %12lu %12lu\n", "late arrivals", late, atomic_load (&mon->late));
+
+    if (mon->semStats) {                                                        /* the whole batch, as it goes */
+        unsigned long downs = 0, blocked = 0, waitNs = 0;
+        for (s = 1; s <= (unsigned int) SEM_NU (p_fSt->nReferees); s++) {
+            SEM_USAGE *st = &SEMSTATS (sh)[s];
+            downs += atomic_load_explicit (&st->downs, memory_order_relaxed);
+            blocked += atomic_load_explicit (&st->blocked, memory_order_relaxed);
+            waitNs += atomic_load_explicit (&st->waitNs, memory_order_relaxed);
+        }
+        printf ("%-20s %12s %12lu  of %lu downs (%.1f%%), mean %.3f us\n", "semaphore waits", "", blocked, downs,
+                (downs > 0) ? 100.0 * blocked / downs : 0.0, (blocked > 0) ? (double) waitNs / 1e3 / blocked : 0.0);
+    }
+    else printf ("%-20s %12s %12s\n", "semaphore waits", "", "(make STATS=1)");
+
+    printf ("\n%-20s %12s %12s %12s\n", "phase latency (us)", "matches", "mean", "p99 <");
+    for (ph = 0; ph < NPHASES; ph++) {
+        PHASE_STAT *pst = &mon->phase[ph];
+        unsigned long cnt = atomic_load (&pst->n);
+        printf ("%-20s %12lu %12.3f %12lu\n", phaseName[ph], cnt,
+                (cnt > 0) ? (double) atomic_load (&pst->sumNs) / 1e3 / cnt : 0.0,
+                (cnt > 0) ? quantile (pst->hist, cnt, 0.99) : 0UL);
+    }
+    fflush (stdout);
+}
+
+/**
+ *  \brief Main program.
+ *
+ *  Its role is to watch the simulation of a generator until it terminates.
+ */
+int main (int argc, char *argv[])
+{
+    SHARED_DATA *sh;                                                                /* pointer to shared memory region */
+    int key = -1;                                                       /* key of the simulation, -1 if not given */
+    unsigned int ms = REFRESHMS;                                                                  /* refresh period */
+    bool once = false;                                                                         /* a single view */
+    pid_t pid;                                                                         /* process id of the generator */
+    char *tinp;                                                                     /* numerical parameters test flag */
+    int opt;                                                                                       /* command option */
+    int tries = 0;                                                                    /* attempts to attach */
+
+    while ((opt = getopt (argc, argv, "i:k:1")) != -1) {
+        switch (opt) {
+            case 'i':
+                ms = (unsigned int) strtoul (optarg, &tinp, 0);
+                if ((*tinp != '\0') || (ms == 0)) {
+                    usage (argv[0]);
+                }
+                break;
+            case 'k':
+                key = (int) strtol (optarg, &tinp, 0);
+                if (*tinp != '\0') {
+                    usage (argv[0]);
+                }
+                break;
+            case '1':
+                once = true;
+                break;
+            default:
+                usage (argv[0]);
+        }
+    }
+    if (optind != argc - 1) {
+        usage (argv[0]);
+    }
+    pid = (pid_t) strtol (argv[optind], &tinp, 0);
+    if ((*tinp != '\0') || (pid <= 0)) {
+        usage (argv[0]);
+    }
+
+    /* the generator maps the region, and sets up its first run, just after it creates it */
+    while (((sh = attachRegion (key, pid)) == NULL) || (sh->round == 0)) {
+        if (sh != NULL) {
+            shmemDettach (sh);
+        }
+        if (!alive (pid) || (++tries == ATTACHTRIES)) {
+            fprintf (stderr, "No simulation of process %d was found (the thread-based engine is not observable)\n",
+                     (int) pid);
+            exit (EXIT_FAILURE);
+        }
+        usleep (ms * 1000);
+    }
+
+    do {
+        if (!once) {
+            printf ("\033[H\033[J");                                                          /* clear the screen */
+        }
+        showView (sh, pid);
+        if (!once) {
+            usleep (ms * 1000);
+        }
+    } while (!once && alive (pid));
+
+    /* unmapping the shared region off the process address space */
+    if (shmemDettach (sh) == -1) {
+        perror ("error on unmapping the shared region off the process address space");
+        exit (EXIT_FAILURE);
+    }
+
+    return EXIT_SUCCESS;
+}
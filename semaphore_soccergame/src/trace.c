@@ -0,0 +1,312 @@
+/**
+ *  \file trace.c (implementation file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief Timed trace of the intervening entities, in the trace event format of Chrome and Perfetto.
+ *
+ *  Defined operations:
+ *     \li creation of the events file
+ *     \li attaching the calling entity to the trace
+ *     \li recording a state change
+ *     \li detaching the calling entity from the trace
+ *     \li exporting the events file as a trace.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "probConst.h"
+#include "logging.h"
+#include "semStat.h"
+#include "trace.h"
+
+/** \brief number of events kept by an entity before they are appended to the events file */
+#define  TRACEBUFSIZE     512
+
+/** \brief name of the events file (one per thread in the thread-based engine, as any entity state) */
+static _Thread_local char tName[TRACENAMESIZE + 8];
+
+/** \brief the entity is attached to the trace */
+static _Thread_local bool tOn = false;
+
+/** \brief kind of the attached entity */
+static _Thread_local int tKind;
+
+/** \brief id of the attached entity */
+static _Thread_local int tId;
+
+/** \brief process and thread ids of the attached entity */
+static _Thread_local int32_t tPid, tTid;
+
+/** \brief current state of the entity - -1 until its first state change */
+static _Thread_local int tState = -1;
+
+/** \brief start of the current state (ns, monotonic clock) */
+static _Thread_local uint64_t tSince;
+
+/** \brief pending events of the entity */
+static _Thread_local TRACE_EV tBuf[TRACEBUFSIZE];
+
+/** \brief number of pending events */
+static _Thread_local unsigned int tLen = 0;
+
+#ifndef SOCCER_THREADS
+/** \brief the entity is detached on process exit, once it was attached */
+static bool tAtExit = false;
+#endif
+
+/* internal functions */
+
+static void eventsName (char ev[], char name[])
+{
+    sprintf (ev, "%s.events", name);
+}
+
+static void flushTrace (void)
+{
+    int fd;
+    size_t done = 0, size = tLen * sizeof (TRACE_EV);
+    ssize_t n;
+
+    if (tLen == 0) {
+        return;
+    }
+    if ((fd = open (tName, O_WRONLY | O_APPEND)) == -1) {
+        perror ("error on opening the trace events file");
+        exit (EXIT_FAILURE);
+    }
+    while (done < size) {                                  /* appended at once: the entities share the file */
+        if ((n = write (fd, (char *) tBuf + done, size - done)) == -1) {
+            perror ("error on writing the trace events file");
+            exit (EXIT_FAILURE);
+        }
+        done += (size_t) n;
+    }
+    close (fd);
+    tLen = 0;
+}
+
+static void addEvent (int type, uint32_t value, uint64_t ts, uint64_t dur)
+{
+    TRACE_EV *ev;
+
+    if (tLen == TRACEBUFSIZE) {
+        flushTrace ();
+    }
+    ev = &tBuf[tLen++];
+    ev->ts    = ts;
+    ev->dur   = dur;
+    ev->pid   = tPid;
+    ev->tid   = tTid;
+    ev->kind  = (uint8_t) tKind;
+    ev->type  = (uint8_t) type;
+    ev->id    = (uint16_t) tId;
+    ev->value = value;
+}
+
+/** \brief observer of the blocked <em>down</em> operations (see semStat.h) */
+static void traceWait (unsigned int sindex, uint64_t t0, uint64_t waitNs)
+{
+    if (tOn) {
+        addEvent (TRACE_WAIT, sindex, t0, waitNs);
+    }
+}
+
+static const char *stateName (int kind, int state)
+{
+    if (kind == LOG_REFEREE) {
+        switch (state) {
+            case ARRIVINGR:       return "ARRIVING";
+            case WAITING_TEAMS:   return "WAITING_TEAMS";
+            case STARTING_GAME:   return "STARTING_GAME";
+            case REFEREEING:      return "REFEREEING";
+            case ENDING_GAME:     return "ENDING_GAME";
+            default:              return "?";
+        }
+    }
+    switch (state) {
+        case ARRIVING:        return "ARRIVING";
+        case WAITING_TEAM:    return "WAITING_TEAM";
+        case FORMING_TEAM:    return "FORMING_TEAM";
+        case WAITING_START_1: return "WAITING_START_1";
+        case WAITING_START_2: return "WAITING_START_2";
+        case PLAYING_1:       return "PLAYING_1";
+        case PLAYING_2:       return "PLAYING_2";
+        case LATE:            return "LATE";
+        default:              return "?";
+    }
+}
+
+static void entityName (char name[], TRACE_EV *ev)
+{
+    sprintf (name, "%c%02d", ev->kind, (ev->kind == LOG_REFEREE) ? ev->id + 1 : ev->id);      /* as in the log */
+}
+
+/* external functions */
+
+/**
+ *  \brief Creation of the events file.
+ *
+ *  \param name name of the trace file
+ */
+void traceCreate (char name[])
+{
+    char ev[TRACENAMESIZE + 8];
+    int fd;
+
+    eventsName (ev, name);
+    if ((fd = open (ev, O_WRONLY | O_CREAT | O_TRUNC, 0600)) == -1) {
+        perror ("error on creating the trace events file");
+        exit (EXIT_FAILURE);
+    }
+    close (fd);
+}
+
+/**
+ *  \brief Attaching the calling entity to the trace.
+ *
+ *  \param name name of the trace file
+ *  \param kind entity kind (<tt>LOG_PLAYER</tt>, <tt>LOG_GOALIE</tt> or <tt>LOG_REFEREE</tt>)
+ *  \param id entity id
+ */
+void traceAttach (char name[], int kind, int id)
+{
+    eventsName (tName, name);
+    tKind = kind;
+    tId = id;
+    tPid = (int32_t) getpid ();
+    tTid = (int32_t) syscall (SYS_gettid);
+    tState = -1;
+    tLen = 0;
+    tOn = true;
+    semStatObserve (traceWait);
+#ifndef SOCCER_THREADS
+    if (!tAtExit) {
+        atexit (traceDetach);
+        tAtExit = true;
+    }
+#endif
+}
+
+/**
+ *  \brief Recording a state change of the calling entity.
+ *
+ *  \param state new state
+ */
+void traceState (int state)
+{
+    uint64_t now;
+
+    if (!tOn || (state == tState)) {
+        return;
+    }
+    now = semStatClock ();
+    if (tState != -1) {
+        addEvent (TRACE_STATE, (uint32_t) tState, tSince, now - tSince);
+    }
+    tState = state;
+    tSince = now;
+}
+
+/**
+ *  \brief Detaching the calling entity from the trace.
+ */
+void traceDetach (void)
+{
+    if (!tOn) {
+        return;
+    }
+    if (tState != -1) {
+        addEvent (TRACE_STATE, (uint32_t) tState, tSince, semStatClock () - tSince);
+    }
+    flushTrace ();
+    tOn = false;
+}
+
+/**
+ *  \brief Exporting the events file as a trace.
+ *
+ *  \param name name of the trace file
+ *  \param semName function that names a semaphore of the set, given its location
+ */
+void traceExport (char name[], void (*semName) (char name[], unsigned int s))
+{
+    char ev[TRACENAMESIZE + 8];                                                               /* events file name */
+    char what[48], who[8];                                                               /* event and track names */
+    FILE *in, *out;
+    struct stat st;
+    TRACE_EV *evs;                                                                                      /* events */
+    int32_t *tracks = NULL;                                                         /* threads with a named track */
+    size_t nEv, nTracks = 0, i, t;
+    uint64_t ts0 = UINT64_MAX;                                                                   /* first event */
+
+    eventsName (ev, name);
+    if (((in = fopen (ev, "r")) == NULL) || (fstat (fileno (in), &st) == -1)) {
+        perror ("error on opening the trace events file");
+        exit (EXIT_FAILURE);
+    }
+    nEv = (size_t) st.st_size / sizeof (TRACE_EV);
+    if (((evs = malloc (nEv * sizeof (TRACE_EV) + 1)) == NULL) || (fread (evs, sizeof (TRACE_EV), nEv, in) != nEv)) {
+        perror ("error on reading the trace events file");
+        exit (EXIT_FAILURE);
+    }
+    fclose (in);
+    unlink (ev);
+
+    for (i = 0; i < nEv; i++) {
+        if (evs[i].ts < ts0) {
+            ts0 = evs[i].ts;
+        }
+    }
+
+    if ((out = fopen (name, "w")) == NULL) {
+        perror ("error on creating the trace file");
+        exit (EXIT_FAILURE);
+    }
+    fprintf (out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    for (i = 0; i < nEv; i++) {
+        for (t = 0; (t < nTracks) && (tracks[t] != evs[i].tid); t++)
+            ;
+        if (t == nTracks) {                                                    /* first event of the entity */
+            if ((tracks = realloc (tracks, (nTracks + 1) * sizeof (int32_t))) == NULL) {
+                perror ("error on allocating the trace tracks");
+                exit (EXIT_FAILURE);
+            }
+            tracks[nTracks++] = evs[i].tid;
+            entityName (who, &evs[i]);
+            if (evs[i].pid == evs[i].tid) {
+                fprintf (out, "\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"%s\"}},",
+                         evs[i].pid, who);
+            }
+            fprintf (out, "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}},",
+                     evs[i].pid, evs[i].tid, who);
+        }
+        if (evs[i].type == TRACE_STATE) {
+            strcpy (what, stateName (evs[i].kind, (int) evs[i].value));
+        }
+        else {
+            strcpy (what, "down ");
+            semName (what + strlen (what), evs[i].value);
+        }
+        fprintf (out, "\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d}%s",
+                 what, (evs[i].type == TRACE_STATE) ? "state" : "wait", (double) (evs[i].ts - ts0) / 1e3,
+                 (double) evs[i].dur / 1e3, evs[i].pid, evs[i].tid, (i + 1 < nEv) ? "," : "");
+    }
+    fprintf (out, "\n]}\n");
+    if (fclose (out) == EOF) {
+        perror ("error on closing the trace file");
+        exit (EXIT_FAILURE);
+    }
+    free (tracks);
+    free (evs);
+}
@@ -0,0 +1,114 @@
+/**
+ *  \file trace.h (interface file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief Timed trace of the intervening entities, in the trace event format of Chrome and Perfetto.
+ *
+ *  When tracing is on, every intervening entity records, in a private buffer, how long it stayed in each of its
+ *  states and how long it was blocked on each <em>down</em> that could not proceed at once, with times taken
+ *  from the monotonic clock. The buffer is appended to the events file of the trace as it fills up and when the
+ *  entity terminates; at the end of the simulation the generator converts the events file into the trace, a JSON
+ *  file with one track per player, goalie and referee.
+ *
+ *  Defined operations:
+ *     \li creation of the events file
+ *     \li attaching the calling entity to the trace
+ *     \li recording a state change
+ *     \li detaching the calling entity from the trace
+ *     \li exporting the events file as a trace.
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stdint.h>
+
+/** \brief maximum length of the name of the trace file */
+#define  TRACENAMESIZE     64
+
+/** \brief kind of a trace event: an entity stayed in a state */
+#define  TRACE_STATE      'S'
+/** \brief kind of a trace event: an entity was blocked on a semaphore */
+#define  TRACE_WAIT       'W'
+
+/**
+ *  \brief Definition of <em>trace event</em> data type, as stored in the events file.
+ */
+typedef struct
+{   /** \brief start of the event (ns, monotonic clock) */
+    uint64_t ts;
+
+    /** \brief duration of the event (ns) */
+    uint64_t dur;
+
+    /** \brief process id of the entity */
+    int32_t pid;
+
+    /** \brief thread id of the entity (the process id, unless the entities are threads) */
+    int32_t tid;
+
+    /** \brief entity kind (see logging.h) */
+    uint8_t kind;
+
+    /** \brief event kind - <tt>TRACE_STATE</tt> or <tt>TRACE_WAIT</tt> */
+    uint8_t type;
+
+    /** \brief entity id */
+    uint16_t id;
+
+    /** \brief state (<tt>TRACE_STATE</tt>) or semaphore location in the set (<tt>TRACE_WAIT</tt>) */
+    uint32_t value;
+
+} TRACE_EV;
+
+/**
+ *  \brief Creation of the events file.
+ *
+ *  Must be called by the generator before any entity attaches to the trace.
+ *
+ *  \param name name of the trace file
+ */
+extern void traceCreate (char name[]);
+
+/**
+ *  \brief Attaching the calling entity to the trace.
+ *
+ *  Its state changes and its blocked <em>down</em> operations are recorded from then on. The entity is detached
+ *  on process exit, unless it is a thread: then it must detach itself.
+ *
+ *  \param name name of the trace file
+ *  \param kind entity kind (<tt>LOG_PLAYER</tt>, <tt>LOG_GOALIE</tt> or <tt>LOG_REFEREE</tt>)
+ *  \param id entity id
+ */
+extern void traceAttach (char name[], int kind, int id);
+
+/**
+ *  \brief Recording a state change of the calling entity.
+ *
+ *  Ends the event of the previous state, if it is a different one. Nothing is done if the entity is not
+ *  attached to the trace.
+ *
+ *  \param state new state
+ */
+extern void traceState (int state);
+
+/**
+ *  \brief Detaching the calling entity from the trace.
+ *
+ *  Ends the event of the current state and appends the pending events to the events file.
+ */
+extern void traceDetach (void);
+
+/**
+ *  \brief Exporting the events file as a trace.
+ *
+ *  Writes the trace file in the JSON trace event format, with times relative to the first event, and removes the
+ *  events file. Must only be called once every entity has terminated.
+ *
+ *  \param name name of the trace file
+ *  \param semName function that names a semaphore of the set, given its location
+ */
+extern void traceExport (char name[], void (*semName) (char name[], unsigned int s));
+
+#endif /* TRACE_H_ */
@@ -0,0 +1,370 @@
+/**
+ *  \file vclock.c (implementation file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief Virtual time: discrete event scheduling of the intervening entities.
+ *
+ *  The turn is a token: every scheduled entity waits on its own condition variable until the token is handed to
+ *  it, and hands it on when it gives its turn. The ready entities are kept in a FIFO queue and the sleeping ones in
+ *  a binary heap ordered by wake up time (ties in the order they fell asleep), so that the schedule, and thus the
+ *  whole match, only depends on the seed of the random generator.
+ *
+ *  Defined operations:
+ *     \li starting the virtual clock
+ *     \li stopping the virtual clock
+ *     \li querying whether the calling thread is scheduled in virtual time
+ *     \li entering the schedule
+ *     \li leaving the schedule
+ *     \li sleeping
+ *     \li <em>down</em> and <em>up</em> of a semaphore value, in virtual time.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#ifdef SOCCER_THREADS
+#include <pthread.h>
+#endif
+
+#include "vclock.h"
+
+#ifdef SOCCER_THREADS
+
+/**
+ *  \brief Definition of <em>scheduled entity</em> data type.
+ */
+typedef struct vent
+{   /** \brief the entity waits here for its turn */
+    pthread_cond_t turn;
+
+    /** \brief the turn was handed to the entity */
+    bool go;
+
+    /** \brief wake up time, while it sleeps (ns) */
+    uint64_t wake;
+
+    /** \brief order in which it fell asleep, while it sleeps */
+    uint64_t seq;
+
+    /** \brief semaphore value it waits on, while it is blocked */
+    atomic_int *val;
+
+    /** \brief decrement it waits for, while it is blocked */
+    int need;
+
+    /** \brief next entity in the ready queue or in the blocked list */
+    struct vent *next;
+
+} VENT;
+
+/** \brief protects the whole schedule; held by the running entity whenever it changes it */
+static pthread_mutex_t vLock = PTHREAD_MUTEX_INITIALIZER;
+
+/** \brief the virtual clock is started */
+static bool vStarted = false;
+
+/** \brief virtual time (ns) */
+static uint64_t vNow;
+
+/** \brief number of entities that have not entered the schedule yet */
+static int vPending;
+
+/** \brief number of entities in the schedule */
+static int vAlive;
+
+/** \brief ready entities, in the order they became ready */
+static VENT *readyHead, *readyTail;
+
+/** \brief entities blocked on a semaphore value, in the order they blocked */
+static VENT *blockedHead;
+
+/** \brief sleeping entities, as a binary heap on (wake, seq) */
+static VENT **sleepers;
+
+/** \brief number of sleeping entities */
+static int nSleepers;
+
+/** \brief sequence number of the next entity to fall asleep */
+static uint64_t vSeq;
+
+/** \brief the calling thread, when it is scheduled - NULL otherwise */
+static _Thread_local VENT *vSelf = NULL;
+
+/* internal functions */
+
+static void makeReady (VENT *e)
+{
+    e->next = NULL;
+    if (readyHead == NULL) {
+        readyHead = e;
+    }
+    else {
+        readyTail->next = e;
+    }
+    readyTail = e;
+}
+
+static bool earlier (VENT *a, VENT *b)
+{
+    return (a->wake < b->wake) || ((a->wake == b->wake) && (a->seq < b->seq));
+}
+
+static void pushSleeper (VENT *e)
+{
+    int i = nSleepers++, p;
+
+    e->seq = vSeq++;
+    while ((i > 0) && earlier (e, sleepers[p = (i - 1) / 2])) {
+        sleepers[i] = sleepers[p];
+        i = p;
+    }
+    sleepers[i] = e;
+}
+
+static VENT *popSleeper (void)
+{
+    VENT *top = sleepers[0], *last = sleepers[--nSleepers];
+    int i = 0, c;
+
+    while ((c = 2 * i + 1) < nSleepers) {
+        if ((c + 1 < nSleepers) && earlier (sleepers[c + 1], sleepers[c])) {
+            c++;
+        }
+        if (!earlier (sleepers[c], last)) {
+            break;
+        }
+        sleepers[i] = sleepers[c];
+        i = c;
+    }
+    sleepers[i] = last;
+    return top;
+}
+
+/** \brief handing the turn to the next entity: a ready one or else the earliest sleeper, whose time comes */
+static void schedule (void)
+{
+    VENT *next;
+
+    if (readyHead != NULL) {
+        next = readyHead;
+        readyHead = next->next;
+    }
+    else if (nSleepers > 0) {
+        next = popSleeper ();
+        vNow = next->wake;
+    }
+    else if (vAlive > 0) {
+        fprintf (stderr, "virtual time: %d entities are blocked and none can wake them up\n", vAlive);
+        exit (EXIT_FAILURE);
+    }
+    else {
+        return;                                                                    /* every entity has terminated */
+    }
+    next->go = true;
+    pthread_cond_signal (&next->turn);
+}
+
+/** \brief waiting for the turn of the calling entity (the schedule is locked) */
+static void waitTurn (void)
+{
+    while (!vSelf->go) {
+        pthread_cond_wait (&vSelf->turn, &vLock);
+    }
+    vSelf->go = false;
+}
+
+#endif
+
+/* external functions */
+
+/**
+ *  \brief Starting the virtual clock.
+ *
+ *  \param nEntities number of entities that will enter the schedule
+ */
+void vclockStart (int nEntities)
+{
+#ifdef SOCCER_THREADS
+    if ((sleepers = malloc ((size_t) nEntities * sizeof (VENT *))) == NULL) {
+        perror ("error on allocating the virtual time schedule");
+        exit (EXIT_FAILURE);
+    }
+    vNow = 0;
+    vSeq = 0;
+    vPending = nEntities;
+    vAlive = 0;
+    nSleepers = 0;
+    readyHead = readyTail = blockedHead = NULL;
+    vStarted = true;
+#else
+    (void) nEntities;
+    fprintf (stderr, "virtual time is only supported by the thread-based engine\n");
+    exit (EXIT_FAILURE);
+#endif
+}
+
+/**
+ *  \brief Stopping the virtual clock.
+ *
+ *  \return virtual time elapsed since the clock was started (ns)
+ */
+uint64_t vclockStop (void)
+{
+#ifdef SOCCER_THREADS
+    vStarted = false;
+    free (sleepers);
+    sleepers = NULL;
+    return vNow;
+#else
+    return 0;
+#endif
+}
+
+/**
+ *  \brief Querying whether the calling thread is scheduled in virtual time.
+ *
+ *  \return \c true, if it entered the schedule and did not leave it yet
+ */
+bool vclockOn (void)
+{
+#ifdef SOCCER_THREADS
+    return vSelf != NULL;
+#else
+    return false;
+#endif
+}
+
+/**
+ *  \brief Entering the schedule.
+ */
+void vclockEnter (void)
+{
+#ifdef SOCCER_THREADS
+    VENT *e;
+
+    if (!vStarted) {
+        return;
+    }
+    if ((e = calloc (1, sizeof (VENT))) == NULL) {
+        perror ("error on allocating a scheduled entity");
+        exit (EXIT_FAILURE);
+    }
+    pthread_cond_init (&e->turn, NULL);
+    pthread_mutex_lock (&vLock);
+    vSelf = e;
+    vAlive++;
+    makeReady (e);                                                         /* in the order the entities started */
+    if (--vPending == 0) {                                                /* the last one to enter starts the match */
+        schedule ();
+    }
+    waitTurn ();
+    pthread_mutex_unlock (&vLock);
+#endif
+}
+
+/**
+ *  \brief Leaving the schedule.
+ */
+void vclockLeave (void)
+{
+#ifdef SOCCER_THREADS
+    if (vSelf == NULL) {
+        return;
+    }
+    pthread_mutex_lock (&vLock);
+    vAlive--;
+    schedule ();
+    pthread_mutex_unlock (&vLock);
+    pthread_cond_destroy (&vSelf->turn);
+    free (vSelf);
+    vSelf = NULL;
+#endif
+}
+
+/**
+ *  \brief Sleeping.
+ *
+ *  \param us duration of the sleep (us)
+ */
+void vclockSleep (unsigned int us)
+{
+#ifdef SOCCER_THREADS
+    if (vSelf != NULL) {
+        pthread_mutex_lock (&vLock);
+        vSelf->wake = vNow + (uint64_t) us * 1000;
+        pushSleeper (vSelf);
+        schedule ();
+        waitTurn ();
+        pthread_mutex_unlock (&vLock);
+        return;
+    }
+#endif
+    usleep (us);
+}
+
+#ifdef SOCCER_THREADS
+
+/**
+ *  \brief <em>Down</em> by n of a semaphore value, in virtual time.
+ *
+ *  \param val semaphore value
+ *  \param n decrement (>= 1)
+ *
+ *  \return \c 0
+ */
+int vclockDown (atomic_int *val, int n)
+{
+    VENT **p;
+
+    pthread_mutex_lock (&vLock);
+    if (atomic_load (val) >= n) {
+        atomic_fetch_sub (val, n);
+    }
+    else {                                                       /* the decrement is taken by the up that wakes it */
+        vSelf->val = val;
+        vSelf->need = n;
+        vSelf->next = NULL;
+        for (p = &blockedHead; *p != NULL; p = &(*p)->next)
+            ;
+        *p = vSelf;
+        schedule ();
+        waitTurn ();
+    }
+    pthread_mutex_unlock (&vLock);
+    return 0;
+}
+
+/**
+ *  \brief <em>Up</em> by n of a semaphore value, in virtual time.
+ *
+ *  \param val semaphore value
+ *  \param n increment (>= 1)
+ *
+ *  \return \c 0
+ */
+int vclockUp (atomic_int *val, int n)
+{
+    VENT **p, *e;
+
+    pthread_mutex_lock (&vLock);
+    atomic_fetch_add (val, n);
+    for (p = &blockedHead; (*p != NULL) && (atomic_load (val) > 0); ) {
+        e = *p;
+        if ((e->val == val) && (e->need <= atomic_load (val))) {
+            atomic_fetch_sub (val, e->need);
+            *p = e->next;
+            makeReady (e);
+        }
+        else {
+            p = &e->next;
+        }
+    }
+    pthread_mutex_unlock (&vLock);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,112 @@
+/**
+ *  \file vclock.h (interface file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief Virtual time: discrete event scheduling of the intervening entities.
+ *
+ *  In the thread-based engine, a match may be run in virtual time (option <tt>-V</tt> of the generator): the
+ *  entity threads then take turns, only one of them running at a time, and their delays advance a virtual clock
+ *  instead of sleeping. The running entity keeps its turn until it sleeps, blocks on a semaphore or terminates;
+ *  the turn is then given to the entities that its <em>up</em> operations made ready, in order, and when there
+ *  is none the virtual clock advances to the earliest wake up time of the sleeping entities. Entities are thus
+ *  run in virtual time order and a match takes only the processing time of its synchronization.
+ *
+ *  The semaphore operations of the entity threads are carried out by the scheduler (see semaphoreFutex.c); the
+ *  other threads, and the processes of the process-based engine, sleep and operate on semaphores as usual.
+ *
+ *  Defined operations:
+ *     \li starting the virtual clock
+ *     \li stopping the virtual clock
+ *     \li querying whether the calling thread is scheduled in virtual time
+ *     \li entering the schedule
+ *     \li leaving the schedule
+ *     \li sleeping
+ *     \li <em>down</em> and <em>up</em> of a semaphore value, in virtual time.
+ */
+
+#ifndef VCLOCK_H_
+#define VCLOCK_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+/**
+ *  \brief Starting the virtual clock.
+ *
+ *  Must be called before any of the entities enters the schedule. The first turn is given once all of them
+ *  have entered it. Only available in the thread-based engine.
+ *
+ *  \param nEntities number of entities that will enter the schedule
+ */
+extern void vclockStart (int nEntities);
+
+/**
+ *  \brief Stopping the virtual clock.
+ *
+ *  Must be called once every entity has left the schedule.
+ *
+ *  \return virtual time elapsed since the clock was started (ns)
+ */
+extern uint64_t vclockStop (void);
+
+/**
+ *  \brief Querying whether the calling thread is scheduled in virtual time.
+ *
+ *  \return \c true, if it entered the schedule and did not leave it yet
+ */
+extern bool vclockOn (void);
+
+/**
+ *  \brief Entering the schedule.
+ *
+ *  Called by an entity thread when it starts, if the virtual clock was started; the thread waits for its
+ *  first turn.
+ */
+extern void vclockEnter (void);
+
+/**
+ *  \brief Leaving the schedule.
+ *
+ *  Called by an entity thread when it terminates; the turn is given to the next entity.
+ */
+extern void vclockLeave (void);
+
+/**
+ *  \brief Sleeping.
+ *
+ *  An entity scheduled in virtual time gives its turn and waits until the virtual clock reaches its wake up
+ *  time; any other thread (or process) really sleeps.
+ *
+ *  \param us duration of the sleep (us)
+ */
+extern void vclockSleep (unsigned int us);
+
+/**
+ *  \brief <em>Down</em> by n of a semaphore value, in virtual time.
+ *
+ *  If the value is lower than <tt>n</tt>, the calling entity gives its turn and waits until an <em>up</em> makes
+ *  it ready.
+ *
+ *  \param val semaphore value
+ *  \param n decrement (>= 1)
+ *
+ *  \return \c 0
+ */
+extern int vclockDown (atomic_int *val, int n);
+
+/**
+ *  \brief <em>Up</em> by n of a semaphore value, in virtual time.
+ *
+ *  The entities waiting on the value that it satisfies, in the order they blocked, are made ready; the calling
+ *  entity keeps its turn.
+ *
+ *  \param val semaphore value
+ *  \param n increment (>= 1)
+ *
+ *  \return \c 0
+ */
+extern int vclockUp (atomic_int *val, int n);
+
+#endif /* VCLOCK_H_ */
@@ -0,0 +1,114 @@
+/**
+ *  \file waitWord.c (implementation file)
+ *
+ *  \brief Wait word management.
+ *
+ *  A wait word lets a single process block until another one hands it a value. It is built on a futex of its own,
+ *  so that the kernel is only entered when the waiter is already asleep as the value is handed over.
+ *
+ *  Operations defined on wait words:
+ *     \li initialization
+ *     \li handing of a value
+ *     \li waiting for the value.
+ */
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "semaphore.h"
+#include "vclock.h"
+#include "waitWord.h"
+
+#ifndef SOCCER_THREADS
+/** \brief futex operation codes: the words are in a region shared among processes */
+#define  FUTEXWAIT      FUTEX_WAIT
+#define  FUTEXWAKE      FUTEX_WAKE
+#else
+/** \brief futex operation codes: the words are only used by the threads of a process */
+#define  FUTEXWAIT      FUTEX_WAIT_PRIVATE
+#define  FUTEXWAKE      FUTEX_WAKE_PRIVATE
+#endif
+
+static int futexWait (atomic_int *addr, int val)
+{
+  return (int) syscall (SYS_futex, addr, FUTEXWAIT, val, NULL, NULL, 0);
+}
+
+static int futexWake (atomic_int *addr, int n)
+{
+  return (int) syscall (SYS_futex, addr, FUTEXWAKE, n, NULL, NULL, 0);
+}
+
+/**
+ *  \brief Initialization of a wait word.
+ *
+ *  Must be called when no process is using it.
+ *
+ *  \param w pointer to the wait word
+ */
+void wordInit (WAIT_WORD *w)
+{
+  atomic_init (&w->state, WORD_IDLE);
+  w->value = 0;
+}
+
+/**
+ *  \brief Handing of a value.
+ *
+ *  The waiter is woken up if it is already blocked. A value must not be handed twice without being taken.
+ *
+ *  \param w pointer to the wait word
+ *  \param value value handed to the waiter
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+int wordPost (WAIT_WORD *w, int value)
+{
+  semOpCount++;
+  w->value = value;                                                 /* published by the change of the state */
+#ifdef SOCCER_THREADS
+  if (vclockOn ())
+     return vclockUp (&w->state, WORD_POSTED);
+#endif
+  if (atomic_exchange (&w->state, WORD_POSTED) == WORD_ASLEEP)
+     return (futexWake (&w->state, 1) == -1) ? -1 : 0;
+  return 0;                                                        /* fast path: the waiter did not block yet */
+}
+
+/**
+ *  \brief Waiting for the value.
+ *
+ *  The caller blocks until a value is handed, takes it and leaves the word idle for the next one.
+ *
+ *  \param w pointer to the wait word
+ *  \param p_value pointer to the location where the value is stored
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+int wordWait (WAIT_WORD *w, int *p_value)
+{
+  int s = WORD_IDLE;                                                                          /* observed state */
+
+  semOpCount++;
+#ifdef SOCCER_THREADS
+  if (vclockOn ())
+     { vclockDown (&w->state, WORD_POSTED);                                    /* leaves the word idle again */
+       *p_value = w->value;
+       return 0;
+     }
+#endif
+  if (atomic_compare_exchange_strong (&w->state, &s, WORD_ASLEEP))          /* otherwise it is already posted */
+     while (atomic_load (&w->state) == WORD_ASLEEP)
+       if ((futexWait (&w->state, WORD_ASLEEP) == -1) && (errno != EAGAIN) && (errno != EINTR))
+          return -1;
+  *p_value = w->value;
+  atomic_store (&w->state, WORD_IDLE);
+  return 0;
+}
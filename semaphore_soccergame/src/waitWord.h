@@ -0,0 +1,85 @@
+/**
+ *  \file waitWord.h (interface file)
+ *
+ *  \brief Wait word management.
+ *
+ *  A wait word lets a single process block until another one hands it a value. It lives in shared memory, next to
+ *  the data of the process that waits on it, and is built on a futex of its own instead of a semaphore of the set,
+ *  so that there may be one per intervening entity, whatever their number (the size of a SysV set is bounded by
+ *  <tt>SEMMSL</tt>). The kernel is only entered when the waiter is already asleep as the value is handed over.
+ *
+ *  The state of the word is one of:
+ *     \li <tt>WORD_IDLE</tt>, nothing was handed and nobody waits
+ *     \li <tt>WORD_ASLEEP</tt>, the waiter is blocked (or about to block) on the word
+ *     \li <tt>WORD_POSTED</tt>, the value was handed and is not yet taken.
+ *
+ *  When built with <tt>SOCCER_THREADS</tt> defined the futex operations are private ones, and the threads
+ *  scheduled in virtual time wait through the scheduler (see vclock.h).
+ *
+ *  Operations defined on wait words:
+ *     \li initialization
+ *     \li handing of a value
+ *     \li waiting for the value.
+ */
+
+#ifndef WAITWORD_H_
+#define WAITWORD_H_
+
+#include <stdatomic.h>
+
+#include "cacheLine.h"
+
+/** \brief states of a wait word */
+#define  WORD_ASLEEP    -1
+#define  WORD_IDLE       0
+#define  WORD_POSTED     1
+
+/**
+ *  \brief Definition of <em>wait word</em> data type.
+ */
+typedef struct
+        { /** \brief state of the word (each word takes a cache line of its own in the padded layout) */
+          LINEALIGNED atomic_int state;
+          /** \brief value handed to the waiter - valid once the state is <tt>WORD_POSTED</tt> */
+          int value;
+        } WAIT_WORD;
+
+/**
+ *  \brief Initialization of a wait word.
+ *
+ *  Must be called when no process is using it.
+ *
+ *  \param w pointer to the wait word
+ */
+
+extern void wordInit (WAIT_WORD *w);
+
+/**
+ *  \brief Handing of a value.
+ *
+ *  The waiter is woken up if it is already blocked. A value must not be handed twice without being taken.
+ *
+ *  \param w pointer to the wait word
+ *  \param value value handed to the waiter
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int wordPost (WAIT_WORD *w, int value);
+
+/**
+ *  \brief Waiting for the value.
+ *
+ *  The caller blocks until a value is handed, takes it and leaves the word idle for the next one.
+ *
+ *  \param w pointer to the wait word
+ *  \param p_value pointer to the location where the value is stored
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int wordWait (WAIT_WORD *w, int *p_value);
+
+#endif /* WAITWORD_H_ */